@@ -0,0 +1,158 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// --- Serial Commands ---
+// Decoding is kept apart from acting on it so the host simulator can push
+// arbitrary bytes through exactly the decoder the firmware uses.
+enum CommandAction : uint8_t {
+    CMD_NONE,       // Unknown letter
+    CMD_ENABLE,     // 's'
+    CMD_DISABLE,    // 'x'
+    CMD_TRACE_DUMP, // 'd'
+    CMD_TRACE_ARM,  // 't'
+    CMD_STATUS,     // 'p': every pair from the state store
+    CMD_PAUSE,      // 'h': hold every pair where it is
+    CMD_RESUME,     // 'r': release every hold
+};
+
+CommandAction commandDecode(char c);
+
+// --- Command Batches ---
+// For automation: several commands in one message, acknowledged with the
+// message's sequence number. The console tells the three forms apart by
+// the first byte of a message:
+//
+//   digit     text line   "<seq> <cmd> [args][; <cmd> [args]...]\n"
+//                         replies "<seq> OK" or "<seq> ERR <index> <reason>",
+//                         and before it, per pair a status asked for,
+//                         "<seq> PAIR <pair> <phase> <side> <relays> <inputs>
+//                         <ms-left> <cycles> <run|hold>"
+//   0x00      binary      0x00, COBS(payload), 0x00. Payload: seq (u16 LE),
+//                         1..COMMAND_BATCH_MAX commands of 6 bytes (op,
+//                         pair, a u16 LE, b u16 LE), CRC-16/CCITT-FALSE of
+//                         all that (u16 LE). Replies are framed the same way:
+//                         seq, error (CommandError), index of the failing
+//                         command, then a STATUS_WIRE_BYTES record per pair
+//                         a status asked for (pair, phase, side B | relays << 1
+//                         | inputs << 3 | paused << 5, ms left u32 LE,
+//                         cycles u32 LE).
+//   anything  letter line a commandDecode() letter alone on its line, acted
+//                         on at its newline; any other word is rejected
+//                         ("0 ERR 0 unknown-command") and runs nothing
+//
+// Text commands: enable | disable | dwell <pair|*> <min-ms> <max-ms> |
+// status [pair] | pause [pair] | resume [pair] | dump | arm |
+// expose <k> <first> <last> <window-ms> [gap] [norepeat] | expose off |
+// ripple <first> <last> <stagger-ms> [hold-steps] | ripple off |
+// aux <channel> <drill|step> <pulse-ms> | aux <channel> off.
+// No pair means every pair. A batch is checked as a whole before any of
+// it runs, so a malformed one changes nothing.
+enum CommandOp : uint8_t {
+    OP_ENABLE = 1,     // The whole sequence
+    OP_DISABLE = 2,
+    OP_DWELL = 3,      // a..b ms random delay from the pair's next dwell on
+    OP_STATUS = 4,
+    OP_TRACE_DUMP = 5, // Text only: the dump is text
+    OP_TRACE_ARM = 6,
+    OP_PAUSE = 7,      // Hold the pair: phase and time left kept
+    OP_RESUME = 8,     // Release the hold, carrying on where it stopped
+    OP_EXPOSE = 9,     // Group pairs a & 0xFF .. a >> 8 into k-of-N exposure windows of b ms
+                       // (group_engine.h). pair carries the rules: k | gap << 4 | norepeat << 7;
+                       // k 0 ends the group. Only while the sequence is disabled.
+    OP_RIPPLE = 10,    // Group pairs a & 0xFF .. a >> 8 into a ripple with b ms between steps and
+                       // pair empty steps between ripples; b 0 ends the group. As OP_EXPOSE.
+    OP_AUX = 11,       // Bind aux output pair to event a (AuxEvent, 0 unbinds), pulsed for b ms. As
+                       // OP_EXPOSE.
+};
+
+const uint8_t EXPOSE_K_MASK = 0x0F;
+const int EXPOSE_GAP_SHIFT = 4;
+const uint8_t EXPOSE_GAP_MAX = 7;
+const uint8_t EXPOSE_NO_REPEAT = 0x80;
+
+struct GroupRules;
+
+enum CommandError : uint8_t {
+    CMD_OK = 0,
+    CMD_ERR_SYNTAX,   // Unreadable line or frame, or wrong payload length
+    CMD_ERR_CRC,      // Frame failed its CRC
+    CMD_ERR_OP,       // Unknown command
+    CMD_ERR_ARG,      // Missing or out-of-range argument
+    CMD_ERR_TOO_LONG, // Line or frame over the buffer, or too many commands
+    CMD_ERR_MODE,     // Not available in binary mode
+    CMD_ERR_BUSY,     // Valid, but the state does not allow it now
+};
+
+const char* commandErrorName(CommandError e);
+
+const uint8_t COMMAND_ALL_PAIRS = 0xFF;
+const int COMMAND_BATCH_MAX = 8;
+const int COMMAND_WIRE_BYTES = 6;   // One binary command
+const int COMMAND_LINE_MAX = 96;    // Text line, without the newline
+const int COMMAND_PAYLOAD_MAX = 2 + COMMAND_BATCH_MAX * COMMAND_WIRE_BYTES + 2;
+const int STATUS_WIRE_BYTES = 11;   // One pair in a binary status reply
+
+struct Command {
+    uint8_t op;   // CommandOp
+    uint8_t pair; // COMMAND_ALL_PAIRS: every pair
+    uint16_t a, b;
+};
+
+struct CommandBatch {
+    uint16_t seq;
+    bool binary; // Arrived as a frame: reply with a frame
+    uint8_t count;
+    Command cmds[COMMAND_BATCH_MAX];
+};
+
+// Byte-at-a-time reader for everything that arrives on the console.
+class CommandReader {
+public:
+    enum Result : uint8_t {
+        READ_NONE,   // Mid-message
+        READ_SINGLE, // single(): a single-letter command line
+        READ_BATCH,  // batch(): checked, ready to run
+        READ_ERROR,  // error() / errorIndex(); batch().seq and .binary say where to reply
+    };
+
+    explicit CommandReader(int pairCount) : pairCount_(pairCount) {}
+
+    Result feed(uint8_t byte);
+
+    char single() const { return single_; }
+    const CommandBatch& batch() const { return batch_; }
+    CommandError error() const { return error_; }
+    uint8_t errorIndex() const { return errorIndex_; }
+
+private:
+    enum Mode : uint8_t { MODE_IDLE, MODE_TEXT, MODE_FRAME, MODE_DISCARD_TEXT, MODE_DISCARD_FRAME };
+
+    Result parseLine();
+    Result parseFrame();
+    Result fail(CommandError e, uint8_t index);
+    CommandError check(const Command& c) const;
+
+    int pairCount_;
+    Mode mode_ = MODE_IDLE;
+    uint8_t len_ = 0;
+    uint8_t buf_[COMMAND_LINE_MAX + 1];
+    char single_ = 0;
+    CommandBatch batch_ = {};
+    CommandError error_ = CMD_OK;
+    uint8_t errorIndex_ = 0;
+};
+
+// The group an OP_EXPOSE or OP_RIPPLE command asks for (group_engine.h).
+GroupRules commandGroupRules(const Command& c);
+
+// CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF).
+uint16_t commandCrc16(const uint8_t* data, size_t n);
+
+// Append the CRC to payload (n bytes) and COBS-encode it between two 0x00
+// delimiters. out needs n + 2 + n / 254 + 4 bytes. Returns the bytes written.
+size_t commandFrame(const uint8_t* payload, size_t n, uint8_t* out);
+
+// A batch as a binary request frame, for host tools driving the console.
+size_t commandEncode(const CommandBatch& batch, uint8_t* out);
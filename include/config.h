@@ -0,0 +1,92 @@
+#pragma once
+
+#include <stdint.h>
+
+// Shared by the firmware (src/main.cpp) and the host builds (src/host/),
+// so the simulated plant is always wired the same way as the real lanes.
+
+// --- Hardware Configuration ---
+#define PCF_ADDRESS_RELAYS 0x24 // I2C Address for the RELAY expander
+#define PCF_ADDRESS_INPUTS 0x22 // I2C Address for the INPUT expander
+#define I2C_SDA_PIN 4           // Your SDA pin
+#define I2C_SCL_PIN 15          // Your SCL pin
+#define EXPANDER_INT_GPIO 27    // MCP23017 builds: every input chip's INTA (open-drain, wired-OR)
+
+// --- Expander Type ---
+// PAIR_PCF8575 ([env:nodemcu-32s-pcf8575]) builds for PCF8575s instead: 16
+// pins per chip, so one relay and one input chip carry eight pairs, and a
+// bank is read or written in one two-byte transaction. Same addresses.
+// PAIR_MCP23017 ([env:nodemcu-32s-mcp23017]) builds for MCP23017s: 16 pins
+// as well, plus interrupt-on-change, so an input edge wakes the tasks
+// through EXPANDER_INT_GPIO instead of waiting for the next poll.
+#if defined(PAIR_PCF8575) || defined(PAIR_MCP23017)
+const int PCF_PINS = 16;
+#else
+const int PCF_PINS = 8;
+#endif
+typedef uint16_t PcfPort;              // One bank's pins: bit n is pin n % PCF_PINS
+const int PCF_MAX_BANKS = 16;          // Relay + input chip pairs a lane can carry (pair_io.h)
+const PcfPort PCF_ALL_HIGH = 0xFFFF;   // Relays off, inputs released
+
+// --- Pin Configuration ---
+// Checked at compile time by pin_map.h (range, duplicates, A/B on one chip).
+// Bank 0 takes pins 0..PCF_PINS-1, bank b the next PCF_PINS; a bank past 0
+// is added with pcfAddBank() before the tasks start.
+const int PAIR_COUNT = 3;
+constexpr int RELAY_PINS[PAIR_COUNT * 2] = {0, 1, 2, 3, 4, 5}; // Pins on RELAY PCF (0x24)
+constexpr int INPUT_PINS[PAIR_COUNT * 2] = {0, 1, 2, 3, 4, 5}; // Pins on INPUT PCF (0x22)
+// Spare relay pins for a start buzzer or lane lamp, bound to group events
+// with the console's aux command (group_engine.h). Active LOW like the relays.
+const int AUX_COUNT = 2;
+constexpr int AUX_PINS[AUX_COUNT] = {6, 7}; // Pins on RELAY PCF (0x24)
+const int GROUP_PAIRS_MAX = 16; // Members per group (group_engine.h): a selection is a uint16_t
+
+// --- Native GPIO Lane ---
+// PAIR_NATIVE_GPIO ([env:nodemcu-32s-gpio]) wires bank 0 to ESP32 GPIOs
+// instead of the two expanders: pin n above is GPIO LANE_RELAY_GPIOS[n] /
+// LANE_INPUT_GPIOS[n] (-1: not wired). Relays must sit on GPIO 0..31 so one
+// GPIO_OUT_W1TS / W1TC store switches them together; active LOW as on the expander.
+// Inputs interrupt on every edge, through an IRAM handler that keeps stopping
+// relays during flash writes. 34..39 are input-only and have no pull-up:
+// fit external ones, as the PCF8574 needs. Banks are eight pins wide here,
+// so extra banks are PCF8574s (no PCF8575 / MCP23017 / loop-back rig).
+constexpr int LANE_RELAY_GPIOS[8] = {16, 17, 18, 19, 21, 22, 23, 13};
+constexpr int LANE_INPUT_GPIOS[8] = {34, 35, 36, 39, 32, 33, 25, 26};
+
+// --- Queued I2C ---
+// PAIR_I2C_ASYNC ([env:nodemcu-32s-i2c-async]) runs the PCF857x banks on
+// ESP-IDF's i2c_master driver (IDF 5.2+, so an Arduino 3.x core) instead of
+// Wire: a relay write is queued and the I2C interrupt clocks it out, so the
+// writing task no longer waits out the transfer or another task's read.
+#define I2C_CLOCK_HZ 100000       // Standard mode, Wire's default
+const int I2C_QUEUE_DEPTH = 16;   // Transactions queued before a caller waits
+const uint32_t I2C_READ_TIMEOUT_MS = 50;
+
+// --- Timing Configuration ---
+// Default range; the console's dwell command changes it per pair.
+const int MIN_DELAY_MS = 1500; // Minimum delay after input trigger
+const int MAX_DELAY_MS = 4000; // Maximum delay after input trigger
+// A group window's faces should land within this much of each other
+// (group_engine.h): turns this close share one write, a wider spread is logged.
+const uint32_t GROUP_FACE_TOLERANCE_MS = 20;
+// Inrush: at most START_CAP motor starts within any START_WINDOW_MS on the
+// shared supply (start_gate.h); 0 lifts the cap.
+const int START_CAP = 2;
+const uint32_t START_WINDOW_MS = 100;
+
+// --- Task Configuration ---
+const uint32_t MOTOR_TASK_STACK = 4096; // Bytes of stack per MotorTask
+
+// --- Build Variant ---
+// PAIR_MIN_LATENCY ([env:nodemcu-32s-minimal]) is the competition build: the
+// per-move text log is compiled out, the motor tasks get core 1 to
+// themselves above every other priority there, and the serial console moves
+// to core 0. The full build keeps the log and alternates pairs across cores.
+#ifdef PAIR_MIN_LATENCY
+const int MOTOR_TASK_PRIORITY = 5; // Above loopTask and unpinned library tasks (1)
+const int MOTOR_TASK_CORE = 1;     // Every pair
+const int CONSOLE_CORE = 0;        // Console and bench tasks
+#else
+const int MOTOR_TASK_PRIORITY = 1;
+const int MOTOR_TASK_CORE = -1;    // -1: pair i on core i % 2
+#endif
@@ -0,0 +1,603 @@
+#pragma once
+
+#include <stdint.h>
+#include "config.h"
+#include "pair_engine.h"
+#include "pin_map.h"
+#include "start_gate.h"
+
+// --- Pair Groups ---
+// A group is a run of adjacent pairs sequenced by one central timeline
+// instead of each pair's own dwell timer. While a group is configured its
+// pairs belong to the group's task: their MotorTasks stand aside, and
+// groupStep() drives and watches them as the engine would (one relay per
+// pair, off as soon as its switch closes), keeping their MotorTaskData up to
+// date so the state store and status read them unchanged.
+//
+// Exposure mode: a pair at its B switch shows its face. Every window of
+// windowMs exactly k of the group's pairs are exposed and the rest are
+// turned away. Which k is drawn at random from a table of every selection
+// the rules allow, built once when the group is configured:
+//
+//   gap        at least this many hidden pairs between two exposed ones
+//   noRepeat   no pair is exposed in two windows running (selections that
+//              would leave no legal next window are dropped from the table)
+//
+// The next window is drawn, and the port writes it needs worked out, while
+// the current one runs. At the window boundary the step only commits those
+// writes: one masked write per relay bank, every pair that turns in it
+// switched in the same transaction.
+//
+// Ripple mode: the pairs turn one after another, first to last, on a grid
+// of windowMs (the stagger). A full ripple sends every pair to the other
+// side, then holdSteps empty steps pass before the next ripple sends them
+// back. Each step is one pair's relay change, drawn ahead and committed in
+// one write, on the same timeline as every other step, so the spacing does
+// not depend on how long any pair took to travel.
+//
+// Face timing (exposure mode): what the shooter sees is the moment a target
+// is fully faced, its B switch closed, not the relay write. Each pair keeps
+// a running estimate of its command-to-limit time (travelEstMs), and a
+// member turning to B goes out that much ahead of its boundary, so its face
+// lands on the boundary itself: never before its window began, nor while it
+// is still turning away. Members without an estimate yet, and the first
+// window after an enable, turn at the boundary. Turning away is never early,
+// so an exposure lasts its full window. Every scheduled face records how far
+// from its boundary it closed in faceErrorMs. A ripple keeps its writes on
+// the stagger grid.
+//
+// The leads stagger the starts by each pair's learned travel time, so the
+// faces of one window land together. Members whose turns fall within
+// GROUP_FACE_TOLERANCE_MS (config.h) of each other share a write, and once
+// every face of a window is in, the spread between the first and the last
+// is logged and kept in faceSpreadMs; one wider than the tolerance says so.
+//
+// Starts go through the start gate (start_gate.h) as the group's one
+// claim, due at the boundary (an early turn: when its lead comes). Members
+// turning to B go first; any the supply cannot take yet are deferred: relay
+// off, waiting in Idle toward their side, started as soon as the gate allows
+// and before any early turn. A resume restarts travelling members the same
+// way.
+//
+// Aux outputs (AUX_PINS, config.h) follow the group's timeline: each is
+// bound to an event and pulsed for pulseMs when it comes. AUX_DRILL is the
+// first window (ripple: step) after an enable, AUX_STEP every window and
+// every ripple step that turns a pair. A pulse starts in the boundary's own
+// write, with the relays it accompanies (exposure mode: as the early faces
+// land), and ends in the write of the first boundary or step after it runs
+// out. A disable or a hold turns every aux
+// output off.
+//
+// Disable and pause behave as for a single pair: a disable unwinds every
+// member to Idle, and a hold (any member paused holds the whole group) stops
+// the window clock and turns travelling relays off until it is released.
+
+const int GROUP_SELECTIONS_MAX = 512;  // Precomputed selections per group
+const uint32_t FACE_POLL_MS = 5;       // Switch sampling period once a member is due at its limit
+
+enum GroupMode : uint8_t {
+    GROUP_EXPOSE,
+    GROUP_RIPPLE,
+};
+
+struct GroupRules {
+    uint8_t first, last; // Members: pairs first..last
+    uint8_t k;           // Exposed per window; 0 = no group (exposure)
+    uint8_t gap;
+    bool noRepeat;
+    uint16_t windowMs;   // Exposure window, or ripple stagger; 0 = no group (ripple)
+    uint8_t mode;        // GroupMode
+    uint8_t holdSteps;   // Ripple: empty steps between two ripples
+};
+
+enum AuxEvent : uint8_t {
+    AUX_OFF,   // Unbound
+    AUX_DRILL, // The drill begins: first window after an enable
+    AUX_STEP,  // Every window, every ripple step that turns a pair
+};
+
+const uint16_t AUX_PULSE_MAX_MS = 0x3FFF; // Traced as pulse | event << 14
+
+struct GroupAux {
+    uint8_t event;    // AuxEvent
+    uint16_t pulseMs;
+    bool on;
+    uint32_t onSinceMs;
+};
+
+struct GroupWrite {
+    uint8_t bank;
+    PcfPort mask, value; // As Io::relaysWrite()
+};
+
+struct GroupData {
+    MotorTaskData* pairs; // Every pair; members are pairs[first .. first + count - 1]
+    uint8_t first;
+    uint8_t count;        // 0: no group
+    GroupRules rules;
+    uint16_t selections[GROUP_SELECTIONS_MAX]; // Bit i: pair first + i exposed
+    uint16_t selectionCount;
+
+    // Timeline
+    bool running;          // Started by an enable, unwound by a disable
+    bool fresh;            // Member positions unknown: the next write drives them all
+    uint32_t windowStartMs;
+    uint32_t windows;      // Windows (ripple: steps) started since the last enable
+    uint16_t exposed;      // Selection of the window in progress (ripple: members sent to B)
+    uint16_t next;         // Drawn ahead for the next window...
+    uint16_t drive;        // ...the members it turns...
+    GroupWrite writes[GROUP_PAIRS_MAX]; // ...and the port writes that do it at the boundary,
+    uint8_t writeCount;
+    uint16_t early;        // ...but for these, turned to B ahead of it by their lead
+    uint16_t moving;       // Members with a relay on
+    uint16_t due;          // Members on their way to a scheduled face...
+    uint32_t dueMs[GROUP_PAIRS_MAX]; // ...and the boundary it is due at
+    uint32_t facesDueMs;   // Boundary whose faces are being gathered...
+    uint16_t facing;       // ...members still to land there...
+    uint8_t faces;         // ...those landed...
+    int16_t faceFirstMs, faceLastMs; // ...and the earliest and latest (as faceErrorMs)
+    uint16_t deferred;     // Members refused a start by the gate, waiting in Idle...
+    uint32_t deferredDueMs; // ...since this start fell due
+    uint32_t faceWindows;  // Windows whose faces have all landed
+    uint16_t faceSpreadMs; // First to last face of the latest of them
+    bool paused;
+    uint32_t pausedAtMs;
+    GroupAux aux[AUX_COUNT]; // Bindings outlive the group's rules
+};
+
+// Merge a masked write into the list of writes, one per bank.
+inline void groupAddWrite(GroupWrite* w, int& n, uint8_t bank, PcfPort mask, PcfPort value) {
+    int j = 0;
+    while (j < n && w[j].bank != bank) j++;
+    if (j == n) w[n++] = GroupWrite{bank, 0, PCF_ALL_HIGH};
+    w[j].mask |= mask;
+    w[j].value = (PcfPort)((w[j].value & ~mask) | (value & mask));
+}
+
+inline bool groupMember(const GroupData* g, int pair) {
+    return g->count && pair >= g->first && pair < g->first + g->count;
+}
+
+// Build the selection table for rules over g->pairs (pairCount of them).
+// False, leaving g untouched, if the rules are out of range or allow no
+// selection. rules.k == 0 (ripple: rules.windowMs == 0) clears the group.
+// Call only while it is stopped.
+bool groupPlan(GroupData* g, int pairCount, const GroupRules& rules);
+
+// Advance the group. Returns the number of ms until it needs to run again
+// (0: at once, without blocking), or MOTOR_WAIT_FOREVER if only a change of
+// the enable or pause flag can give it work.
+uint32_t groupStep(GroupData* g, bool enabled, bool paused);
+
+// Selections that may follow after (all of them unless noRepeat), and the
+// index-th of those. Used by GroupEngine to draw ahead.
+int groupCandidates(const GroupData* g, uint16_t after);
+uint16_t groupCandidate(const GroupData* g, uint16_t after, int index);
+
+// The ripple's next step: the step after the g->windows-th turns its pair.
+uint16_t groupRippleNext(const GroupData* g);
+
+// Work out g->drive, g->early and g->writes for moving from g->exposed to
+// g->next.
+void groupPrepare(GroupData* g);
+
+// How long before the boundary member i turns to B: its travel estimate,
+// at most a window.
+uint32_t groupLeadMs(const GroupData* g, int i);
+
+// Bind aux output channel to event, pulsed for pulseMs. False, changing
+// nothing, if either is out of range. Call only while the group is stopped.
+bool groupSetAux(GroupData* g, int channel, uint8_t event, uint16_t pulseMs);
+
+// A binding as its TRACE_AUX record (trace.h).
+void groupTraceAux(const GroupData* g, int channel);
+
+// Rules as TRACE_GROUP records (trace.h), and back from the records' values
+// by arg.
+const int GROUP_TRACE_FIELDS = 4;
+void groupTrace(const GroupRules& rules);
+GroupRules groupTraceRules(const uint16_t* fields);
+
+// --- Group Engine Template ---
+// groupStep() for a given set of policies, as PairEngine. Rng additionally
+// needs static uint32_t pick(uint32_t n) (uniform 0..n-1).
+template <class Io, class Clock, class Rng, class Log, class Supply>
+struct GroupEngine {
+    // Relays of every member in members off, one write per bank
+    static void relaysOff(GroupData* g, uint16_t members) {
+        GroupWrite w[GROUP_PAIRS_MAX];
+        int n = 0;
+        for (int i = 0; i < g->count; i++) {
+            if (!(members & (1u << i))) continue;
+            const MotorTaskData& p = g->pairs[g->first + i];
+            groupAddWrite(w, n, p.relayBank, p.relayMaskA | p.relayMaskB, PCF_ALL_HIGH);
+        }
+        for (int j = 0; j < n; j++) Io::relaysWrite(w[j].bank, w[j].mask, w[j].value);
+    }
+
+    // Current relay of every member in members on, the other off
+    static void relaysOn(GroupData* g, uint16_t members) {
+        GroupWrite w[GROUP_PAIRS_MAX];
+        int n = 0;
+        for (int i = 0; i < g->count; i++) {
+            if (!(members & (1u << i))) continue;
+            const MotorTaskData& p = g->pairs[g->first + i];
+            groupAddWrite(w, n, p.relayBank, p.relayMaskA | p.relayMaskB,
+                          (PcfPort)~(p.activeRelayA ? p.relayMaskA : p.relayMaskB));
+        }
+        for (int j = 0; j < n; j++) Io::relaysWrite(w[j].bank, w[j].mask, w[j].value);
+    }
+
+    // Aux outputs: those in fire on, their pulse starting now; those on
+    // whose pulse is over (every one if all) off. Merged into w.
+    static void auxWrites(GroupData* g, uint8_t fire, bool all, uint32_t now, GroupWrite* w, int& n) {
+        for (int c = 0; c < AUX_COUNT; c++) {
+            GroupAux& a = g->aux[c];
+            bool on = (fire & (1u << c)) != 0;
+            if (!on && !(a.on && (all || now - a.onSinceMs >= a.pulseMs))) continue;
+            groupAddWrite(w, n, pinBank(AUX_PINS[c]), pinMask(AUX_PINS[c]), on ? 0 : PCF_ALL_HIGH);
+            a.on = on;
+            a.onSinceMs = now;
+        }
+    }
+
+    // Aux channels bound to event
+    static uint8_t auxBound(const GroupData* g, uint8_t event) {
+        uint8_t bound = 0;
+        for (int c = 0; c < AUX_COUNT; c++) {
+            if (g->aux[c].event == event) bound |= 1u << c;
+        }
+        return bound;
+    }
+
+    // Aux outputs whose pulse is over (every one if all) off, in writes of their own
+    static void auxOff(GroupData* g, bool all, uint32_t now) {
+        GroupWrite w[AUX_COUNT];
+        int n = 0;
+        auxWrites(g, 0, all, now, w, n);
+        for (int j = 0; j < n; j++) Io::relaysWrite(w[j].bank, w[j].mask, w[j].value);
+    }
+
+    // As many of the members in want as the supply can start now, those in
+    // first before the rest. The caller starts them.
+    static uint16_t claimStarts(GroupData* g, uint16_t want, uint16_t first, uint32_t dueMs, uint32_t now,
+                                uint32_t* retryMs) {
+        int n = Supply::claimStarts(START_GATE_GROUP, __builtin_popcount(want), dueMs, now, retryMs);
+        uint16_t granted = 0;
+        for (int pass = 0; pass < 2; pass++) {
+            uint16_t from = pass ? want & ~first : want & first;
+            for (int i = 0; i < g->count && n > 0; i++) {
+                if (!(from & (1u << i))) continue;
+                granted |= 1u << i;
+                n--;
+            }
+        }
+        return granted;
+    }
+
+    // Members now travelling toward their activeRelayA side; relays as written
+    static void travelling(GroupData* g, uint16_t members, uint32_t now) {
+        for (int i = 0; i < g->count; i++) {
+            if (!(members & (1u << i))) continue;
+            MotorTaskData& p = g->pairs[g->first + i];
+            p.phase = PHASE_TRAVEL;
+            p.phaseStartMs = now;
+        }
+        g->moving |= members;
+    }
+
+    // Members the gate held back: relays off, in Idle until it lets them go
+    static void defer(GroupData* g, uint16_t members, uint32_t dueMs, uint32_t now) {
+        if (!members) return;
+        for (int i = 0; i < g->count; i++) {
+            if (!(members & (1u << i))) continue;
+            MotorTaskData& p = g->pairs[g->first + i];
+            p.phase = PHASE_IDLE;
+            p.phaseStartMs = now;
+        }
+        if (!g->deferred) g->deferredDueMs = dueMs;
+        g->deferred |= members;
+        g->moving &= ~members;
+    }
+
+    // Members heading to B among members
+    static uint16_t towardB(const GroupData* g, uint16_t members) {
+        uint16_t b = 0;
+        for (int i = 0; i < g->count; i++) {
+            if ((members & (1u << i)) && !g->pairs[g->first + i].activeRelayA) b |= 1u << i;
+        }
+        return b;
+    }
+
+    // The faces of one window are in: log how far apart they landed. Any
+    // member still out counts as landing now.
+    static void facesLanded(GroupData* g, uint32_t now) {
+        if (g->facing) {
+            int32_t late = (int32_t)(now - g->facesDueMs);
+            if (!g->faces || late > g->faceLastMs) g->faceLastMs = (int16_t)(late > 0x7FFF ? 0x7FFF : late);
+            if (!g->faces) g->faceFirstMs = g->faceLastMs;
+        }
+        g->faceSpreadMs = (uint16_t)(g->faceLastMs - g->faceFirstMs);
+        g->faceWindows++;
+        Log::printf("Group: %d faces landed within %u ms%s.\n", g->faces + __builtin_popcount(g->facing),
+                    g->faceSpreadMs, g->faceSpreadMs > GROUP_FACE_TOLERANCE_MS ? ", over the tolerance" : "");
+        g->facing = 0;
+        g->faces = 0;
+    }
+
+    // Members now on their way to a face due at dueMs
+    static void facesScheduled(GroupData* g, uint16_t members, uint32_t dueMs, uint32_t now) {
+        if (!members) return;
+        if ((g->facing || g->faces) && g->facesDueMs != dueMs) facesLanded(g, now);
+        g->facesDueMs = dueMs;
+        g->facing |= members;
+        g->due |= members;
+        for (int i = 0; i < g->count; i++) {
+            if (members & (1u << i)) g->dueMs[i] = dueMs;
+        }
+    }
+
+    // Member i is at its switch
+    static void faceLanded(GroupData* g, int i, uint32_t now) {
+        if (!(g->due & (1u << i))) return;
+        int32_t late = (int32_t)(now - g->dueMs[i]);
+        int16_t err = (int16_t)(late < -0x7FFF ? -0x7FFF : late > 0x7FFF ? 0x7FFF : late);
+        g->pairs[g->first + i].faceErrorMs = err;
+        g->due &= ~(1u << i);
+        if (!(g->facing & (1u << i)) || g->dueMs[i] != g->facesDueMs) return;
+        if (!g->faces || err < g->faceFirstMs) g->faceFirstMs = err;
+        if (!g->faces || err > g->faceLastMs) g->faceLastMs = err;
+        g->faces++;
+        g->facing &= ~(1u << i);
+        if (!g->facing) facesLanded(g, now);
+    }
+
+    // Draw the next window (ripple: the next step) and prepare its writes
+    static void drawAhead(GroupData* g) {
+        if (g->rules.mode == GROUP_RIPPLE) {
+            g->next = groupRippleNext(g);
+        } else {
+            g->next = groupCandidate(g, g->exposed, (int)Rng::pick(groupCandidates(g, g->exposed)));
+        }
+        groupPrepare(g);
+    }
+
+    static uint32_t step(GroupData* g, bool enabled, bool paused) {
+        if (!g->count) return MOTOR_WAIT_FOREVER;
+
+        while (true) {
+            uint32_t now = Clock::nowMs();
+
+            if (!enabled) {
+                if (!g->running) return MOTOR_WAIT_FOREVER;
+                // Unwind as the engine does: a move stops where it is and is
+                // retried, a pair at rest turns toward the other side next
+                if (!g->paused) relaysOff(g, g->moving);
+                auxOff(g, true, now);
+                for (int i = 0; i < g->count; i++) {
+                    MotorTaskData& p = g->pairs[g->first + i];
+                    if (p.phase == PHASE_DWELL) p.activeRelayA = !p.activeRelayA;
+                    p.phase = PHASE_IDLE;
+                    p.phaseStartMs = now;
+                    p.paused = false;
+                }
+                Log::printf("Group: Sequence disabled after %lu windows.\n", (unsigned long)g->windows);
+                g->running = false;
+                g->paused = false;
+                g->moving = 0;
+                g->deferred = 0;
+                g->due = 0;
+                g->facing = 0; // Faces cut short are not reported
+                g->faces = 0;
+                return MOTOR_WAIT_FOREVER;
+            }
+
+            if (!g->running) {
+                g->running = true;
+                g->fresh = g->rules.mode == GROUP_EXPOSE; // A ripple finds each pair out on its own step
+                g->windows = 0;
+                g->exposed = 0;
+                g->moving = 0;
+                g->deferred = 0;
+                g->due = 0;
+                g->facing = 0;
+                g->faces = 0;
+                drawAhead(g);
+                g->windowStartMs = now - g->rules.windowMs; // First window is due now
+            }
+
+            if (g->paused != paused) {
+                if (!g->paused) {
+                    relaysOff(g, g->moving);
+                    auxOff(g, true, now);
+                    g->paused = true;
+                    g->pausedAtMs = now;
+                    for (int i = 0; i < g->count; i++) {
+                        g->pairs[g->first + i].paused = true;
+                        g->pairs[g->first + i].pausedAtMs = now;
+                    }
+                    Log::println("Group: Paused.");
+                    return MOTOR_WAIT_FOREVER;
+                }
+                // The window and every member's phase skip the hold
+                uint32_t held = now - g->pausedAtMs;
+                g->paused = false;
+                g->windowStartMs += held;
+                for (int i = 0; i < g->count; i++) {
+                    g->pairs[g->first + i].paused = false;
+                    g->pairs[g->first + i].phaseStartMs += held;
+                    g->dueMs[i] += held;
+                }
+                g->facesDueMs += held;
+                uint32_t retryMs;
+                uint16_t back = claimStarts(g, g->moving, towardB(g, g->moving), now, now, &retryMs);
+                relaysOn(g, back);
+                defer(g, g->moving & ~back, now, now);
+                Log::println("Group: Resumed.");
+                return 0; // Anything now due goes in a step of its own: one write per bank each
+            }
+            if (g->paused) return MOTOR_WAIT_FOREVER;
+
+            uint32_t windowMs = g->rules.windowMs;
+            uint32_t boundaryMs = g->windowStartMs + windowMs;
+            uint32_t retryMs = 0; // When the gate wants to be asked again (0: not asked)
+            if (now - g->windowStartMs < windowMs) auxOff(g, false, now);
+            if (now - g->windowStartMs < windowMs && g->deferred) {
+                // Deferred starts first: they are overdue
+                uint16_t started = claimStarts(g, g->deferred, towardB(g, g->deferred), g->deferredDueMs, now, &retryMs);
+                if (started) {
+                    relaysOn(g, started);
+                    travelling(g, started, now);
+                    g->deferred &= ~started;
+                    Log::printf("Group: Started 0x%04X, %s.\n", started,
+                                g->deferred ? "more waiting for the supply" : "none waiting");
+                    return 0; // Sample the switches right away, in a step of their own
+                }
+            } else if (now - g->windowStartMs < windowMs) {
+                // Early turns: every member whose lead has come, and with it
+                // any due within the tolerance, in one write per bank
+                uint16_t turn = 0, soon = 0;
+                for (int i = 0; i < g->count; i++) {
+                    if (!((g->early & ~g->moving) & (1u << i))) continue;
+                    uint32_t at = windowMs - groupLeadMs(g, i), elapsed = now - g->windowStartMs;
+                    if (elapsed >= at) turn |= 1u << i;
+                    if (elapsed + GROUP_FACE_TOLERANCE_MS >= at) soon |= 1u << i;
+                }
+                if (turn) turn = claimStarts(g, soon, turn, now, now, &retryMs);
+                if (turn) {
+                    for (int i = 0; i < g->count; i++) {
+                        if (!(turn & (1u << i))) continue;
+                        MotorTaskData& p = g->pairs[g->first + i];
+                        p.activeRelayA = false;
+                        Log::printf("Task %d: Relay B (Pin %d) ON, face due in %lu ms.\n", g->first + i, p.relayB,
+                                    (unsigned long)(boundaryMs - now));
+                    }
+                    relaysOn(g, turn);
+                    travelling(g, turn, now);
+                    facesScheduled(g, turn, boundaryMs, now);
+                    g->drive &= ~turn;
+                    g->early &= ~turn;
+                    return 0; // Sample the switches right away, in a step of their own
+                }
+            } else {
+                // Window boundary: commit what was prepared, then draw ahead.
+                // Every member still to turn (an early turn still waiting
+                // for its pair, one deferred) turns now if the supply can
+                // take it; the writes are worked out again if not all can.
+                uint16_t turning = g->drive | g->deferred;
+                uint16_t started = claimStarts(g, turning, turning & g->next, boundaryMs, now, &retryMs);
+                GroupWrite w[GROUP_PAIRS_MAX];
+                int n = 0;
+                if (started == g->drive && !g->early) {
+                    n = g->writeCount;
+                    for (int j = 0; j < n; j++) w[j] = g->writes[j];
+                } else {
+                    for (int i = 0; i < g->count; i++) {
+                        if (!(turning & (1u << i))) continue;
+                        const MotorTaskData& p = g->pairs[g->first + i];
+                        PcfPort on = !(started & (1u << i)) ? 0 : (g->next & (1u << i)) ? p.relayMaskB : p.relayMaskA;
+                        if (!on && !(g->moving & (1u << i))) continue; // Off already
+                        groupAddWrite(w, n, p.relayBank, p.relayMaskA | p.relayMaskB, (PcfPort)~on);
+                    }
+                }
+                uint8_t fire = g->windows ? 0 : auxBound(g, AUX_DRILL);
+                if (g->drive || g->rules.mode == GROUP_EXPOSE) fire |= auxBound(g, AUX_STEP);
+                auxWrites(g, fire, false, now, w, n);
+                for (int j = 0; j < n; j++) Io::relaysWrite(w[j].bank, w[j].mask, w[j].value);
+                g->windowStartMs += windowMs;
+                if (now - g->windowStartMs >= windowMs) g->windowStartMs = now; // Fell a window behind
+                for (int i = 0; i < g->count; i++) {
+                    MotorTaskData& p = g->pairs[g->first + i];
+                    if (turning & (1u << i)) {
+                        p.activeRelayA = !(g->next & (1u << i));
+                    } else if (!(g->moving & (1u << i))) {
+                        p.phase = PHASE_DWELL;
+                        p.phaseStartMs = now;
+                        p.dwellMs = windowMs;
+                    }
+                }
+                g->moving &= ~turning;
+                travelling(g, started, now);
+                g->deferred = 0;
+                defer(g, turning & ~started, boundaryMs, now);
+                if (!g->fresh && g->rules.mode == GROUP_EXPOSE) facesScheduled(g, turning & g->next, boundaryMs, now);
+                g->exposed = g->next;
+                g->fresh = false;
+                g->windows++;
+                if (g->writeCount || g->rules.mode == GROUP_EXPOSE) {
+                    Log::printf("Group: Window %lu, exposed 0x%04X.\n", (unsigned long)g->windows, g->exposed);
+                }
+                drawAhead(g);
+                return 0; // Sample the switches right away, in a step of their own
+            }
+
+            if (g->moving) {
+                // One read per input bank, one write per relay bank for
+                // every member that arrived
+                uint8_t banks[GROUP_PAIRS_MAX];
+                PcfPort ports[GROUP_PAIRS_MAX];
+                int nBanks = 0;
+                uint16_t arrived = 0;
+                for (int i = 0; i < g->count; i++) {
+                    if (!(g->moving & (1u << i))) continue;
+                    MotorTaskData& p = g->pairs[g->first + i];
+                    int b = 0;
+                    while (b < nBanks && banks[b] != p.inputBank) b++;
+                    if (b == nBanks) {
+                        banks[nBanks] = p.inputBank;
+                        ports[nBanks++] = Io::inputsRead(p.inputBank);
+                    }
+                    p.inputPort = ports[b];
+                    if (!(p.inputPort & (p.activeRelayA ? p.inputMaskA : p.inputMaskB))) arrived |= 1u << i;
+                }
+                if (arrived) {
+                    relaysOff(g, arrived);
+                    uint32_t left = windowMs - (now - g->windowStartMs);
+                    for (int i = 0; i < g->count; i++) {
+                        if (!(arrived & (1u << i))) continue;
+                        MotorTaskData& p = g->pairs[g->first + i];
+                        p.lastTravelMs = now - p.phaseStartMs;
+                        motorTrackTravel(&p, !p.activeRelayA, p.lastTravelMs);
+                        faceLanded(g, i, now);
+                        p.cycles++;
+                        p.phase = PHASE_DWELL;
+                        p.phaseStartMs = now;
+                        p.dwellMs = left;
+                        Log::printf("Task %d: Input %c (Pin %d) PRESSED.\n", g->first + i, p.activeRelayA ? 'A' : 'B',
+                                    p.activeRelayA ? p.inputA : p.inputB);
+                    }
+                    g->moving &= ~arrived;
+                }
+            }
+
+            // Wake at the boundary, the next early turn, the next poll, the
+            // end of a pulse or when the gate has a start again; the poll
+            // quickens while a member is due at its switch, unless input
+            // edges wake the task themselves
+            uint32_t elapsed = now - g->windowStartMs;
+            uint32_t wait = windowMs - elapsed;
+            for (int c = 0; c < AUX_COUNT; c++) {
+                const GroupAux& a = g->aux[c];
+                if (a.on && a.pulseMs - (now - a.onSinceMs) < wait) wait = a.pulseMs - (now - a.onSinceMs);
+            }
+            for (int i = 0; i < g->count; i++) {
+                const MotorTaskData& p = g->pairs[g->first + i];
+                uint32_t until = wait;
+                if (g->moving & (1u << i)) {
+                    uint32_t est = p.travelEstMs[!p.activeRelayA], moved = now - p.phaseStartMs;
+                    until = INPUT_EDGE_WAKE || !est || moved >= est + INPUT_POLL_MS ? INPUT_POLL_MS
+                            : moved < est                                            ? est - moved
+                                                                                     : FACE_POLL_MS;
+                    if (until > INPUT_POLL_MS) until = INPUT_POLL_MS;
+                } else if (g->deferred & (1u << i)) {
+                    until = retryMs;
+                } else if (g->early & (1u << i)) {
+                    uint32_t at = windowMs - groupLeadMs(g, i);
+                    until = at > elapsed ? at - elapsed : retryMs; // Just back from turning away: at once
+                }
+                if (until < wait) wait = until;
+            }
+            return wait;
+        }
+    }
+};
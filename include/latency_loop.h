@@ -0,0 +1,5 @@
+#pragma once
+
+// Hardware edge-to-stop benchmark (build with -DLATENCY_LOOP_BENCH).
+// Starts the rig task; call at the end of setup().
+void latencyLoopBegin();
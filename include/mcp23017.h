@@ -0,0 +1,37 @@
+#pragma once
+
+#include <stdint.h>
+#include <Wire.h>
+
+// MCP23017 on Wire as a PcfChip (pair_io.h), pins GPA0..7 then GPB0..7. Not thread-safe.
+class Mcp23017 {
+public:
+    explicit Mcp23017(uint8_t address, TwoWire& wire = Wire);
+
+    bool begin(); // false: the chip did not answer
+    void pinMode(uint8_t pin, uint8_t mode); // OUTPUT, INPUT or INPUT_PULLUP
+    bool digitalWrite(uint8_t pin, uint8_t value);
+    uint8_t digitalRead(uint8_t pin);
+
+    uint16_t digitalReadAll(); // GPIO
+    bool digitalWriteAll(uint16_t value); // OLAT; input pins ignore it
+
+    // Interrupt on any change of these pins, compared with their last level
+    bool enableCapture(uint16_t pins);
+    // INTF (pins that interrupted; 0: none pending), INTCAP (the port at
+    // that edge) and GPIO (the port now) in one transaction
+    bool readCapture(uint16_t& flags, uint16_t& captured, uint16_t& port);
+
+    uint8_t getAddress() const { return address_; }
+
+private:
+    bool writePair(uint8_t reg, uint16_t value);
+    bool readRegisters(uint8_t reg, uint8_t* out, uint8_t n);
+
+    TwoWire& wire_;
+    uint8_t address_;
+    bool begun_ = false;
+    uint16_t outputs_ = 0;     // IODIR is the complement
+    uint16_t pullups_ = 0;
+    uint16_t latch_ = 0xFFFF;  // OLAT
+};
@@ -0,0 +1,238 @@
+#pragma once
+
+#include <stdint.h>
+#include "config.h"
+
+// --- Pair Sequencing ---
+// One pair is a target driven by two relays toward two limit switches.
+// The sequence is a small state machine that never blocks: motorStep()
+// does whatever is due and returns how long the caller may sleep before
+// stepping again. MotorTask drives it from FreeRTOS; the host simulator
+// drives it from a virtual clock.
+//
+// Every wait is cancellable: the caller wakes the pair early whenever the
+// enable flag changes (MotorTask blocks on a task notification), and a
+// disabled pair unwinds to Idle from wherever it is, turning its relay off
+// in one port write if it was travelling. An idle, disabled pair has nothing
+// to poll and sleeps until the next notification.
+//
+// A pause holds a pair where it is instead: a travelling pair turns its
+// relay off, and the phase clock stops. Resuming shifts phaseStartMs by the
+// length of the hold, so a dwell finishes its remaining time and a move
+// re-energizes the same relay and keeps waiting for the same switch.
+//
+// Every start (Idle to Travel, or a move re-energized by a resume) first
+// asks the start gate (start_gate.h) for one of the supply's inrush slots.
+// A pair refused one waits in Idle, toward the same side, and asks again
+// when the gate says; the time it entered Idle is when its start fell due.
+enum PairPhase : uint8_t {
+    PHASE_IDLE,   // Relays off; starts the next move as soon as enabled
+    PHASE_TRAVEL, // Active relay on, waiting for its limit switch
+    PHASE_DWELL,  // Both relays off, random delay before switching direction
+};
+
+struct MotorTaskData {
+    int pairIndex;
+    int relayA;
+    int relayB;
+    int inputA;
+    int inputB;
+    bool activeRelayA; // Tracks which relay (A or B) is the target for the next activation
+
+    // Derived from the pins by motorAssignPins(); the switching path only
+    // ever uses these.
+    uint8_t relayBank, inputBank;
+    PcfPort relayMaskA, relayMaskB;
+    PcfPort inputMaskA, inputMaskB;
+    PcfPort inputPort; // Input port as last sampled (LOW = pressed)
+
+    PairPhase phase;
+    uint32_t phaseStartMs; // millis() when the current phase was entered
+    uint32_t dwellMs;      // Random delay chosen for the current dwell
+    uint16_t dwellMinMs;   // Range the next dwell is drawn from; the console
+    uint16_t dwellMaxMs;   // may change it at any time
+    uint32_t lastTravelMs; // Relay-on to switch-pressed time of the last completed move
+    uint16_t travelEstMs[2]; // Running estimate of that time toward A and toward B (0: none yet)
+    int16_t faceErrorMs;   // Group members: how late (negative: early) the last scheduled face came
+    uint32_t cycles;       // Completed moves
+    bool paused;           // Held by a pause: relays off, phase clock stopped
+    uint32_t pausedAtMs;   // millis() when the hold began
+};
+
+// Set the pair's pins and the bank / mask fields derived from them. Both
+// relays (and both inputs) must sit on the same expander.
+void motorAssignPins(MotorTaskData* data, int relayA, int relayB, int inputA, int inputB);
+
+// Reset the sequencing state; pin assignments are left untouched.
+void motorReset(MotorTaskData* data);
+
+// Fold a completed move toward B (or A) into the pair's running estimate:
+// each measurement moves it 1/2^TRAVEL_EST_SHIFT of the way.
+const int TRAVEL_EST_SHIFT = 2;
+inline void motorTrackTravel(MotorTaskData* data, bool sideB, uint32_t ms) {
+    uint16_t& est = data->travelEstMs[sideB];
+    if (ms > 0xFFFF) ms = 0xFFFF;
+    est = est ? (uint16_t)(est + (((int32_t)ms - est) >> TRAVEL_EST_SHIFT)) : (uint16_t)ms;
+}
+
+// Advance the pair. Returns the number of ms until it needs to run again,
+// or MOTOR_WAIT_FOREVER if only a change of the enable or pause flag can
+// give it work. A pause only holds an enabled sequence; a disable still
+// unwinds a held pair to Idle.
+uint32_t motorStep(MotorTaskData* data, bool enabled, bool paused = false);
+
+// --- Pair Engine Template ---
+// The logic behind motorStep(), parameterized on everything it touches so
+// each build picks its own drivers at compile time. Policies are classes
+// with static members only; every call resolves statically and inlines, so
+// the firmware instantiation (pair_policies.h) compiles to the same code as
+// calling the drivers directly.
+//
+//   Io     static void relaysWrite(uint8_t bank, PcfPort mask, PcfPort value)  (HIGH = off)
+//          static PcfPort inputsRead(uint8_t bank)                            (LOW = pressed)
+//   Clock  static uint32_t nowMs()
+//   Rng    static uint32_t dwellMs(int pair, uint32_t minMs, uint32_t maxMs)
+//                                             (random delay before switching direction)
+//          static uint32_t pick(uint32_t n)  (0..n-1; only GroupEngine, group_engine.h, uses it)
+//   Log    static void printf(const char* fmt, ...), println(const char* s)
+//   Supply static int claimStarts(int who, int want, uint32_t dueMs, uint32_t nowMs, uint32_t* retryMs)
+//                                             (motor starts allowed now, as startGateClaim())
+
+#ifdef PAIR_MCP23017
+// Input edges wake the task (pcfInputsInterrupt()); the poll only backs up a lost one
+const bool INPUT_EDGE_WAKE = true;
+const uint32_t INPUT_POLL_MS = 1000;
+#else
+const bool INPUT_EDGE_WAKE = false;
+const uint32_t INPUT_POLL_MS = 50;  // Limit switch sampling period while travelling
+#endif
+const uint32_t MOTOR_WAIT_FOREVER = 0xFFFFFFFF; // Disabled and idle, or paused: block until notified
+
+template <class Io, class Clock, class Rng, class Log, class Supply>
+struct PairEngine {
+    static void reset(MotorTaskData* data) {
+        // Initial state: Assume Relay A should be activated first.
+        data->activeRelayA = true;
+        data->phase = PHASE_IDLE;
+        data->phaseStartMs = Clock::nowMs();
+        data->dwellMs = 0;
+        data->lastTravelMs = 0;
+        data->travelEstMs[0] = data->travelEstMs[1] = 0;
+        data->faceErrorMs = 0;
+        data->cycles = 0;
+        data->inputPort = PCF_ALL_HIGH;
+        data->paused = false;
+        data->pausedAtMs = 0;
+    }
+
+    static uint32_t step(MotorTaskData* data, bool enabled, bool paused) {
+        int pairIdx = data->pairIndex;
+
+        while (true) {
+            // Determine which relay/input pair should be active based on task data
+            char side = data->activeRelayA ? 'A' : 'B';
+            int currentRelay = data->activeRelayA ? data->relayA : data->relayB;
+            int currentInput = data->activeRelayA ? data->inputA : data->inputB;
+            PcfPort pairMask = data->relayMaskA | data->relayMaskB;
+            PcfPort currentMask = data->activeRelayA ? data->relayMaskA : data->relayMaskB;
+            PcfPort inputMask = data->activeRelayA ? data->inputMaskA : data->inputMaskB;
+            uint32_t now = Clock::nowMs();
+
+            if (data->paused != (enabled && paused)) {
+                if (!data->paused) {
+                    if (data->phase == PHASE_TRAVEL) Io::relaysWrite(data->relayBank, currentMask, PCF_ALL_HIGH);
+                    Log::printf("Task %d: Paused.\n", pairIdx);
+                    data->paused = true;
+                    data->pausedAtMs = now;
+                    return MOTOR_WAIT_FOREVER;
+                }
+                // Released, by a resume or a disable: the phase clock skips the hold
+                data->paused = false;
+                data->phaseStartMs += now - data->pausedAtMs;
+                uint32_t retryMs;
+                if (data->phase == PHASE_TRAVEL && enabled && Supply::claimStarts(pairIdx, 1, now, now, &retryMs)) {
+                    Io::relaysWrite(data->relayBank, pairMask, (PcfPort)~currentMask);
+                    Log::printf("Task %d: Resumed. Relay %c (Pin %d) ON again.\n", pairIdx, side, currentRelay);
+                } else if (data->phase == PHASE_TRAVEL && enabled) {
+                    // No start to spare: the move begins again from Idle
+                    Log::printf("Task %d: Resumed. Waiting for a start.\n", pairIdx);
+                    data->phase = PHASE_IDLE;
+                    data->phaseStartMs = now;
+                } else if (data->phase == PHASE_TRAVEL) {
+                    // Disabled while held: the relay is already off
+                    Log::printf("Task %d: Sequence disabled while paused.\n", pairIdx);
+                    data->phase = PHASE_IDLE;
+                    data->phaseStartMs = now;
+                } else if (enabled) {
+                    Log::printf("Task %d: Resumed.\n", pairIdx);
+                }
+                continue;
+            }
+            if (data->paused) return MOTOR_WAIT_FOREVER;
+
+            switch (data->phase) {
+            case PHASE_IDLE: {
+                if (!enabled) {
+                    // Relays are already OFF: every way into Idle turns them off
+                    return MOTOR_WAIT_FOREVER;
+                }
+                uint32_t retryMs;
+                if (!Supply::claimStarts(pairIdx, 1, data->phaseStartMs, now, &retryMs)) {
+                    return retryMs; // The supply's inrush slots are taken
+                }
+                // Opposite OFF and current ON in the same port write: there is
+                // no instant with both energized
+                Io::relaysWrite(data->relayBank, pairMask, (PcfPort)~currentMask);
+                Log::printf("Task %d: Relay %c (Pin %d) ON. Waiting for Input %c (Pin %d)...\n",
+                            pairIdx, side, currentRelay, side, currentInput);
+                data->phase = PHASE_TRAVEL;
+                data->phaseStartMs = now;
+                break; // Sample the switch right away
+            }
+
+            case PHASE_TRAVEL:
+                data->inputPort = Io::inputsRead(data->inputBank);
+                if (!(data->inputPort & inputMask)) {
+                    Log::printf("Task %d: Input %c (Pin %d) PRESSED.\n", pairIdx, side, currentInput);
+                    Io::relaysWrite(data->relayBank, currentMask, PCF_ALL_HIGH);
+                    Log::printf("Task %d: Relay %c (Pin %d) OFF.\n", pairIdx, side, currentRelay);
+                    data->lastTravelMs = now - data->phaseStartMs;
+                    motorTrackTravel(data, !data->activeRelayA, data->lastTravelMs);
+                    data->cycles++;
+
+                    data->dwellMs = Rng::dwellMs(pairIdx, data->dwellMinMs, data->dwellMaxMs);
+                    Log::printf("Task %d: Delaying for %lu ms...\n", pairIdx, (unsigned long)data->dwellMs);
+                    data->phase = PHASE_DWELL;
+                    data->phaseStartMs = Clock::nowMs();
+                    break;
+                }
+                if (!enabled) {
+                    // Cancelled mid-travel: relay off once, then Idle. The next
+                    // enable drives toward the same switch again.
+                    Io::relaysWrite(data->relayBank, currentMask, PCF_ALL_HIGH);
+                    Log::printf("Task %d: Sequence disabled while waiting for input %c.\n", pairIdx, side);
+                    data->phase = PHASE_IDLE;
+                    data->phaseStartMs = now;
+                    break;
+                }
+                return INPUT_POLL_MS;
+
+            case PHASE_DWELL: {
+                uint32_t elapsed = now - data->phaseStartMs;
+                if (!enabled) {
+                    Log::printf("Task %d: Sequence disabled during delay.\n", pairIdx);
+                } else if (elapsed < data->dwellMs) {
+                    return data->dwellMs - elapsed; // A disable or pause notifies the task
+                }
+                data->activeRelayA = !data->activeRelayA;
+                Log::printf("Task %d: Switched direction. Next relay will be %c.\n", pairIdx,
+                            (data->activeRelayA ? 'A' : 'B'));
+                Log::println("----------------------------------------");
+                data->phase = PHASE_IDLE;
+                data->phaseStartMs = now;
+                break;
+            }
+            }
+        }
+    }
+};
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <stdint.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#include "config.h"
+
+// PcfChip, the build's expander. Every backend is shaped like the xreef
+// PCF857x libraries: pinMode() and digitalWrite() before begin() set what
+// begin() loads, then whole-port reads and writes are one transaction each.
+#if defined(PAIR_MCP23017)
+#include "mcp23017.h"
+typedef Mcp23017 PcfChip;
+#define PCF_CHIP_NAME "MCP23017"
+#define PCF_INPUT_MODE INPUT_PULLUP // No quasi-bidirectional pull-up to lean on
+#elif defined(PAIR_I2C_ASYNC)
+#include "pcf857x_async.h"
+typedef Pcf857xAsync PcfChip;
+#ifdef PAIR_PCF8575
+#define PCF_CHIP_NAME "PCF8575"
+#else
+#define PCF_CHIP_NAME "PCF8574"
+#endif
+#define PCF_INPUT_MODE INPUT
+#elif defined(PAIR_PCF8575)
+#include <PCF8575.h>
+typedef PCF8575 PcfChip;
+#define PCF_CHIP_NAME "PCF8575"
+#define PCF_INPUT_MODE INPUT
+#else
+#include <PCF8574.h>
+typedef PCF8574 PcfChip;
+#define PCF_CHIP_NAME "PCF8574"
+#define PCF_INPUT_MODE INPUT
+#endif
+
+// Builds where an input edge interrupts (pcfInputsInterrupt())
+#if defined(PAIR_MCP23017) || defined(PAIR_NATIVE_GPIO)
+#define PAIR_INPUT_EDGES
+#endif
+
+// --- I2C Layer ---
+// Both expanders share one bus; every access goes through i2cMutex.
+// PAIR_I2C_ASYNC: the driver queues and orders transactions itself, so only
+// relay writes take i2cMutex, and only to update the latch and queue it.
+extern PcfChip pcf_relays;
+extern PcfChip pcf_inputs;
+extern SemaphoreHandle_t i2cMutex;
+
+// Bring up the bus: Wire, or the queued driver under PAIR_I2C_ASYNC. Before
+// any chip's begin().
+bool pcfBeginBus();
+
+// --- Expander Banks ---
+// Pin numbers are global: pin n is bit n % PCF_PINS of bank n / PCF_PINS.
+// Bank 0 is pcf_relays / pcf_inputs; larger lanes add one relay + one input
+// chip per bank (four more pairs each, eight with PCF8575s), up to
+// PCF_MAX_BANKS (config.h).
+// PAIR_NATIVE_GPIO: bank 0 is ESP32 GPIOs instead (config.h), pcf_relays and
+// pcf_inputs stay unused, and nothing on bank 0 takes i2cMutex.
+#ifdef PAIR_NATIVE_GPIO
+const int PCF_GPIO_BANKS = 1; // Banks below this are GPIOs, not expanders
+#else
+const int PCF_GPIO_BANKS = 0;
+#endif
+#define PCF_BANK(pin) ((uint8_t)((pin) / PCF_PINS))
+#define PCF_BIT(pin)  ((uint8_t)((pin) % PCF_PINS))
+
+bool pcfAddBank(uint8_t relayAddress, uint8_t inputAddress); // Call before any task starts
+void pcfResetBanks(); // Back to bank 0 alone, its chips as constructed (host harnesses)
+int pcfBankCount();
+PcfChip& pcfRelayBank(int bank);
+PcfChip& pcfInputBank(int bank);
+// begin() both chips of a bank, after their pinMode()s. A GPIO bank drives
+// every relay GPIO HIGH (OFF), then makes them outputs and the inputs inputs.
+bool pcfBeginBank(int bank);
+
+void pcfWriteRelay(uint8_t pin, uint8_t value);
+uint8_t pcfReadInput(uint8_t pin);
+
+// Whole-port access: one transaction regardless of how many pins change
+// (PCF_PINS / 8 data bytes). Bit n of the result is the level of input pin n.
+// On a GPIO bank a write is two register stores, every relay it turns off
+// then every relay it turns on, and a read is two register loads.
+PcfPort pcfReadInputs(uint8_t bank = 0);
+// Drive every relay pin in mask to its bit in value (HIGH = OFF).
+void pcfWriteRelays(PcfPort mask, PcfPort value, uint8_t bank = 0);
+// Last port written to a relay bank (PCF_ALL_HIGH for a bank that does not
+// exist). Read without the mutex: exact for the bits the caller itself drives.
+PcfPort pcfRelayLatch(uint8_t bank);
+
+// Configure every relay pin as OUTPUT driven HIGH (OFF) and every input pin
+// as PCF_INPUT_MODE. Call with i2cMutex held, before pcf_*.begin().
+void pcfConfigurePins();
+
+// --- Input Edge Capture ---
+// PAIR_INPUT_EDGES builds only; elsewhere these do nothing and the tasks poll.
+// pcfInputsInterrupt() wakes every task registered with pcfInputsWake().
+//
+// MCP23017: the input chips interrupt on any change of the pins given to
+// pcfInputsCapture(), and pcfInputsInterrupt() is the EXPANDER_INT_GPIO
+// handler. It timestamps the edge; pcfReadInputs() then takes flags,
+// capture and port in one burst: a pin captured LOW at the edge reads LOW
+// for INPUT_CAPTURE_HOLD_MS even if it has bounced open since, and the trace
+// records the capture at the handler's timestamp.
+//
+// Native GPIO: pcfInputsCapture() attaches pcfInputsInterrupt() to every
+// edge of those bank 0 GPIOs. The handler itself turns off, in one store,
+// every relay whose switch (pcfStopOnInput()) it reads closed; that switch
+// then reads closed until its relay is switched on again, so the task that
+// wakes finds the arrival the handler acted on.
+// The handler is IRAM-resident and touches only DRAM, so this stop is not
+// delayed by a flash write (an NVS save stalls every task meanwhile); an
+// expander build's stop is a task's bus write and waits the write out.
+const uint32_t INPUT_CAPTURE_HOLD_MS = 20;
+const int INPUT_WAKE_MAX = PAIR_COUNT + 1; // Every MotorTask and the GroupTask
+
+bool pcfInputsCapture(uint8_t bank, PcfPort pins); // After begin()
+void pcfInputsWake(TaskHandle_t task);
+void pcfInputsInterrupt();
+// Relay pin the handler turns off when input pin reads LOW (GPIO bank only;
+// motorAssignPins() registers both sides of every pair).
+void pcfStopOnInput(int inputPin, int relayPin);
+// Read every bank the last interrupt flagged that no task has read since.
+// Until each is read the shared INT line stays asserted and no further edge
+// can be signalled, so every woken task calls this after its step.
+void pcfInputsService();
+
+void stopRelay(int relayPin);
+void startRelay(int relayPin);
+bool isInputPressed(int inputPin);
@@ -0,0 +1,65 @@
+#pragma once
+
+// Policies for PairEngine (pair_engine.h): the firmware's real drivers, plus
+// the no-op logger for the minimal-latency build and for host harnesses
+// nobody reads the log of.
+
+#include <Arduino.h>
+#include "config.h"
+#include "pair_engine.h"
+#include "pair_io.h"
+#include "start_gate.h"
+#include "trace.h"
+
+struct PcfIo {
+    static void relaysWrite(uint8_t bank, PcfPort mask, PcfPort value) { pcfWriteRelays(mask, value, bank); }
+    static PcfPort inputsRead(uint8_t bank) { return pcfReadInputs(bank); }
+};
+
+struct MillisClock {
+    static uint32_t nowMs() { return millis(); }
+};
+
+// Arduino random() over minMs..maxMs inclusive (or 0..n-1 for a group);
+// every draw goes into the trace so a replay can repeat it.
+struct TracedRandom {
+    static uint32_t dwellMs(int pair, uint32_t minMs, uint32_t maxMs) {
+        uint32_t ms = random(minMs, maxMs + 1);
+        traceRecord(TRACE_DWELL, pair, ms);
+        return ms;
+    }
+    // A group's next selection
+    static uint32_t pick(uint32_t n) {
+        uint32_t i = random(0, n);
+        traceRecord(TRACE_PICK, 0, i);
+        return i;
+    }
+};
+
+// The shared supply's inrush slots (start_gate.h)
+struct GatedStarts {
+    static int claimStarts(int who, int want, uint32_t dueMs, uint32_t nowMs, uint32_t* retryMs) {
+        return startGateClaim(who, want, dueMs, nowMs, retryMs);
+    }
+};
+
+struct SerialLog {
+    template <typename... Args>
+    static void printf(const char* fmt, Args... args) { Serial.printf(fmt, args...); }
+    static void println(const char* s) { Serial.println(s); }
+};
+
+struct NullLog {
+    template <typename... Args>
+    static void printf(const char*, Args...) {}
+    static void println(const char*) {}
+};
+
+// The minimal-latency build drops the per-move log at compile time.
+#ifdef PAIR_MIN_LATENCY
+typedef NullLog FirmwareLog;
+#else
+typedef SerialLog FirmwareLog;
+#endif
+
+typedef PairEngine<PcfIo, MillisClock, TracedRandom, FirmwareLog, GatedStarts> FirmwareEngine;
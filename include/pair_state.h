@@ -0,0 +1,86 @@
+#pragma once
+
+#include <stdint.h>
+#include "config.h"
+#include "pair_engine.h"
+
+// --- Pair State Store ---
+// The one place observers (serial status, a future web UI, metrics) read a
+// pair or the group from. Only the control path writes it: each MotorTask
+// publishes its pair after every step, the group's task the group and its
+// members. Every pair, and the group, has its own seqlock, so a reader on
+// either core gets a consistent snapshot in a handful of loads, without a
+// lock and without touching the bus; the writer never waits for readers.
+
+#ifndef PAIR_STATE_SLOTS
+#define PAIR_STATE_SLOTS PAIR_COUNT // Host builds raise it for the 64-pair harnesses
+#endif
+
+enum : uint8_t {
+    PAIR_RELAY_A = 0x01, // relays: energized as last committed to the expander
+    PAIR_RELAY_B = 0x02,
+    PAIR_INPUT_A = 0x01, // inputs: pressed as last sampled by the engine
+    PAIR_INPUT_B = 0x02,
+};
+
+struct PairState {
+    uint32_t phaseStartMs; // millis() when the current phase was entered
+    uint32_t phaseMs;      // Expected length: the dwell drawn, or the last travel time; 0 in Idle
+    uint32_t cycles;       // Completed moves
+    uint32_t pausedAtMs;   // millis() when the hold began, if paused
+    uint8_t relays;        // PAIR_RELAY_*
+    uint8_t inputs;        // PAIR_INPUT_*
+    PairPhase phase;
+    bool sideB;            // The current (or next) move drives relay B
+    bool paused;           // Held: the phase clock is stopped
+};
+
+// Control path only, one writer per pair.
+void pairStatePublish(const MotorTaskData* data);
+
+// Copy the latest snapshot of a pair. False if the pair has no slot or has
+// never been published.
+bool pairStateRead(int pair, PairState* out);
+
+// Time left in the snapshot's phase as of nowMs (0 once it has run over).
+// Frozen while the pair is paused.
+uint32_t pairStateRemainingMs(const PairState& state, uint32_t nowMs);
+
+// --- Group State ---
+// The exposure or ripple group (group_engine.h) as of its task's last step.
+struct GroupMemberState {
+    uint16_t travelToBMs; // Running estimate; 0: not measured yet, turns at the boundary
+    uint16_t leadMs;      // How far ahead of its boundary it turns to B
+    int16_t faceErrorMs;  // How late (negative: early) its last scheduled face came
+};
+
+struct GroupAuxState {
+    uint8_t event; // AuxEvent; AUX_OFF: unbound
+    bool on;
+    uint16_t pulseMs;
+};
+
+struct GroupState {
+    uint8_t first;
+    uint8_t count;          // 0: no group
+    uint8_t mode;           // GroupMode, and the GroupRules below
+    uint8_t k, gap, holdSteps;
+    bool noRepeat;
+    bool running;
+    uint16_t windowMs;
+    uint16_t selectionCount;
+    uint32_t windows;       // Windows (ripple: steps) since the last enable
+    uint16_t exposed;       // Selection in progress (ripple: members sent to B)
+    uint16_t faceSpreadMs;  // First to last face of the latest window whose faces all landed...
+    uint32_t faceWindows;   // ...and how many have
+    GroupAuxState aux[AUX_COUNT];
+    GroupMemberState members[GROUP_PAIRS_MAX];
+};
+
+struct GroupData;
+
+// The group's task only.
+void groupStatePublish(const GroupData* g);
+
+// Copy the latest snapshot. False if the group's task has not published yet.
+bool groupStateRead(GroupState* out);
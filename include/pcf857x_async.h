@@ -0,0 +1,58 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <esp_idf_version.h>
+#if ESP_IDF_VERSION < ESP_IDF_VERSION_VAL(5, 2, 0)
+#error "PAIR_I2C_ASYNC needs ESP-IDF 5.2+ (Arduino-ESP32 3.x): build [env:nodemcu-32s-i2c-async], which pins it"
+#endif
+#include <driver/i2c_master.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include "config.h"
+
+// PCF8574 / PCF8575 on ESP-IDF's queued i2c_master driver as a PcfChip (pair_io.h). Writes need the caller's lock.
+class Pcf857xAsync {
+public:
+    // The bus every chip is added to; call once, before any begin()
+    static bool beginBus(int sda, int scl);
+    // Block until every queued transaction is done
+    static bool flush();
+    // Queued writes a chip did not acknowledge, since boot
+    static uint32_t writesFailed();
+
+    explicit Pcf857xAsync(uint8_t address);
+    ~Pcf857xAsync(); // Only with nothing of its own queued
+
+    bool begin(); // false: the chip did not answer
+    void pinMode(uint8_t pin, uint8_t mode);
+    bool digitalWrite(uint8_t pin, uint8_t value);
+    uint8_t digitalRead(uint8_t pin);
+
+    PcfPort digitalReadAll(); // PCF_ALL_HIGH if the chip did not answer
+    bool digitalWriteAll(PcfPort value); // Input pins stay HIGH
+
+    uint8_t getAddress() const { return address_; }
+
+private:
+    static const int BYTES = PCF_PINS / 8;
+    static const int RING = I2C_QUEUE_DEPTH + 2;
+
+    static bool onWritten(i2c_master_dev_handle_t dev, const i2c_master_event_data_t* evt, void* arg);
+    static bool onRead(i2c_master_dev_handle_t dev, const i2c_master_event_data_t* evt, void* arg);
+    i2c_master_dev_handle_t addDevice(i2c_master_callback_t done);
+
+    uint8_t address_;
+    i2c_master_dev_handle_t writer_ = nullptr;
+    i2c_master_dev_handle_t reader_ = nullptr;
+    SemaphoreHandle_t readLock_ = nullptr;
+    SemaphoreHandle_t readDone_ = nullptr;
+    volatile bool readAck_ = false;          // The last completed read's
+    uint32_t readsQueued_ = 0;               // Under readLock_
+    std::atomic<uint32_t> readsDone_{0};     // Counted by onRead()
+    uint8_t readBuf_[BYTES];
+    PcfPort outputs_ = 0;
+    PcfPort latch_ = PCF_ALL_HIGH;
+    uint8_t ring_[RING][BYTES];
+    uint8_t next_ = 0;
+};
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <stdint.h>
+#include "config.h"
+
+// --- Pin Map Checks and Masks ---
+// Everything here is evaluated by the compiler from RELAY_PINS / INPUT_PINS:
+// a bad map fails the build instead of cross-wiring motors, and the masks
+// the switching path needs cost nothing at run time. Pin n of a lane lives
+// on bank n / PCF_PINS, bit n % PCF_PINS (see pair_io.h).
+
+constexpr PcfPort pinMask(int pin) { return (PcfPort)(1u << (pin % PCF_PINS)); }
+constexpr uint8_t pinBank(int pin) { return (uint8_t)(pin / PCF_PINS); }
+
+// C++11 constexpr: one return statement each, so the loops are recursion.
+constexpr bool pinsInRange(const int* pins, int n, int limit) {
+    return n == 0 || (pins[n - 1] >= 0 && pins[n - 1] < limit && pinsInRange(pins, n - 1, limit));
+}
+
+constexpr bool pinAbsent(const int* pins, int n, int pin) {
+    return n == 0 || (pins[n - 1] != pin && pinAbsent(pins, n - 1, pin));
+}
+
+constexpr bool pinsUnique(const int* pins, int n) {
+    return n <= 1 || (pinAbsent(pins, n - 1, pins[n - 1]) && pinsUnique(pins, n - 1));
+}
+
+// Both sides of every pair on one chip, so a pair switches in one port write.
+constexpr bool pairsShareBank(const int* pins, int pairs) {
+    return pairs == 0 ||
+           (pinBank(pins[pairs * 2 - 2]) == pinBank(pins[pairs * 2 - 1]) && pairsShareBank(pins, pairs - 1));
+}
+
+constexpr bool pinsDisjoint(const int* pins, int n, const int* others, int m) {
+    return n == 0 || (pinAbsent(others, m, pins[n - 1]) && pinsDisjoint(pins, n - 1, others, m));
+}
+
+constexpr PcfPort pinsMask(const int* pins, int n, int bank) {
+    return n == 0 ? 0 : (PcfPort)((pinBank(pins[n - 1]) == bank ? pinMask(pins[n - 1]) : 0) | pinsMask(pins, n - 1, bank));
+}
+
+// Native GPIO lane: the GPIO behind each listed pin on bank 0 (further
+// banks are expanders, so their pins pass)
+constexpr bool gpiosInRange(const int* pins, int n, const int* gpios, int limit) {
+    return n == 0 || ((pins[n - 1] >= PCF_PINS || (gpios[pins[n - 1]] >= 0 && gpios[pins[n - 1]] < limit)) &&
+                      gpiosInRange(pins, n - 1, gpios, limit));
+}
+
+constexpr bool gpioAbsent(const int* pins, int n, const int* gpios, int gpio) {
+    return n == 0 || ((pins[n - 1] >= PCF_PINS || gpios[pins[n - 1]] != gpio) && gpioAbsent(pins, n - 1, gpios, gpio));
+}
+
+constexpr bool gpiosUnique(const int* pins, int n, const int* gpios) {
+    return n <= 1 || ((pins[n - 1] >= PCF_PINS || gpioAbsent(pins, n - 1, gpios, gpios[pins[n - 1]])) &&
+                      gpiosUnique(pins, n - 1, gpios));
+}
+
+constexpr bool gpiosDisjoint(const int* pins, int n, const int* gpios, const int* others, int m, const int* otherGpios) {
+    return n == 0 || ((pins[n - 1] >= PCF_PINS || gpioAbsent(others, m, otherGpios, gpios[pins[n - 1]])) &&
+                      gpiosDisjoint(pins, n - 1, gpios, others, m, otherGpios));
+}
+
+static_assert(PAIR_COUNT > 0, "PAIR_COUNT must be at least 1");
+static_assert(pinsInRange(RELAY_PINS, PAIR_COUNT * 2, PCF_PINS * PCF_MAX_BANKS),
+              "RELAY_PINS: pin past the last relay expander (0..PCF_PINS * PCF_MAX_BANKS - 1)");
+static_assert(pinsInRange(INPUT_PINS, PAIR_COUNT * 2, PCF_PINS * PCF_MAX_BANKS),
+              "INPUT_PINS: pin past the last input expander (0..PCF_PINS * PCF_MAX_BANKS - 1)");
+static_assert(pinsUnique(RELAY_PINS, PAIR_COUNT * 2), "RELAY_PINS: a relay is shared by two motors or by A and B");
+static_assert(pinsUnique(INPUT_PINS, PAIR_COUNT * 2), "INPUT_PINS: a limit switch is shared by two motors or by A and B");
+static_assert(pairsShareBank(RELAY_PINS, PAIR_COUNT), "RELAY_PINS: relays A and B of a pair on different expanders");
+static_assert(pairsShareBank(INPUT_PINS, PAIR_COUNT), "INPUT_PINS: inputs A and B of a pair on different expanders");
+static_assert(pinsInRange(AUX_PINS, AUX_COUNT, PCF_PINS * PCF_MAX_BANKS),
+              "AUX_PINS: pin past the last relay expander (0..PCF_PINS * PCF_MAX_BANKS - 1)");
+static_assert(pinsUnique(AUX_PINS, AUX_COUNT), "AUX_PINS: an aux output is listed twice");
+static_assert(pinsDisjoint(AUX_PINS, AUX_COUNT, RELAY_PINS, PAIR_COUNT * 2), "AUX_PINS: an aux output is a motor relay");
+
+#if defined(PAIR_I2C_ASYNC) && (defined(PAIR_MCP23017) || defined(PAIR_NATIVE_GPIO))
+#error "PAIR_I2C_ASYNC: the queued driver is for PCF8574 / PCF8575 banks; MCP23017 and GPIO builds keep Wire"
+#endif
+
+#ifdef PAIR_NATIVE_GPIO
+#if defined(PAIR_MCP23017) || defined(PAIR_PCF8575) || defined(LATENCY_LOOP_BENCH)
+#error "PAIR_NATIVE_GPIO: bank 0 is eight GPIOs per side, not an expander; use 8-pin PCF8574 banks and no loop-back rig"
+#endif
+static_assert(gpiosInRange(RELAY_PINS, PAIR_COUNT * 2, LANE_RELAY_GPIOS, 32), "LANE_RELAY_GPIOS: a relay not on GPIO 0..31");
+static_assert(gpiosInRange(AUX_PINS, AUX_COUNT, LANE_RELAY_GPIOS, 32), "LANE_RELAY_GPIOS: an aux output not on GPIO 0..31");
+static_assert(gpiosInRange(INPUT_PINS, PAIR_COUNT * 2, LANE_INPUT_GPIOS, 40), "LANE_INPUT_GPIOS: an input not on GPIO 0..39");
+static_assert(gpiosUnique(RELAY_PINS, PAIR_COUNT * 2, LANE_RELAY_GPIOS), "LANE_RELAY_GPIOS: two relays on one GPIO");
+static_assert(gpiosUnique(INPUT_PINS, PAIR_COUNT * 2, LANE_INPUT_GPIOS), "LANE_INPUT_GPIOS: two inputs on one GPIO");
+static_assert(gpiosDisjoint(AUX_PINS, AUX_COUNT, LANE_RELAY_GPIOS, RELAY_PINS, PAIR_COUNT * 2, LANE_RELAY_GPIOS),
+              "LANE_RELAY_GPIOS: an aux output shares a GPIO with a relay");
+static_assert(gpiosDisjoint(INPUT_PINS, PAIR_COUNT * 2, LANE_INPUT_GPIOS, RELAY_PINS, PAIR_COUNT * 2, LANE_RELAY_GPIOS) &&
+              gpiosDisjoint(INPUT_PINS, PAIR_COUNT * 2, LANE_INPUT_GPIOS, AUX_PINS, AUX_COUNT, LANE_RELAY_GPIOS),
+              "LANE_INPUT_GPIOS: an input shares a GPIO with a relay output");
+#endif
+
+// Every relay / input pin the lane uses on bank 0.
+const PcfPort RELAY_PORT_MASK = pinsMask(RELAY_PINS, PAIR_COUNT * 2, 0);
+const PcfPort INPUT_PORT_MASK = pinsMask(INPUT_PINS, PAIR_COUNT * 2, 0);
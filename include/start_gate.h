@@ -0,0 +1,35 @@
+#pragma once
+
+#include <stdint.h>
+#include "config.h"
+#include "pair_state.h"
+
+// --- Start Gate ---
+// Every motor start draws inrush current from the shared supply, and enough
+// of them at once brown the ESP32 out. The gate lets at most cap starts
+// happen within any windowMs (START_CAP / START_WINDOW_MS in config.h); a
+// start that would break the cap waits, by the least it has to.
+//
+// Whoever asks (a pair's MotorTask, or the group's task for all its
+// members) states when its start fell due. Starts that cannot all go at
+// once are granted earliest-due first: a claimant that has to wait leaves
+// its due time behind, and later-due claims leave the slots it is waiting
+// for alone until it asks again. A claim not renewed within two windows is
+// forgotten, so a task that stopped asking never holds the others up.
+//
+// Every call takes the gate's spinlock: claims come from both cores.
+
+const int START_CAP_MAX = 16;                       // Starts a window can hold
+const int START_GATE_GROUP = PAIR_STATE_SLOTS;      // who: the group's task
+const int START_GATE_CLAIMANTS = PAIR_STATE_SLOTS + 1;
+
+// cap 0 lifts the limit. Forgets every start and claim.
+void startGateConfigure(int cap, uint32_t windowMs);
+void startGateReset();
+int startGateCap();
+uint32_t startGateWindowMs();
+
+// Up to want starts for who, due since dueMs, at nowMs. Returns how many may
+// go now (0..want); the caller makes them at once and asks again for the
+// rest after *retryMs.
+int startGateClaim(int who, int want, uint32_t dueMs, uint32_t nowMs, uint32_t* retryMs);
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <stdint.h>
+#include "config.h"
+
+// --- Golden Trace ---
+// A compact in-RAM record of everything that decides the relay timeline:
+// input edges as the firmware observed them, serial commands, the random
+// dwell each pair drew, group configurations and the selections they drew,
+// task starts, and every relay latch change as it was committed to the
+// expander. Timestamps are micros().
+//
+// Recording starts at boot and stops when the buffer is full, so a dump is
+// always a complete run from a known state. 'd' on the serial console dumps
+// it; 't' re-arms it (sequence disabled, every pair idle, nothing paused; a
+// configured group and its aux bindings are recorded again right after
+// TRACE_BOOT). The host replay tool ([env:replay]) feeds a captured dump
+// back through the engine.
+
+#ifndef PAIR_TRACE_CAPACITY
+#define PAIR_TRACE_CAPACITY 4096 // Records (8 bytes each)
+#endif
+
+enum TraceType : uint8_t {
+    TRACE_BOOT = 'B',    // arg: pair count, value: pairs starting on side B (bit per pair)
+    TRACE_TASK = 'S',    // arg: pair, MotorTask started
+    TRACE_COMMAND = 'C', // arg: command byte
+    TRACE_INPUT = 'I',   // arg: input pin, value: level read
+    TRACE_RELAY = 'R',   // arg: relay pin, value: level written (LOW = on)
+    TRACE_DWELL = 'D',   // arg: pair, value: dwell ms drawn
+    TRACE_EPOCH = 'E',   // value: number of micros() wraps so far
+    TRACE_PAUSE = 'H',   // arg: pair (0xFF: every pair), value: 1 hold, 0 release
+    TRACE_GROUP = 'G',   // Group configured, four records: arg 0 value first | last << 8,
+                         // arg 1 value k | gap << 4 | noRepeat << 7, arg 2 value window (stagger)
+                         // ms, arg 3 value mode | hold steps << 8 (groupTrace())
+    TRACE_PICK = 'K',    // value: index of the group's next selection among its candidates
+    TRACE_AUX = 'A',     // arg: aux channel bound, value: pulse ms | event << 14 (groupTraceAux())
+};
+
+struct TraceRecord {
+    uint32_t us;
+    uint8_t type;
+    uint8_t arg;
+    uint16_t value;
+};
+
+// Clear the buffer and record TRACE_BOOT.
+void traceBegin(uint8_t pairs, uint16_t sideBMask);
+
+void traceRecord(uint8_t type, uint8_t arg, uint16_t value);
+
+// Edge detection for inputs: only level changes are recorded.
+void traceInputs(uint8_t bank, PcfPort port);
+// The same for a port captured in hardware at an earlier micros(). Records
+// stay in time order: us is moved up to the last record's if it is behind.
+void traceInputsAt(uint8_t bank, PcfPort port, uint32_t us);
+
+// Record every relay bit of a bank that differs between before and after.
+void traceRelays(uint8_t bank, PcfPort before, PcfPort after);
+
+// Call at least once per micros() wrap (~71 min) so long idle gaps keep
+// their place on the timeline. loop() does.
+void traceTick();
+
+// Print the buffer as "T <us> <type> <arg> <value>" lines between
+// "TRACE BEGIN" and "TRACE END".
+void traceDump();
+
+uint32_t traceCount();
+bool traceFull();
+const TraceRecord* traceRecords(); // traceCount() complete records
@@ -0,0 +1,164 @@
+#include "Arduino.h"
+#include "esp_timer.h"
+#include "sim_clock.h"
+#include "sim_world.h"
+#include "soc/soc.h"
+
+#include <stdarg.h>
+#include <unistd.h>
+#include <deque>
+#include <mutex>
+#include <random>
+#include <thread>
+
+HardwareSerial Serial;
+
+namespace {
+
+std::mutex outMutex;
+std::mutex rxMutex;
+std::deque<char> rxQueue;
+std::mt19937 rng(0);
+std::function<long(long, long)> randomHook;
+
+void stdinReader() {
+    char c;
+    while (::read(STDIN_FILENO, &c, 1) == 1) {
+        {
+            std::lock_guard<std::mutex> lock(rxMutex);
+            rxQueue.push_back(c);
+        }
+        Serial.rxNotify();
+    }
+}
+
+} // namespace
+
+// --- Time ---
+unsigned long millis() { return (unsigned long)(sim::clock().nowNs() / 1000000ULL); }
+unsigned long micros() { return (unsigned long)sim::nowUs(); }
+int64_t esp_timer_get_time() { return (int64_t)sim::nowUs(); }
+void delay(uint32_t ms) { sim::clock().sleepNs((uint64_t)ms * 1000000ULL); }
+
+// --- Random ---
+long random(long max) { return max > 0 ? random(0, max) : 0; }
+
+long random(long min, long max) {
+    if (min >= max) return min;
+    if (randomHook) return randomHook(min, max);
+    std::uniform_int_distribution<long> d(min, max - 1); // Arduino: upper bound exclusive
+    return d(rng);
+}
+
+void randomSeed(unsigned long seed) { rng.seed((uint32_t)seed); }
+
+void simSetRandomHook(std::function<long(long, long)> hook) { randomHook = hook; }
+
+int analogRead(uint8_t) { return (int)(sim::world().noise() & 0x0FFF); }
+
+// --- GPIO ---
+void pinMode(uint8_t, uint8_t) {}
+void attachInterrupt(uint8_t pin, void (*)(), int) { sim::world().watchGpio(pin); }
+
+uint32_t simRegRead(uint32_t reg) { return sim::world().readRegister(reg); }
+void simRegWrite(uint32_t reg, uint32_t value) { sim::world().writeRegister(reg, value); }
+
+// --- Serial ---
+void HardwareSerial::begin(unsigned long) {
+    static bool started = false;
+    if (!started) {
+        started = true;
+        std::thread(stdinReader).detach();
+    }
+}
+
+int HardwareSerial::available() {
+    std::lock_guard<std::mutex> lock(rxMutex);
+    return (int)rxQueue.size();
+}
+
+int HardwareSerial::read() {
+    std::lock_guard<std::mutex> lock(rxMutex);
+    if (rxQueue.empty()) return -1;
+    char c = rxQueue.front();
+    rxQueue.pop_front();
+    return (unsigned char)c;
+}
+
+void HardwareSerial::inject(const char* s) {
+    {
+        std::lock_guard<std::mutex> lock(rxMutex);
+        while (*s) rxQueue.push_back(*s++);
+    }
+    rxNotify();
+}
+
+void HardwareSerial::onReceive(std::function<void()> cb) {
+    std::lock_guard<std::mutex> lock(rxMutex);
+    onReceive_ = cb;
+}
+
+void HardwareSerial::rxNotify() {
+    std::function<void()> cb;
+    {
+        std::lock_guard<std::mutex> lock(rxMutex);
+        cb = onReceive_;
+    }
+    if (cb) cb();
+}
+
+void HardwareSerial::modelTx(unsigned long baud, uint32_t fifoBytes) {
+    std::lock_guard<std::mutex> lock(outMutex);
+    txByteNs_ = baud ? 10000000000ULL / baud : 0; // 8N1: ten bit times per byte
+    txFifo_ = fifoBytes ? fifoBytes : 1;
+    txEmptyNs_ = 0;
+}
+
+// Caller holds outMutex, like the driver's lock on the ESP32, so a blocked
+// writer holds up every other one.
+void HardwareSerial::txWait(size_t n) {
+    if (!txByteNs_) return;
+    uint64_t now = sim::clock().nowNs();
+    if (txEmptyNs_ < now) txEmptyNs_ = now;
+    uint64_t queued = (txEmptyNs_ - now + txByteNs_ - 1) / txByteNs_;
+    txEmptyNs_ += n * txByteNs_;
+    if (queued + n > txFifo_) sim::clock().sleepNs((queued + n - txFifo_) * txByteNs_);
+}
+
+size_t HardwareSerial::print(const char* s) {
+    std::lock_guard<std::mutex> lock(outMutex);
+    size_t n = strlen(s);
+    written_ += n;
+    txWait(n);
+    if (muted_) return n;
+    return fputs(s, stdout) >= 0 ? n : 0;
+}
+
+size_t HardwareSerial::write(const uint8_t* data, size_t n) {
+    std::lock_guard<std::mutex> lock(outMutex);
+    written_ += n;
+    txWait(n);
+    if (muted_) return n;
+    n = fwrite(data, 1, n, stdout);
+    fflush(stdout);
+    return n;
+}
+
+size_t HardwareSerial::print(long v) { return printf("%ld", v); }
+
+size_t HardwareSerial::println(const char* s) { return printf("%s\n", s); }
+
+size_t HardwareSerial::println(long v) { return printf("%ld\n", v); }
+
+size_t HardwareSerial::printf(const char* fmt, ...) {
+    std::lock_guard<std::mutex> lock(outMutex);
+    va_list ap;
+    va_start(ap, fmt);
+    int n = muted_ ? vsnprintf(nullptr, 0, fmt, ap) : vprintf(fmt, ap);
+    va_end(ap);
+    if (n <= 0) return 0;
+    written_ += n;
+    txWait(n);
+    if (!muted_) fflush(stdout);
+    return (size_t)n;
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+// Host stand-in for the subset of the Arduino-ESP32 core the firmware uses.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <functional>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#define HIGH 0x1
+#define LOW  0x0
+
+#define INPUT  0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+
+#define RISING  0x01
+#define FALLING 0x02
+#define CHANGE  0x03
+
+#define IRAM_ATTR
+
+typedef uint8_t byte;
+
+unsigned long millis();
+unsigned long micros();
+void delay(uint32_t ms);
+
+long random(long max);
+long random(long min, long max);
+void randomSeed(unsigned long seed);
+// Host only: answer random(min, max) from a script instead of the PRNG
+// (nullptr restores the PRNG).
+void simSetRandomHook(std::function<long(long min, long max)> hook);
+int analogRead(uint8_t pin);
+
+// ESP32 GPIOs: levels go through REG_READ / REG_WRITE (soc/soc.h) to the
+// ports sim::World wires to them. attachInterrupt() marks the pin for
+// World::sampleInterrupts(); harnesses call the handler themselves
+// (pair_sim.cpp: pcfInputsInterrupt()).
+void pinMode(uint8_t pin, uint8_t mode);
+#define digitalPinToInterrupt(pin) (pin)
+void attachInterrupt(uint8_t interrupt, void (*handler)(), int mode);
+
+class HardwareSerial {
+public:
+    void begin(unsigned long baud);
+    explicit operator bool() const { return true; }
+
+    int available();
+    int read();
+    size_t write(const uint8_t* data, size_t n);
+
+    // Called from the RX side whenever bytes arrive (the ESP32 core calls it
+    // from the UART driver's event task).
+    void onReceive(std::function<void()> cb);
+    void setRxTimeout(uint8_t symbols) { (void)symbols; }
+
+    size_t print(const char* s);
+    size_t print(long v);
+    size_t println(const char* s = "");
+    size_t println(long v);
+    size_t printf(const char* fmt, ...) __attribute__((format(printf, 2, 3)));
+
+    // Host only: queue bytes as if they had arrived on RX.
+    void inject(const char* s);
+    // Host only: drop all output (long simulation runs).
+    void mute(bool muted) { muted_ = muted; }
+    // Host only: bytes the firmware has written, muted or not.
+    uint64_t bytesWritten() const { return written_; }
+    // Host only: make writes cost what they do on the ESP32 UART with
+    // Arduino's default of no TX ring buffer: bytes drain from a FIFO of
+    // fifoBytes at baud / 10 bytes per second, and a write blocks the caller
+    // (on the sim clock) until its tail fits. baud 0 makes writes free again.
+    void modelTx(unsigned long baud, uint32_t fifoBytes = 128);
+
+    // Host only: the registered onReceive() callback (stdin reader, inject()).
+    void rxNotify();
+
+private:
+    void txWait(size_t n);
+
+    std::function<void()> onReceive_;
+
+    bool muted_ = false;
+    uint64_t written_ = 0;
+    uint64_t txByteNs_ = 0;  // 0: writes cost nothing
+    uint32_t txFifo_ = 0;
+    uint64_t txEmptyNs_ = 0; // When the FIFO will have drained
+};
+
+extern HardwareSerial Serial;
@@ -0,0 +1,41 @@
+#include "PCF8574.h"
+#include "Arduino.h"
+#include "sim_world.h"
+
+PCF8574::PCF8574(uint8_t address) : address_(address) {}
+
+bool PCF8574::begin() {
+    return sim::world().write(address_, latch_ | (uint8_t)~writeMode_);
+}
+
+void PCF8574::pinMode(uint8_t pin, uint8_t mode) {
+    if (mode == OUTPUT) {
+        writeMode_ |= (1 << pin);
+    } else {
+        writeMode_ &= ~(1 << pin);
+        latch_ |= (1 << pin);
+    }
+}
+
+bool PCF8574::digitalWrite(uint8_t pin, uint8_t value) {
+    if (value == HIGH) latch_ |= (1 << pin);
+    else latch_ &= ~(1 << pin);
+    return sim::world().write(address_, latch_ | (uint8_t)~writeMode_);
+}
+
+uint8_t PCF8574::digitalRead(uint8_t pin) {
+    uint16_t port = 0xFF;
+    sim::world().read(address_, port);
+    return (port >> pin) & 1 ? HIGH : LOW;
+}
+
+uint8_t PCF8574::digitalReadAll() {
+    uint16_t port = 0xFF;
+    sim::world().read(address_, port);
+    return (uint8_t)port;
+}
+
+bool PCF8574::digitalWriteAll(uint8_t value) {
+    latch_ = value;
+    return sim::world().write(address_, latch_ | (uint8_t)~writeMode_);
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <stdint.h>
+
+// Host stand-in for xreef/PCF8574 backed by sim::World. Like the real
+// library, every digitalRead() and digitalWrite() is one bus transaction.
+class PCF8574 {
+public:
+    explicit PCF8574(uint8_t address);
+
+    bool begin();
+    void pinMode(uint8_t pin, uint8_t mode);
+    bool digitalWrite(uint8_t pin, uint8_t value);
+    uint8_t digitalRead(uint8_t pin);
+
+    // PCF8574_LOW_MEMORY forms: the whole port in one transaction.
+    uint8_t digitalReadAll();
+    bool digitalWriteAll(uint8_t value);
+
+    uint8_t getAddress() const { return address_; }
+
+private:
+    uint8_t address_;
+    uint8_t writeMode_ = 0; // Pins configured as OUTPUT
+    uint8_t latch_ = 0xFF;  // Last byte written; INPUT pins are kept HIGH
+};
@@ -0,0 +1,41 @@
+#include "PCF8575.h"
+#include "Arduino.h"
+#include "sim_world.h"
+
+PCF8575::PCF8575(uint8_t address) : address_(address) {}
+
+bool PCF8575::begin() {
+    return sim::world().write(address_, latch_ | (uint16_t)~writeMode_);
+}
+
+void PCF8575::pinMode(uint8_t pin, uint8_t mode) {
+    if (mode == OUTPUT) {
+        writeMode_ |= (1u << pin);
+    } else {
+        writeMode_ &= ~(1u << pin);
+        latch_ |= (1u << pin);
+    }
+}
+
+bool PCF8575::digitalWrite(uint8_t pin, uint8_t value) {
+    if (value == HIGH) latch_ |= (1u << pin);
+    else latch_ &= ~(1u << pin);
+    return sim::world().write(address_, latch_ | (uint16_t)~writeMode_);
+}
+
+uint8_t PCF8575::digitalRead(uint8_t pin) {
+    uint16_t port = 0xFFFF;
+    sim::world().read(address_, port);
+    return (port >> pin) & 1 ? HIGH : LOW;
+}
+
+uint16_t PCF8575::digitalReadAll() {
+    uint16_t port = 0xFFFF;
+    sim::world().read(address_, port);
+    return port;
+}
+
+bool PCF8575::digitalWriteAll(uint16_t value) {
+    latch_ = value;
+    return sim::world().write(address_, latch_ | (uint16_t)~writeMode_);
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <stdint.h>
+
+// Host stand-in for xreef/PCF8575 backed by sim::World: the 16-pin PCF8574,
+// P00..P07 as pins 0..7 and P10..P17 as pins 8..15. Every transaction moves
+// both port bytes, so the per-pin calls cost the same as the port calls.
+class PCF8575 {
+public:
+    explicit PCF8575(uint8_t address);
+
+    bool begin();
+    void pinMode(uint8_t pin, uint8_t mode);
+    bool digitalWrite(uint8_t pin, uint8_t value);
+    uint8_t digitalRead(uint8_t pin);
+
+    // PCF8575_LOW_MEMORY forms: the whole port in one transaction.
+    uint16_t digitalReadAll();
+    bool digitalWriteAll(uint16_t value);
+
+    uint8_t getAddress() const { return address_; }
+
+private:
+    uint8_t address_;
+    uint16_t writeMode_ = 0;  // Pins configured as OUTPUT
+    uint16_t latch_ = 0xFFFF; // Last port written; INPUT pins are kept HIGH
+};
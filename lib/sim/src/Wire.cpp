@@ -0,0 +1,45 @@
+#include "Wire.h"
+#include "sim_world.h"
+
+TwoWire Wire;
+
+bool TwoWire::begin(int, int, uint32_t frequency) {
+    if (frequency) frequency_ = frequency;
+    return true;
+}
+
+void TwoWire::setClock(uint32_t frequency) { frequency_ = frequency; }
+
+void TwoWire::beginTransmission(uint8_t address) {
+    address_ = address;
+    txLen_ = 0;
+    held_ = false;
+}
+
+size_t TwoWire::write(uint8_t value) {
+    if (txLen_ >= BUFFER) return 0;
+    tx_[txLen_++] = value;
+    return 1;
+}
+
+uint8_t TwoWire::endTransmission(bool sendStop) {
+    if (!sendStop) {
+        held_ = true;
+        return 0;
+    }
+    return sim::world().transact(address_, tx_, txLen_, nullptr, 0) ? 0 : 2;
+}
+
+uint8_t TwoWire::requestFrom(uint8_t address, uint8_t quantity, bool) {
+    if (quantity > BUFFER) quantity = BUFFER;
+    bool ok = held_ && address == address_ ? sim::world().transact(address, tx_, txLen_, rx_, quantity)
+                                           : sim::world().transact(address, nullptr, 0, rx_, quantity);
+    held_ = false;
+    rxPos_ = 0;
+    rxLen_ = ok ? quantity : 0;
+    return rxLen_;
+}
+
+int TwoWire::available() { return rxLen_ - rxPos_; }
+
+int TwoWire::read() { return rxPos_ < rxLen_ ? rx_[rxPos_++] : -1; }
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Host stand-in for Arduino Wire. Whole-port chips (the PCF857x stand-ins)
+// go to sim::World directly; register chips (src/mcp23017.cpp) come through
+// here. A transmission ended without STOP is held and sent together with the
+// requestFrom() that follows, as one combined transaction with a repeated
+// start, the way the ESP32 core does it.
+class TwoWire {
+public:
+    bool begin(int sda = -1, int scl = -1, uint32_t frequency = 0);
+    void setClock(uint32_t frequency);
+    uint32_t getClock() const { return frequency_; }
+
+    void beginTransmission(uint8_t address);
+    size_t write(uint8_t value);
+    uint8_t endTransmission(bool sendStop = true); // 0 ACK, 2 address NACK
+    uint8_t requestFrom(uint8_t address, uint8_t quantity, bool sendStop = true);
+    int available();
+    int read();
+
+private:
+    static const int BUFFER = 32;
+
+    uint32_t frequency_ = 100000;
+    uint8_t address_ = 0;
+    uint8_t tx_[BUFFER];
+    uint8_t txLen_ = 0;
+    bool held_ = false; // tx_ waits for requestFrom()
+    uint8_t rx_[BUFFER];
+    uint8_t rxLen_ = 0, rxPos_ = 0;
+};
+
+extern TwoWire Wire;
@@ -0,0 +1,24 @@
+#include "driver/gpio.h"
+#include "sim_world.h"
+
+static bool serviceInstalled = false;
+
+esp_err_t gpio_install_isr_service(int) {
+    if (serviceInstalled) return ESP_ERR_INVALID_STATE;
+    serviceInstalled = true;
+    return ESP_OK;
+}
+
+esp_err_t gpio_set_intr_type(gpio_num_t gpio, gpio_int_type_t) {
+    return gpio >= 0 && gpio < 40 ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t gpio_isr_handler_add(gpio_num_t gpio, gpio_isr_t, void*) {
+    if (!serviceInstalled) return ESP_ERR_INVALID_STATE;
+    sim::world().watchGpio(gpio);
+    return ESP_OK;
+}
+
+esp_err_t gpio_intr_enable(gpio_num_t gpio) {
+    return gpio >= 0 && gpio < 40 ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+// Host stand-in for ESP-IDF's GPIO interrupt service (driver/gpio.h), the
+// calls src/pair_io.cpp makes. As with attachInterrupt(), adding a handler
+// only marks the pin for World::sampleInterrupts(); harnesses call the
+// handler themselves (pair_sim.cpp: pcfInputsInterrupt()).
+
+#include "esp_err.h"
+#include "esp_intr_alloc.h"
+
+typedef int gpio_num_t;
+typedef void (*gpio_isr_t)(void* arg);
+
+typedef enum {
+    GPIO_INTR_DISABLE = 0,
+    GPIO_INTR_POSEDGE = 1,
+    GPIO_INTR_NEGEDGE = 2,
+    GPIO_INTR_ANYEDGE = 3,
+} gpio_int_type_t;
+
+esp_err_t gpio_install_isr_service(int flags); // ESP_ERR_INVALID_STATE if already installed
+esp_err_t gpio_set_intr_type(gpio_num_t gpio, gpio_int_type_t type);
+esp_err_t gpio_isr_handler_add(gpio_num_t gpio, gpio_isr_t handler, void* arg);
+esp_err_t gpio_intr_enable(gpio_num_t gpio);
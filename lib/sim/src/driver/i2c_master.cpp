@@ -0,0 +1,90 @@
+#include "driver/i2c_master.h"
+#include "sim_clock.h"
+#include "sim_world.h"
+
+struct i2c_master_bus_t {
+    size_t depth;
+};
+
+struct i2c_master_dev_t {
+    i2c_master_bus_t* bus;
+    uint16_t address;
+    i2c_master_callback_t done;
+    void* arg;
+};
+
+// Sleep until the first posted write lands, if any is still queued
+static bool waitFirst() {
+    uint64_t first;
+    if (!sim::world().queued(&first)) return false;
+    uint64_t now = sim::clock().nowNs();
+    if (first > now) sim::clock().sleepNs(first - now);
+    sim::world().settle();
+    return true;
+}
+
+esp_err_t i2c_new_master_bus(const i2c_master_bus_config_t* config, i2c_master_bus_handle_t* bus) {
+    if (!config || !bus) return ESP_ERR_INVALID_ARG;
+    *bus = new i2c_master_bus_t{config->trans_queue_depth};
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_bus_add_device(i2c_master_bus_handle_t bus, const i2c_device_config_t* config,
+                                    i2c_master_dev_handle_t* dev) {
+    if (!bus || !config || !dev) return ESP_ERR_INVALID_ARG;
+    *dev = new i2c_master_dev_t{bus, config->device_address, nullptr, nullptr};
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_bus_rm_device(i2c_master_dev_handle_t dev) {
+    delete dev;
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_register_event_callbacks(i2c_master_dev_handle_t dev, const i2c_master_event_callbacks_t* cbs,
+                                              void* arg) {
+    if (!dev || !cbs) return ESP_ERR_INVALID_ARG;
+    if (!dev->bus->depth) return ESP_ERR_INVALID_STATE; // Callbacks need the asynchronous bus
+    dev->done = cbs->on_trans_done;
+    dev->arg = arg;
+    return ESP_OK;
+}
+
+// Queue a transaction on an asynchronous bus, or run it on a blocking one
+static esp_err_t submit(i2c_master_dev_handle_t dev, const uint8_t* out, size_t nOut, uint8_t* in, size_t nIn) {
+    sim::World& world = sim::world();
+    if (!dev->bus->depth) {
+        return world.transact((uint8_t)dev->address, out, (uint32_t)nOut, in, (uint32_t)nIn) ? ESP_OK : ESP_FAIL;
+    }
+    while (world.queued() >= dev->bus->depth && waitFirst()) {
+    }
+    world.post((uint8_t)dev->address, out, (uint32_t)nOut, in, (uint32_t)nIn, [dev](bool ack) {
+        if (!dev->done) return;
+        i2c_master_event_data_t evt = {ack ? I2C_EVENT_DONE : I2C_EVENT_NACK};
+        dev->done(dev, &evt, dev->arg);
+    });
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_transmit(i2c_master_dev_handle_t dev, const uint8_t* out, size_t nOut, int) {
+    return submit(dev, out, nOut, nullptr, 0);
+}
+
+esp_err_t i2c_master_receive(i2c_master_dev_handle_t dev, uint8_t* in, size_t nIn, int) {
+    return submit(dev, nullptr, 0, in, nIn);
+}
+
+esp_err_t i2c_master_transmit_receive(i2c_master_dev_handle_t dev, const uint8_t* out, size_t nOut, uint8_t* in,
+                                      size_t nIn, int) {
+    return submit(dev, out, nOut, in, nIn);
+}
+
+esp_err_t i2c_master_probe(i2c_master_bus_handle_t, uint16_t address, int) {
+    return sim::world().transact((uint8_t)address, nullptr, 0, nullptr, 0) ? ESP_OK : ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t i2c_master_bus_wait_all_done(i2c_master_bus_handle_t, int) {
+    while (waitFirst()) {
+    }
+    return ESP_OK;
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+// Host stand-in for ESP-IDF's I2C master driver (driver/i2c_master.h, IDF
+// 5.2+), the subset src/pcf857x_async.cpp uses, on sim::World's bus. As in
+// IDF, trans_queue_depth makes the whole bus asynchronous: a transmit or
+// receive is posted to the World and returns at once, and the device's
+// on_trans_done fires when it lands (a receive buffer is filled by then). A
+// full queue makes the caller wait for the oldest. Without a depth every
+// call blocks as Wire does. Probes always block. Timeouts are ignored.
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+typedef int gpio_num_t;
+typedef int i2c_port_num_t;
+
+typedef enum { I2C_CLK_SRC_DEFAULT = 0 } i2c_clock_source_t;
+typedef enum { I2C_ADDR_BIT_LEN_7 = 0, I2C_ADDR_BIT_LEN_10 = 1 } i2c_addr_bit_len_t;
+
+typedef struct i2c_master_bus_t* i2c_master_bus_handle_t;
+typedef struct i2c_master_dev_t* i2c_master_dev_handle_t;
+
+typedef struct {
+    i2c_port_num_t i2c_port;
+    gpio_num_t sda_io_num;
+    gpio_num_t scl_io_num;
+    i2c_clock_source_t clk_source;
+    uint8_t glitch_ignore_cnt;
+    int intr_priority;
+    size_t trans_queue_depth;
+    struct {
+        uint32_t enable_internal_pullup : 1;
+    } flags;
+} i2c_master_bus_config_t;
+
+typedef struct {
+    i2c_addr_bit_len_t dev_addr_length;
+    uint16_t device_address;
+    uint32_t scl_speed_hz;
+    uint32_t scl_wait_us;
+    struct {
+        uint32_t disable_ack_check : 1;
+    } flags;
+} i2c_device_config_t;
+
+typedef enum { I2C_EVENT_ALIVE, I2C_EVENT_DONE, I2C_EVENT_NACK, I2C_EVENT_TIMEOUT } i2c_master_event_t;
+
+typedef struct {
+    i2c_master_event_t event;
+} i2c_master_event_data_t;
+
+typedef bool (*i2c_master_callback_t)(i2c_master_dev_handle_t dev, const i2c_master_event_data_t* evt, void* arg);
+
+typedef struct {
+    i2c_master_callback_t on_trans_done;
+} i2c_master_event_callbacks_t;
+
+esp_err_t i2c_new_master_bus(const i2c_master_bus_config_t* config, i2c_master_bus_handle_t* bus);
+esp_err_t i2c_master_bus_add_device(i2c_master_bus_handle_t bus, const i2c_device_config_t* config,
+                                    i2c_master_dev_handle_t* dev);
+esp_err_t i2c_master_bus_rm_device(i2c_master_dev_handle_t dev);
+esp_err_t i2c_master_register_event_callbacks(i2c_master_dev_handle_t dev, const i2c_master_event_callbacks_t* cbs,
+                                              void* arg);
+esp_err_t i2c_master_transmit(i2c_master_dev_handle_t dev, const uint8_t* out, size_t nOut, int timeoutMs);
+esp_err_t i2c_master_receive(i2c_master_dev_handle_t dev, uint8_t* in, size_t nIn, int timeoutMs);
+esp_err_t i2c_master_transmit_receive(i2c_master_dev_handle_t dev, const uint8_t* out, size_t nOut, uint8_t* in,
+                                      size_t nIn, int timeoutMs);
+esp_err_t i2c_master_probe(i2c_master_bus_handle_t bus, uint16_t address, int timeoutMs);
+esp_err_t i2c_master_bus_wait_all_done(i2c_master_bus_handle_t bus, int timeoutMs);
@@ -0,0 +1,7 @@
+#pragma once
+
+// Host stand-in for ESP-IDF's interrupt allocation flags. Nothing is
+// allocated on the host; the flags only have to exist.
+
+#define ESP_INTR_FLAG_LEVEL1 (1 << 1)
+#define ESP_INTR_FLAG_IRAM (1 << 10) // Handler in IRAM: runs while a flash write has the cache off
@@ -0,0 +1,7 @@
+#pragma once
+
+#include <stdint.h>
+
+// Host stand-in for ESP-IDF's esp_timer: microseconds since boot on the
+// simulated clock, the same count micros() gives.
+int64_t esp_timer_get_time();
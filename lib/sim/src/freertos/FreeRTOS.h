@@ -0,0 +1,36 @@
+#pragma once
+
+// Host stand-in for the FreeRTOS kernel types. Tasks run as host threads,
+// ticks follow sim::clock() at configTICK_RATE_HZ (1 kHz, as on the ESP32
+// Arduino core).
+
+#include <stdint.h>
+#include <mutex>
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdFALSE 0
+#define pdTRUE  1
+#define pdFAIL  pdFALSE
+#define pdPASS  pdTRUE
+
+#define configTICK_RATE_HZ 1000
+#define portTICK_PERIOD_MS (1000 / configTICK_RATE_HZ)
+#define portMAX_DELAY      ((TickType_t)0xFFFFFFFFUL)
+
+#define pdMS_TO_TICKS(ms) ((TickType_t)(((TickType_t)(ms) * (TickType_t)configTICK_RATE_HZ) / (TickType_t)1000U))
+
+// --- Critical Sections ---
+// The ESP32 port's spinlock-based portENTER_CRITICAL(&mux); here a mutex.
+struct portMUX_TYPE {
+    std::mutex m;
+};
+#define portMUX_INITIALIZER_UNLOCKED {}
+#define portENTER_CRITICAL(mux) ((mux)->m.lock())
+#define portEXIT_CRITICAL(mux)  ((mux)->m.unlock())
+#define portENTER_CRITICAL_ISR(mux) portENTER_CRITICAL(mux)
+#define portEXIT_CRITICAL_ISR(mux)  portEXIT_CRITICAL(mux)
+#define portENTER_CRITICAL_SAFE(mux) portENTER_CRITICAL(mux)
+#define portEXIT_CRITICAL_SAFE(mux)  portEXIT_CRITICAL(mux)
@@ -0,0 +1,157 @@
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+#include "../sim_clock.h"
+#include "../sim_world.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+// --- Tasks ---
+// A handle is the task's notification slot; the thread finds its own
+// through currentTask.
+struct SimTask {
+    std::atomic<uint32_t> notified{0};
+};
+
+static thread_local SimTask* currentTask = nullptr;
+
+static SimTask* self() {
+    if (!currentTask) currentTask = new SimTask(); // Threads not started by the shim (loop())
+    return currentTask;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char*, uint32_t, void* param,
+                                   UBaseType_t, TaskHandle_t* handle, BaseType_t) {
+    SimTask* task = new SimTask();
+    if (handle) *handle = task;
+    std::thread([fn, param, task] {
+        currentTask = task;
+        fn(param);
+    }).detach();
+    return pdPASS;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char* name, uint32_t stackDepth, void* param,
+                       UBaseType_t priority, TaskHandle_t* handle) {
+    return xTaskCreatePinnedToCore(fn, name, stackDepth, param, priority, handle, 0);
+}
+
+void vTaskDelete(TaskHandle_t) {
+    while (true) std::this_thread::sleep_for(std::chrono::hours(24));
+}
+
+void vTaskDelay(TickType_t ticks) {
+    if (ticks == 0) {
+        std::this_thread::yield();
+        return;
+    }
+    sim::clock().sleepNs((uint64_t)ticks * (1000000000ULL / configTICK_RATE_HZ));
+}
+
+TickType_t xTaskGetTickCount() {
+    return (TickType_t)(sim::clock().nowNs() / (1000000000ULL / configTICK_RATE_HZ));
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle() { return self(); }
+
+// --- Task Notifications ---
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+    static_cast<SimTask*>(task)->notified++;
+    return pdPASS;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t* higherPriorityTaskWoken) {
+    xTaskNotifyGive(task);
+    if (higherPriorityTaskWoken) *higherPriorityTaskWoken = pdTRUE;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticks) {
+    SimTask* task = self();
+    for (TickType_t waited = 0;; waited++) {
+        uint32_t value = task->notified.load();
+        while (value) {
+            if (task->notified.compare_exchange_weak(value, clearOnExit ? 0 : value - 1)) return value;
+        }
+        if (ticks != portMAX_DELAY && waited >= ticks) return 0;
+        sim::clock().sleepNs(1000000000ULL / configTICK_RATE_HZ);
+    }
+}
+
+// --- Mutexes And Binary Semaphores ---
+struct SimSemaphore {
+    std::timed_mutex m;
+    SimSemaphoreStats stats = {0, 0, 0}; // Updated while holding m
+    bool binary = false;
+    std::atomic<bool> given{false};      // Binary only
+};
+
+static void recordTake(SemaphoreHandle_t sem, uint64_t startNs) {
+    uint64_t waited = sim::clock().nowNs() - startNs;
+    sem->stats.takes++;
+    sem->stats.waitNs += waited;
+    if (waited > sem->stats.maxWaitNs) sem->stats.maxWaitNs = waited;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex() { return new SimSemaphore(); }
+
+SemaphoreHandle_t xSemaphoreCreateBinary() {
+    SimSemaphore* sem = new SimSemaphore();
+    sem->binary = true;
+    return sem;
+}
+
+static BaseType_t takeBinary(SemaphoreHandle_t sem, TickType_t ticks) {
+    const uint64_t tickNs = 1000000000ULL / configTICK_RATE_HZ;
+    uint64_t waited = 0;
+    while (!sem->given.exchange(false)) {
+        if (ticks != portMAX_DELAY && waited >= (uint64_t)ticks * tickNs) return pdFALSE;
+        // Sleep to whatever the bus finishes next (at most a tick), then land it
+        uint64_t first, step = tickNs, now = sim::clock().nowNs();
+        if (sim::world().queued(&first)) step = first > now ? std::min(first - now, tickNs) : 0;
+        if (step) sim::clock().sleepNs(step);
+        waited += step;
+        sim::world().settle();
+    }
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks) {
+    if (sem->binary) return takeBinary(sem, ticks);
+    uint64_t start = sim::clock().nowNs();
+    if (ticks == portMAX_DELAY) {
+        sem->m.lock();
+    } else if (!sem->m.try_lock_for(std::chrono::milliseconds(ticks * portTICK_PERIOD_MS))) {
+        return pdFALSE;
+    }
+    recordTake(sem, start);
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem) {
+    if (sem->binary) {
+        return sem->given.exchange(true) ? pdFALSE : pdTRUE;
+    }
+    sem->m.unlock();
+    return pdTRUE;
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t sem) { delete sem; }
+
+BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t sem, BaseType_t* higherPriorityTaskWoken) {
+    if (higherPriorityTaskWoken) *higherPriorityTaskWoken = pdTRUE;
+    return xSemaphoreGive(sem);
+}
+
+SimSemaphoreStats simSemaphoreStats(SemaphoreHandle_t sem) {
+    std::lock_guard<std::timed_mutex> lock(sem->m);
+    return sem->stats;
+}
+
+void simSemaphoreResetStats(SemaphoreHandle_t sem) {
+    std::lock_guard<std::timed_mutex> lock(sem->m);
+    sem->stats = SimSemaphoreStats{0, 0, 0};
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "FreeRTOS.h"
+
+struct SimSemaphore;
+typedef SimSemaphore* SemaphoreHandle_t;
+
+SemaphoreHandle_t xSemaphoreCreateMutex();
+// Given from a completion callback, taken by the task waiting for it. While
+// it waits, the bus lands what it has queued (sim::World::settle()), since
+// on the virtual clock nothing else would.
+SemaphoreHandle_t xSemaphoreCreateBinary();
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem);
+void vSemaphoreDelete(SemaphoreHandle_t sem);
+BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t sem, BaseType_t* higherPriorityTaskWoken);
+
+// Host only: contention statistics, for the bench programs.
+struct SimSemaphoreStats {
+    uint64_t takes;
+    uint64_t waitNs;    // Total time spent blocked in xSemaphoreTake
+    uint64_t maxWaitNs;
+};
+SimSemaphoreStats simSemaphoreStats(SemaphoreHandle_t sem);
+void simSemaphoreResetStats(SemaphoreHandle_t sem);
@@ -0,0 +1,46 @@
+#include "sim_clock.h"
+
+#include <chrono>
+#include <thread>
+
+namespace sim {
+
+namespace {
+
+const uint64_t SPIN_LIMIT_NS = 1000000; // Below one FreeRTOS tick
+
+class RealClock : public Clock {
+public:
+    RealClock() : start_(std::chrono::steady_clock::now()) {}
+
+    uint64_t nowNs() override {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start_).count();
+    }
+
+    void sleepNs(uint64_t ns) override {
+        if (ns >= SPIN_LIMIT_NS) {
+            std::this_thread::sleep_for(std::chrono::nanoseconds(ns));
+            return;
+        }
+        // Host sleeps overshoot by tens of us; spin so modeled bus
+        // transfers take the time they claim.
+        uint64_t until = nowNs() + ns;
+        while (nowNs() < until) {
+        }
+    }
+
+private:
+    std::chrono::steady_clock::time_point start_;
+};
+
+RealClock realClock;
+Clock* current = &realClock;
+
+} // namespace
+
+Clock& clock() { return *current; }
+
+void setClock(Clock* c) { current = c ? c : &realClock; }
+
+} // namespace sim
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <stdint.h>
+
+namespace sim {
+
+// Time source behind millis()/micros(), the FreeRTOS tick and the bus model.
+// The default is the host's monotonic clock; other clocks can be swapped in
+// before any task is started.
+class Clock {
+public:
+    virtual ~Clock() {}
+    virtual uint64_t nowNs() = 0;
+    virtual void sleepNs(uint64_t ns) = 0;
+};
+
+Clock& clock();
+void setClock(Clock* c); // nullptr restores the real-time clock
+
+// Deterministic clock for single-threaded discrete-event runs: time only
+// moves when the event loop (or a modeled bus transfer) advances it.
+class VirtualClock : public Clock {
+public:
+    uint64_t nowNs() override { return now_; }
+    void sleepNs(uint64_t ns) override { now_ += ns; }
+    void advanceTo(uint64_t ns) { if (ns > now_) now_ = ns; }
+
+private:
+    uint64_t now_ = 0;
+};
+
+inline uint64_t nowUs() { return clock().nowNs() / 1000; }
+
+} // namespace sim
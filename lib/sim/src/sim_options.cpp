@@ -0,0 +1,34 @@
+#include "sim_options.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace sim {
+
+bool parsePlantOption(PlantOptions& opts, const char* name, const char* value) {
+    unsigned long n = strtoul(value, nullptr, 10);
+    if (!strcmp(name, "--byte-us")) opts.bus.byteNs = n * 1000;
+    else if (!strcmp(name, "--arb-us")) opts.bus.arbitrationNs = n * 1000;
+    else if (!strcmp(name, "--travel-ms")) opts.motor.travelMs = n;
+    else if (!strcmp(name, "--travel-jitter-ms")) opts.motor.travelJitterMs = n;
+    else if (!strcmp(name, "--lane-spread-ms")) opts.motor.laneSpreadMs = n;
+    else if (!strcmp(name, "--close-ms")) opts.motor.closeDelayMs = n;
+    else if (!strcmp(name, "--bounce-us")) opts.motor.bounceUs = n;
+    else if (!strcmp(name, "--seed")) opts.seed = n;
+    else return false;
+    return true;
+}
+
+void printPlantUsage() {
+    printf("  --byte-us N          I2C time per byte in us (default 90, 100 kHz)\n"
+           "  --arb-us N           Extra per-transaction overhead in us (default 0)\n"
+           "  --travel-ms N        Target travel time between limits (default 1200)\n"
+           "  --travel-jitter-ms N Random +/- spread per move (default 0)\n"
+           "  --lane-spread-ms N   Fixed +/- offset per motor, drawn once (default 0)\n"
+           "  --close-ms N         Switch closure delay after reaching the end (default 0)\n"
+           "  --bounce-us N        Contact chatter after closing (default 0)\n"
+           "  --seed N             Seed for the plant and the firmware's random() (default 1)\n");
+}
+
+} // namespace sim
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <stdint.h>
+#include "sim_world.h"
+
+namespace sim {
+
+// Plant and bus options shared by every host program.
+struct PlantOptions {
+    BusConfig bus;
+    MotorConfig motor;
+    uint32_t seed = 1;
+};
+
+// Consumes "--name value" if it is a plant option. Returns false for
+// anything it does not recognize so the caller can handle its own flags.
+bool parsePlantOption(PlantOptions& opts, const char* name, const char* value);
+void printPlantUsage();
+
+} // namespace sim
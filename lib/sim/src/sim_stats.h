@@ -0,0 +1,59 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+namespace sim {
+
+// Fixed-width bucket histogram for latency and duration distributions.
+// Values past the last bucket are clamped into it; min/max/mean stay exact.
+class Histogram {
+public:
+    explicit Histogram(uint32_t bucketWidth = 1, uint32_t buckets = 65536)
+        : width_(bucketWidth ? bucketWidth : 1), counts_(buckets ? buckets : 1, 0) {}
+
+    void add(uint64_t v) {
+        uint64_t b = v / width_;
+        if (b >= counts_.size()) b = counts_.size() - 1;
+        counts_[b]++;
+        if (!n_ || v < min_) min_ = v;
+        if (v > max_) max_ = v;
+        sum_ += v;
+        n_++;
+    }
+
+    uint64_t count() const { return n_; }
+    uint64_t min() const { return min_; }
+    uint64_t max() const { return max_; }
+    double mean() const { return n_ ? (double)sum_ / n_ : 0.0; }
+
+    // Upper edge of the bucket holding the p-th percentile (0..100).
+    uint64_t percentile(double p) const {
+        if (!n_) return 0;
+        uint64_t rank = (uint64_t)(p / 100.0 * (n_ - 1)) + 1;
+        uint64_t seen = 0;
+        for (size_t i = 0; i < counts_.size(); i++) {
+            seen += counts_[i];
+            if (seen >= rank) {
+                uint64_t edge = (uint64_t)(i + 1) * width_ - 1;
+                return edge < max_ ? edge : max_;
+            }
+        }
+        return max_;
+    }
+
+    void merge(const Histogram& o) {
+        for (size_t i = 0; i < counts_.size() && i < o.counts_.size(); i++) counts_[i] += o.counts_[i];
+        if (o.n_ && (!n_ || o.min_ < min_)) min_ = o.min_;
+        if (o.max_ > max_) max_ = o.max_;
+        sum_ += o.sum_;
+        n_ += o.n_;
+    }
+
+private:
+    uint32_t width_;
+    std::vector<uint64_t> counts_;
+    uint64_t n_ = 0, sum_ = 0, min_ = 0, max_ = 0;
+};
+
+} // namespace sim
@@ -0,0 +1,574 @@
+#include "sim_world.h"
+#include "sim_clock.h"
+#include "soc/gpio_reg.h"
+
+#include <algorithm>
+
+namespace sim {
+
+World& world() {
+    static World w;
+    return w;
+}
+
+void World::reset() {
+    std::lock_guard<std::mutex> lock(stateMutex_);
+    std::lock_guard<std::mutex> busLock(busMutex_);
+    stats_ = BusStats();
+    ports_.clear();
+    motors_.clear();
+    pulls_.clear();
+    nextPull_ = 0;
+    posted_.clear();
+    busFreeNs_ = 0;
+    interrupts_ = 0;
+    for (GpioPin& g : gpio_) g = GpioPin{};
+    gpioOut_ = 0;
+    violations_ = 0;
+    stopHook_ = nullptr;
+    startHook_ = nullptr;
+}
+
+void World::configureBus(const BusConfig& cfg) {
+    std::lock_guard<std::mutex> lock(busMutex_);
+    bus_ = cfg;
+}
+
+void World::seed(uint32_t s) {
+    std::lock_guard<std::mutex> lock(stateMutex_);
+    rng_.seed(s);
+}
+
+uint32_t World::noise() {
+    std::lock_guard<std::mutex> lock(stateMutex_);
+    return rng_();
+}
+
+void World::attach(uint8_t addr, uint8_t bytes) {
+    std::lock_guard<std::mutex> lock(stateMutex_);
+    if (!port(addr)) {
+        Port p = {};
+        p.addr = addr;
+        p.bytes = bytes;
+        p.latch = 0xFFFF; // Powers up with all pins HIGH
+        p.level = 0xFFFF;
+        ports_.push_back(p);
+    }
+}
+
+void World::attachRegisters(uint8_t addr) {
+    std::lock_guard<std::mutex> lock(stateMutex_);
+    if (port(addr)) return;
+    Port p = {};
+    p.addr = addr;
+    p.bytes = 2;
+    p.latch = 0xFFFF; // Every pin an input after power-on
+    p.level = 0xFFFF;
+    p.registers = true;
+    p.regs[MCP_IODIRA] = p.regs[MCP_IODIRA + 1] = 0xFF;
+    ports_.push_back(p);
+}
+
+void World::attachGpio(uint8_t addr, const int* gpios, int n, bool outputs) {
+    std::lock_guard<std::mutex> lock(stateMutex_);
+    if (port(addr)) return;
+    Port p = {};
+    p.addr = addr;
+    p.latch = 0xFFFF; // Relays: written HIGH before they become outputs
+    p.level = 0xFFFF;
+    p.gpio = true;
+    ports_.push_back(p);
+    for (int i = 0; i < n && i < 16; i++) {
+        if (gpios[i] < 0 || gpios[i] >= GPIO_COUNT) continue;
+        gpio_[gpios[i]] = GpioPin{addr, (uint8_t)i, true, outputs, false, true};
+    }
+}
+
+int World::addMotor(uint8_t relayAddr, uint8_t relayA, uint8_t relayB,
+                    uint8_t inputAddr, uint8_t inputA, uint8_t inputB,
+                    const MotorConfig& cfg) {
+    attach(relayAddr);
+    attach(inputAddr);
+    std::lock_guard<std::mutex> lock(stateMutex_);
+    Motor m;
+    m.relayAddr = relayAddr;
+    m.relayA = relayA;
+    m.relayB = relayB;
+    m.inputAddr = inputAddr;
+    m.inputA = inputA;
+    m.inputB = inputB;
+    m.cfg = cfg;
+    if (cfg.laneSpreadMs) {
+        std::uniform_int_distribution<int32_t> d(-(int32_t)cfg.laneSpreadMs, (int32_t)cfg.laneSpreadMs);
+        m.laneMs = d(rng_);
+    }
+    m.lastNs = clock().nowNs();
+    motors_.push_back(m);
+    return (int)motors_.size() - 1;
+}
+
+bool World::write(uint8_t addr, uint16_t value) {
+    transfer(1 + portBytes(addr), true);
+    std::lock_guard<std::mutex> lock(stateMutex_);
+    applyPosted(clock().nowNs());
+    Port* p = port(addr);
+    if (!p) return false; // NACK
+    drivePort(*p, p->bytes > 1 ? value : (uint16_t)(value | 0xFF00), clock().nowNs());
+    return true;
+}
+
+void World::drivePort(Port& p, uint16_t latch, uint64_t now) {
+    for (Motor& m : motors_) advance(m, now);
+    p.latch = latch;
+    for (size_t i = 0; i < motors_.size(); i++) {
+        if (motors_[i].relayAddr == p.addr) drive((int)i, now);
+    }
+}
+
+bool World::read(uint8_t addr, uint16_t& value) {
+    transfer(1 + portBytes(addr), false);
+    std::lock_guard<std::mutex> lock(stateMutex_);
+    Port* p = port(addr);
+    if (!p) return false;
+    uint64_t now = clock().nowNs();
+    applyPosted(now);
+    applyPulls(now);
+    value = levelAt(*p, now);
+    return true;
+}
+
+void World::applyPulls(uint64_t now) {
+    for (; nextPull_ < pulls_.size() && pulls_[nextPull_].atNs <= now; nextPull_++) {
+        const Pull& q = pulls_[nextPull_];
+        setPull(q.addr, q.bit, q.low);
+    }
+}
+
+uint16_t World::levelAt(Port& p, uint64_t now) {
+    uint16_t value = p.latch & ~p.pulledLow; // A pin reads HIGH unless something pulls it down
+    for (Motor& m : motors_) {
+        if (m.inputAddr != p.addr) continue;
+        advance(m, now);
+        if (switchClosed(m, false, now)) value &= ~(1 << m.inputA);
+        if (switchClosed(m, true, now)) value &= ~(1 << m.inputB);
+    }
+    return value;
+}
+
+// --- ESP32 GPIO Model ---
+uint32_t World::readRegister(uint32_t reg) {
+    std::lock_guard<std::mutex> lock(stateMutex_);
+    if (reg == GPIO_OUT_REG) return gpioOut_;
+    int first = reg == GPIO_IN_REG ? 0 : reg == GPIO_IN1_REG ? 32 : -1;
+    if (first < 0) return 0;
+    uint64_t now = clock().nowNs();
+    applyPosted(now);
+    applyPulls(now);
+    uint32_t value = 0;
+    for (int g = first; g < first + 32 && g < GPIO_COUNT; g++) {
+        if (gpioLevel(g, now)) value |= 1u << (g - first);
+    }
+    return value;
+}
+
+void World::writeRegister(uint32_t reg, uint32_t value) {
+    if (reg != GPIO_OUT_REG && reg != GPIO_OUT_W1TS_REG && reg != GPIO_OUT_W1TC_REG) return;
+    if (reg != GPIO_OUT_W1TS_REG) {
+        std::lock_guard<std::mutex> lock(busMutex_);
+        stats_.gpioWrites++;
+    }
+    std::lock_guard<std::mutex> lock(stateMutex_);
+    if (reg == GPIO_OUT_W1TS_REG) value = gpioOut_ | value;
+    else if (reg == GPIO_OUT_W1TC_REG) value = gpioOut_ & ~value;
+    gpioOut_ = value;
+    uint64_t now = clock().nowNs();
+    applyPosted(now);
+    for (Port& p : ports_) {
+        if (!p.gpio) continue;
+        uint16_t latch = p.latch;
+        for (int g = 0; g < 32; g++) {
+            const GpioPin& pin = gpio_[g];
+            if (!pin.wired || !pin.output || pin.addr != p.addr) continue;
+            latch = (value & (1u << g)) ? (uint16_t)(latch | (1u << pin.bit)) : (uint16_t)(latch & ~(1u << pin.bit));
+        }
+        if (latch != p.latch) drivePort(p, latch, now);
+    }
+}
+
+void World::watchGpio(int gpio) {
+    std::lock_guard<std::mutex> lock(stateMutex_);
+    if (gpio < 0 || gpio >= GPIO_COUNT) return;
+    gpio_[gpio].watched = true;
+    gpio_[gpio].level = gpioLevel(gpio, clock().nowNs());
+}
+
+bool World::gpioLevel(int gpio, uint64_t now) {
+    const GpioPin& pin = gpio_[gpio];
+    if (!pin.wired) return gpio < 32 ? (gpioOut_ >> gpio) & 1 : true;
+    Port* p = port(pin.addr);
+    return p && (levelAt(*p, now) >> pin.bit) & 1;
+}
+
+bool World::gpioWatched(uint8_t addr, uint8_t bit) const {
+    for (const GpioPin& pin : gpio_) {
+        if (pin.watched && pin.wired && pin.addr == addr && pin.bit == bit) return true;
+    }
+    return false;
+}
+
+// --- MCP23017 Register Model ---
+bool World::transact(uint8_t addr, const uint8_t* out, uint32_t nOut, uint8_t* in, uint32_t nIn) {
+    bool registers = false;
+    {
+        std::lock_guard<std::mutex> lock(stateMutex_);
+        Port* p = port(addr);
+        registers = p && p->registers;
+    }
+    // Port writes are the ones that reach GPIO / OLAT, or any data to a whole-port chip
+    bool portWrite = registers ? nOut > 1 && out[0] + nOut - 2 >= MCP_GPIOA && out[0] <= MCP_OLATA + 1 : nOut > 0;
+    transfer((nOut ? 1 + nOut : 0) + (nIn ? 1 + nIn : 0), portWrite);
+    std::lock_guard<std::mutex> lock(stateMutex_);
+    Port* p = port(addr);
+    if (!p || p->gpio) return false;
+    uint64_t now = clock().nowNs();
+    applyPosted(now);
+    applyPulls(now);
+    land(*p, out, nOut, in, nIn, now);
+    return true;
+}
+
+void World::land(Port& p, const uint8_t* out, uint32_t nOut, uint8_t* in, uint32_t nIn, uint64_t now) {
+    if (!p.registers) {
+        // PCF857x: a read returns the pins
+        if (nOut) drivePort(p, portWritten(p, p.latch, out, nOut), now);
+        uint16_t level = nIn ? levelAt(p, now) : 0;
+        for (uint32_t i = 0; i < nIn; i++) in[i] = (uint8_t)(level >> (p.bytes > 1 ? 8 * (i % 2) : 0));
+        return;
+    }
+    sampleLocked(p, now);
+    if (nOut) p.pointer = out[0];
+    bool latchChanged = false;
+    for (uint32_t i = 1; i < nOut; i++, p.pointer = (uint8_t)((p.pointer + 1) % MCP_REGISTERS)) {
+        uint8_t r = p.pointer;
+        if (r == MCP_INTFA || r == MCP_INTFA + 1 || r == MCP_INTCAPA || r == MCP_INTCAPA + 1) continue; // Read-only
+        if (r == MCP_GPIOA || r == MCP_GPIOA + 1) r += MCP_OLATA - MCP_GPIOA; // GPIO writes land in OLAT
+        p.regs[r] = out[i];
+        latchChanged |= r == MCP_OLATA || r == MCP_OLATA + 1 || r == MCP_IODIRA || r == MCP_IODIRA + 1;
+    }
+    if (latchChanged) {
+        uint16_t olat = p.regs[MCP_OLATA] | p.regs[MCP_OLATA + 1] << 8;
+        uint16_t iodir = p.regs[MCP_IODIRA] | p.regs[MCP_IODIRA + 1] << 8;
+        drivePort(p, olat | iodir, now);
+    }
+    uint16_t gpio = nIn ? levelAt(p, now) : 0;
+    for (uint32_t i = 0; i < nIn; i++, p.pointer = (uint8_t)((p.pointer + 1) % MCP_REGISTERS)) {
+        uint8_t r = p.pointer;
+        if (r == MCP_GPIOA || r == MCP_GPIOA + 1) {
+            in[i] = (uint8_t)(gpio >> (8 * (r - MCP_GPIOA)));
+        } else {
+            in[i] = p.regs[r];
+        }
+        if (r == MCP_INTCAPA || r == MCP_INTCAPA + 1 || r == MCP_GPIOA || r == MCP_GPIOA + 1) {
+            p.regs[MCP_INTFA] = p.regs[MCP_INTFA + 1] = 0; // Interrupt released
+        }
+    }
+}
+
+uint16_t World::portWritten(const Port& p, uint16_t latch, const uint8_t* out, uint32_t nOut) {
+    // PCF857x data bytes alternate P0x, P1x
+    for (uint32_t i = 0; i < nOut; i++) {
+        int shift = p.bytes > 1 ? 8 * (i % 2) : 0;
+        latch = (uint16_t)((latch & ~(0xFF << shift)) | out[i] << shift);
+    }
+    return p.bytes > 1 ? latch : (uint16_t)(latch | 0xFF00);
+}
+
+uint64_t World::post(uint8_t addr, const uint8_t* out, uint32_t nOut, uint8_t* in, uint32_t nIn,
+                     std::function<void(bool ack)> done) {
+    Posted q = {};
+    q.addr = addr;
+    q.nOut = (uint8_t)(nOut < sizeof(q.out) ? nOut : sizeof(q.out));
+    for (uint32_t i = 0; i < q.nOut; i++) q.out[i] = out[i];
+    q.in = in;
+    q.nIn = nIn;
+    q.done = done;
+    std::lock_guard<std::mutex> lock(stateMutex_);
+    // Under the state lock: posted_ stays in bus order
+    q.atNs = reserve((nOut ? 1 + nOut : 0) + (nIn ? 1 + nIn : 0), nOut > 0);
+    posted_.push_back(q);
+    return q.atNs;
+}
+
+void World::settle() {
+    std::lock_guard<std::mutex> lock(stateMutex_);
+    applyPosted(clock().nowNs());
+}
+
+size_t World::queued(uint64_t* firstNs) {
+    std::lock_guard<std::mutex> lock(stateMutex_);
+    applyPosted(clock().nowNs());
+    if (firstNs) *firstNs = posted_.empty() ? UINT64_MAX : posted_.front().atNs;
+    return posted_.size();
+}
+
+void World::applyPosted(uint64_t now) {
+    while (!posted_.empty() && posted_.front().atNs <= now) {
+        Posted q = posted_.front();
+        posted_.pop_front();
+        Port* p = port(q.addr);
+        applyPulls(q.atNs);
+        if (p && !p->gpio) land(*p, q.out, q.nOut, q.in, q.nIn, q.atNs);
+        if (q.done) q.done(p && !p->gpio);
+    }
+}
+
+void World::sampleLocked(Port& p, uint64_t now) {
+    uint16_t level = levelAt(p, now);
+    uint16_t enabled = p.regs[MCP_GPINTENA] | p.regs[MCP_GPINTENA + 1] << 8;
+    uint16_t changed = (level ^ p.level) & enabled;
+    bool pending = p.regs[MCP_INTFA] || p.regs[MCP_INTFA + 1];
+    if (changed && !pending) {
+        bool line = false;
+        for (const Port& q : ports_) line |= q.registers && (q.regs[MCP_INTFA] || q.regs[MCP_INTFA + 1]);
+        if (!line) interrupts_++;
+        // INTCAP holds the port as it was at the first edge until released;
+        // later edges before that are not captured
+        p.regs[MCP_INTFA] = (uint8_t)changed;
+        p.regs[MCP_INTFA + 1] = (uint8_t)(changed >> 8);
+        p.regs[MCP_INTCAPA] = (uint8_t)level;
+        p.regs[MCP_INTCAPA + 1] = (uint8_t)(level >> 8);
+    }
+    p.level = level;
+}
+
+uint64_t World::sampleInterrupts() {
+    std::lock_guard<std::mutex> lock(stateMutex_);
+    uint64_t now = clock().nowNs();
+    applyPosted(now);
+    applyPulls(now);
+    for (Port& p : ports_) {
+        if (p.registers) sampleLocked(p, now);
+    }
+    bool edge = false;
+    for (int g = 0; g < GPIO_COUNT; g++) {
+        if (!gpio_[g].watched) continue;
+        bool level = gpioLevel(g, now);
+        edge |= level != gpio_[g].level;
+        gpio_[g].level = level;
+    }
+    if (edge) interrupts_++;
+    return interrupts_;
+}
+
+uint64_t World::nextEdgeNs() {
+    std::lock_guard<std::mutex> lock(stateMutex_);
+    uint64_t now = clock().nowNs();
+    applyPosted(now);
+    // A queued write landing may start a motor toward a switch
+    uint64_t next = posted_.empty() ? UINT64_MAX : posted_.front().atNs;
+    auto watched = [&](uint8_t addr, uint8_t bit) {
+        Port* p = port(addr);
+        return (p && p->registers && ((p->regs[MCP_GPINTENA] | p->regs[MCP_GPINTENA + 1] << 8) & (1u << bit))) ||
+               gpioWatched(addr, bit);
+    };
+    for (Motor& m : motors_) {
+        if (!watched(m.inputAddr, m.inputA) && !watched(m.inputAddr, m.inputB)) continue;
+        advance(m, now);
+        bool atEnd = m.pos <= 0.0 || m.pos >= 1.0;
+        uint64_t endNs = atEnd ? m.atEndSinceNs : UINT64_MAX;
+        if (!atEnd && m.dir != 0) {
+            double remaining = m.dir < 0 ? m.pos : 1.0 - m.pos;
+            endNs = m.lastNs + (uint64_t)(remaining * m.nsPerTravel) + 1;
+        }
+        if (endNs == UINT64_MAX) continue;
+        uint64_t closeAt = endNs + (uint64_t)m.cfg.closeDelayMs * 1000000ULL;
+        uint64_t bounceEnd = closeAt + (uint64_t)m.cfg.bounceUs * 1000;
+        uint64_t at = UINT64_MAX;
+        if (now < closeAt) {
+            at = closeAt;
+        } else if (now < bounceEnd) {
+            at = closeAt + ((now - closeAt) / BOUNCE_PERIOD_NS + 1) * BOUNCE_PERIOD_NS;
+            if (at > bounceEnd) at = bounceEnd;
+        }
+        if (at < next) next = at;
+    }
+    for (size_t i = nextPull_; i < pulls_.size(); i++) {
+        if (pulls_[i].atNs > now && watched(pulls_[i].addr, pulls_[i].bit)) {
+            if (pulls_[i].atNs < next) next = pulls_[i].atNs;
+            break; // Sorted: the first one watched is the earliest
+        }
+    }
+    return next;
+}
+
+void World::pull(uint8_t addr, uint8_t bit, bool low) {
+    std::lock_guard<std::mutex> lock(stateMutex_);
+    setPull(addr, bit, low);
+}
+
+void World::pullAt(uint64_t atNs, uint8_t addr, uint8_t bit, bool low) {
+    std::lock_guard<std::mutex> lock(stateMutex_);
+    auto at = std::upper_bound(pulls_.begin() + nextPull_, pulls_.end(), atNs,
+                               [](uint64_t t, const Pull& q) { return t < q.atNs; });
+    pulls_.insert(at, Pull{atNs, addr, bit, low});
+}
+
+void World::setPull(uint8_t addr, uint8_t bit, bool low) {
+    Port* p = port(addr);
+    if (!p) return;
+    p->pulledLow = low ? (p->pulledLow | (1 << bit)) : (p->pulledLow & ~(1 << bit));
+}
+
+bool World::latch(uint8_t addr, uint16_t& value) {
+    std::lock_guard<std::mutex> lock(stateMutex_);
+    applyPosted(clock().nowNs());
+    Port* p = port(addr);
+    if (!p) return false;
+    value = p->latch;
+    return true;
+}
+
+bool World::committed(uint8_t addr, uint16_t& value) {
+    std::lock_guard<std::mutex> lock(stateMutex_);
+    applyPosted(clock().nowNs());
+    Port* p = port(addr);
+    if (!p) return false;
+    value = p->latch;
+    for (const Posted& q : posted_) {
+        if (q.addr == addr && q.nOut && !p->registers && !p->gpio) value = portWritten(*p, value, q.out, q.nOut);
+    }
+    return true;
+}
+
+BusStats World::busStats() {
+    std::lock_guard<std::mutex> lock(busMutex_);
+    return stats_;
+}
+
+uint64_t World::interlockViolations() {
+    std::lock_guard<std::mutex> lock(stateMutex_);
+    applyPosted(clock().nowNs());
+    return violations_;
+}
+
+double World::position(int motor) {
+    std::lock_guard<std::mutex> lock(stateMutex_);
+    applyPosted(clock().nowNs());
+    if (motor < 0 || motor >= (int)motors_.size()) return 0.0;
+    advance(motors_[motor], clock().nowNs());
+    return motors_[motor].pos;
+}
+
+uint64_t World::drivenSinceNs(int motor) {
+    std::lock_guard<std::mutex> lock(stateMutex_);
+    applyPosted(clock().nowNs());
+    if (motor < 0 || motor >= (int)motors_.size()) return 0;
+    return motors_[motor].dirSinceNs;
+}
+
+World::Port* World::port(uint8_t addr) {
+    for (Port& p : ports_) {
+        if (p.addr == addr) return &p;
+    }
+    return nullptr;
+}
+
+uint32_t World::portBytes(uint8_t addr) {
+    std::lock_guard<std::mutex> lock(stateMutex_);
+    Port* p = port(addr);
+    return p ? p->bytes : 1;
+}
+
+uint64_t World::reserve(uint32_t bytes, bool write) {
+    std::lock_guard<std::mutex> lock(busMutex_);
+    uint64_t ns = bus_.arbitrationNs + (uint64_t)bytes * bus_.byteNs;
+    busFreeNs_ = std::max(clock().nowNs(), busFreeNs_) + ns;
+    stats_.transactions++;
+    if (write) stats_.writes++;
+    stats_.bytes += bytes;
+    stats_.busyNs += ns;
+    return busFreeNs_;
+}
+
+void World::transfer(uint32_t bytes, bool write) {
+    // The caller holds the CPU until its slot, after anything queued, is over
+    uint64_t end = reserve(bytes, write);
+    uint64_t now = clock().nowNs();
+    if (end > now) clock().sleepNs(end - now);
+}
+
+void World::advance(Motor& m, uint64_t now) {
+    if (m.dir != 0 && now > m.lastNs) {
+        double next = m.pos + m.dir * (double)(now - m.lastNs) / m.nsPerTravel;
+        if (next <= 0.0 || next >= 1.0) {
+            double remaining = m.dir < 0 ? m.pos : 1.0 - m.pos;
+            if (remaining > 0.0) {
+                m.atEndSinceNs = m.lastNs + (uint64_t)(remaining * m.nsPerTravel);
+            }
+            next = next <= 0.0 ? 0.0 : 1.0;
+        }
+        m.pos = next;
+    }
+    m.lastNs = now;
+}
+
+void World::setStopHook(std::function<void(const StopEvent&)> hook) {
+    std::lock_guard<std::mutex> lock(stateMutex_);
+    stopHook_ = hook;
+}
+
+void World::setStartHook(std::function<void(int motor, uint64_t ns)> hook) {
+    std::lock_guard<std::mutex> lock(stateMutex_);
+    startHook_ = hook;
+}
+
+void World::drive(int index, uint64_t now) {
+    Motor& m = motors_[index];
+    const Port* p = port(m.relayAddr);
+    bool aOn = !(p->latch & (1 << m.relayA));
+    bool bOn = !(p->latch & (1 << m.relayB));
+    if (aOn && bOn) {
+        if (!m.bothOn) violations_++;
+        m.bothOn = true;
+        m.dir = 0; // Both windings energized: the motor stalls
+        return;
+    }
+    m.bothOn = false;
+    int dir = aOn ? -1 : (bOn ? 1 : 0);
+    if (m.dir != 0 && dir != m.dir && stopHook_) {
+        bool sideB = m.dir > 0;
+        bool atEnd = sideB ? m.pos >= 1.0 : m.pos <= 0.0;
+        uint64_t closedNs = m.atEndSinceNs + (uint64_t)m.cfg.closeDelayMs * 1000000ULL;
+        // Driven into a switch it was already resting on: the relay-on is the edge
+        if (closedNs < m.dirSinceNs) closedNs = m.dirSinceNs;
+        if (atEnd && now >= closedNs) stopHook_(StopEvent{index, sideB, closedNs, now});
+    }
+    if (dir != m.dir && dir != 0) {
+        int32_t jitter = 0;
+        if (m.cfg.travelJitterMs) {
+            std::uniform_int_distribution<int32_t> d(-(int32_t)m.cfg.travelJitterMs,
+                                                     (int32_t)m.cfg.travelJitterMs);
+            jitter = d(rng_);
+        }
+        int32_t ms = (int32_t)m.cfg.travelMs + m.laneMs + jitter;
+        m.nsPerTravel = (double)(ms > 1 ? ms : 1) * 1e6;
+        if (startHook_) startHook_(index, now);
+    }
+    if (dir != m.dir) m.dirSinceNs = now;
+    m.dir = dir;
+    m.lastNs = now;
+}
+
+bool World::switchClosed(const Motor& m, bool sideB, uint64_t now) const {
+    bool atEnd = sideB ? m.pos >= 1.0 : m.pos <= 0.0;
+    if (!atEnd) return false;
+    uint64_t closeAt = m.atEndSinceNs + (uint64_t)m.cfg.closeDelayMs * 1000000ULL;
+    if (now < closeAt) return false;
+    uint64_t sinceClose = now - closeAt;
+    if (sinceClose < (uint64_t)m.cfg.bounceUs * 1000) {
+        return (sinceClose / BOUNCE_PERIOD_NS) % 2 == 0; // Chattering: closed, open, closed, ...
+    }
+    return true;
+}
+
+} // namespace sim
@@ -0,0 +1,242 @@
+#pragma once
+
+#include <stdint.h>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <random>
+#include <vector>
+
+namespace sim {
+
+// --- Bus Timing Model ---
+struct BusConfig {
+    uint32_t byteNs = 90000;     // 9 bit-times per byte at 100 kHz
+    uint32_t arbitrationNs = 0;  // START/STOP and arbitration overhead per transaction
+};
+
+struct BusStats {
+    uint64_t transactions = 0;
+    uint64_t writes = 0; // Of which port writes
+    uint64_t bytes = 0;
+    uint64_t busyNs = 0;
+    uint64_t gpioWrites = 0; // Port writes through the GPIO registers: no bus, no time
+
+    uint64_t portWrites() const { return writes + gpioWrites; }
+};
+
+// --- Motor / Limit-Switch Model ---
+struct MotorConfig {
+    uint32_t travelMs = 1200;      // Full travel between the two limit switches
+    uint32_t travelJitterMs = 0;   // Each move takes travelMs +/- up to this much
+    uint32_t laneSpreadMs = 0;     // Each motor is slower or faster by a fixed amount, +/- up to this much
+    uint32_t closeDelayMs = 0;     // Switch closes this long after the target reaches its end stop
+    uint32_t bounceUs = 0;         // Contact chatter after closing, toggling every BOUNCE_PERIOD_NS
+};
+
+const uint32_t BOUNCE_PERIOD_NS = 250000;
+
+// One target: relay A drives toward limit switch A, relay B toward switch B.
+// Relays are active LOW, switches pull their input LOW when closed.
+struct Motor {
+    uint8_t relayAddr, relayA, relayB;
+    uint8_t inputAddr, inputA, inputB;
+    MotorConfig cfg;
+    double pos = 0.0;              // 0 = at limit A, 1 = at limit B
+    double nsPerTravel = 0.0;      // Duration of the move in progress
+    int32_t laneMs = 0;            // This motor's fixed offset from travelMs (laneSpreadMs)
+    int dir = 0;                   // -1 toward A, +1 toward B, 0 stopped
+    uint64_t lastNs = 0;
+    uint64_t atEndSinceNs = 0;     // When pos last reached 0 or 1
+    uint64_t dirSinceNs = 0;       // When the current drive direction was set
+    bool bothOn = false;
+};
+
+// Reported when the relay driving a motor is released after its limit switch
+// closed: releasedNs - closedNs is the edge-to-stop latency the shooter sees.
+struct StopEvent {
+    int motor;
+    bool sideB;
+    uint64_t closedNs;   // First contact of the switch
+    uint64_t releasedNs; // Relay write that de-energized the motor
+};
+
+// MCP23017 registers the register-file model implements (IOCON.BANK = 0)
+enum : uint8_t {
+    MCP_IODIRA = 0x00,
+    MCP_GPINTENA = 0x04,
+    MCP_IOCON = 0x0A,
+    MCP_GPPUA = 0x0C,
+    MCP_INTFA = 0x0E,
+    MCP_INTCAPA = 0x10,
+    MCP_GPIOA = 0x12,
+    MCP_OLATA = 0x14,
+    MCP_REGISTERS = 0x16,
+};
+
+// The simulated I2C segment: PCF8574 / PCF8575 port latches, the motors wired to them
+// and the bus timing, plus ports wired straight to ESP32 GPIOs. All access is
+// serialized; transfers hold the bus for their modeled duration, so
+// contending tasks see realistic stalls.
+class World {
+public:
+    void reset(); // Forget every port, motor, statistic and hook
+    void configureBus(const BusConfig& cfg);
+    void seed(uint32_t s);
+    uint32_t noise();
+
+    // A port of one data byte (PCF8574) or two (PCF8575, pins 8..15 in the
+    // second byte). A one-byte port reads back with bits 8..15 HIGH.
+    void attach(uint8_t addr, uint8_t bytes = 1);
+    // An MCP23017: sixteen pins behind a register pointer, with
+    // interrupt-on-change. Its INT outputs are mirrored, open-drain and
+    // wired together into one line.
+    void attachRegisters(uint8_t addr);
+    // A port on ESP32 GPIOs (PAIR_NATIVE_GPIO): pin n is GPIO gpios[n] (-1:
+    // none). addr only names it for addMotor() and pull(); nothing crosses
+    // the bus. Relay ports follow GPIO_OUT_REG, input ports have pull-ups.
+    void attachGpio(uint8_t addr, const int* gpios, int n, bool outputs);
+    int addMotor(uint8_t relayAddr, uint8_t relayA, uint8_t relayB,
+                 uint8_t inputAddr, uint8_t inputA, uint8_t inputB,
+                 const MotorConfig& cfg);
+
+    // One I2C transaction each: address byte plus the port's data bytes.
+    bool write(uint8_t addr, uint16_t value);
+    bool read(uint8_t addr, uint16_t& value);
+
+    // Hold an input pin LOW (or let it go) from outside the motor model,
+    // e.g. to replay recorded switch edges.
+    void pull(uint8_t addr, uint8_t bit, bool low);
+    // The same, taking effect at atNs on the virtual timeline even if that
+    // falls in the middle of a task's step.
+    void pullAt(uint64_t atNs, uint8_t addr, uint8_t bit, bool low);
+
+    // One combined transaction to a register port: write out (the register
+    // pointer, then data), a repeated start, then read nIn bytes from the
+    // pointer on. Reading INTCAP or GPIO releases the chip's interrupt.
+    // To a whole-port chip, out is the port (low byte first) and in reads it.
+    bool transact(uint8_t addr, const uint8_t* out, uint32_t nOut, uint8_t* in, uint32_t nIn);
+
+    // A transaction queued the way an interrupt-driven driver queues it: it
+    // takes the bus once the transfers ahead of it are done and lands when
+    // its last byte has, filling in (which must outlive it) and calling
+    // done(ack) as the driver's ISR would (state lock held; must not touch
+    // the World). The caller's clock does not move; the return value is when
+    // it lands. Blocking transfers queue behind it.
+    uint64_t post(uint8_t addr, const uint8_t* out, uint32_t nOut, uint8_t* in, uint32_t nIn,
+                  std::function<void(bool ack)> done);
+    // Land every posted transaction that is done by now (the other calls do too).
+    void settle();
+    // Posted transactions not landed yet, and when the first of them lands.
+    size_t queued(uint64_t* firstNs = nullptr);
+
+    // The ESP32 registers the GPIO ports answer to: GPIO_OUT_REG and its
+    // W1TS / W1TC halves, GPIO_IN_REG and GPIO_IN1_REG (lib/sim/src/soc/gpio_reg.h).
+    // A port write is a W1TS store then a W1TC one: counted once, at the W1TC.
+    uint32_t readRegister(uint32_t reg);
+    void writeRegister(uint32_t reg, uint32_t value);
+    // attachInterrupt() on an ESP32 GPIO: any change of it interrupts.
+    void watchGpio(int gpio);
+
+    // Latch every input change on the register ports up to now into their
+    // interrupt registers, and look at every watched GPIO; the interrupts
+    // raised so far (a fall of the shared INT line, a watched GPIO edge).
+    // The line may have been released and asserted again inside a transfer.
+    uint64_t sampleInterrupts();
+    // The earliest time after now at which an input that can interrupt may
+    // change: a motor reaching a switch, contact chatter, a scheduled pull.
+    // UINT64_MAX if none is coming.
+    uint64_t nextEdgeNs();
+
+    // Port latch as the chip holds it, without a bus transaction (checks).
+    bool latch(uint8_t addr, uint16_t& value);
+    // The same with every posted write to it landed: what the firmware has
+    // told the chip, whether or not the bytes are out yet.
+    bool committed(uint8_t addr, uint16_t& value);
+
+    BusStats busStats();
+    uint64_t interlockViolations();
+
+    // Where a motor is now: 0 at limit A, 1 at limit B (checks).
+    double position(int motor);
+    // When the relay write that set a motor's current drive landed (checks).
+    uint64_t drivenSinceNs(int motor);
+
+    // Called with the state lock held; must not touch the World.
+    void setStopHook(std::function<void(const StopEvent&)> hook);
+    // The same, for every motor start: a drive set from rest or reversed.
+    void setStartHook(std::function<void(int motor, uint64_t ns)> hook);
+
+private:
+    struct Port {
+        uint8_t addr;
+        uint8_t bytes;      // Data bytes per transfer
+        uint16_t latch;
+        uint16_t pulledLow; // Bits held LOW by pull()
+        bool registers;     // MCP23017: regs[] below, latch = OLAT | IODIR
+        uint8_t pointer;
+        uint8_t regs[MCP_REGISTERS];
+        uint16_t level;     // Inputs as last sampled, for interrupt-on-change
+        bool gpio;          // On ESP32 GPIOs: no transfer, no bytes
+    };
+    struct GpioPin {
+        uint8_t addr, bit;
+        bool wired, output, watched;
+        bool level; // As last sampled, watched pins only
+    };
+    static const int GPIO_COUNT = 40;
+    struct Pull {
+        uint64_t atNs;
+        uint8_t addr, bit;
+        bool low;
+    };
+    struct Posted {
+        uint64_t atNs; // Last byte on the wire
+        uint8_t addr;
+        uint8_t out[4];
+        uint8_t nOut;
+        uint8_t* in;
+        uint32_t nIn;
+        std::function<void(bool)> done;
+    };
+
+    Port* port(uint8_t addr);
+    uint16_t levelAt(Port& p, uint64_t now); // Pin levels with every motor and pull applied
+    bool gpioLevel(int gpio, uint64_t now);
+    bool gpioWatched(uint8_t addr, uint8_t bit) const;
+    void applyPulls(uint64_t now);
+    void applyPosted(uint64_t now);
+    uint16_t portWritten(const Port& p, uint16_t latch, const uint8_t* out, uint32_t nOut); // Whole-port chip
+    void land(Port& p, const uint8_t* out, uint32_t nOut, uint8_t* in, uint32_t nIn, uint64_t now);
+    void sampleLocked(Port& p, uint64_t now);
+    void drivePort(Port& p, uint16_t latch, uint64_t now);
+    uint32_t portBytes(uint8_t addr); // Data bytes a transfer to addr carries
+    void setPull(uint8_t addr, uint8_t bit, bool low);
+    uint64_t reserve(uint32_t bytes, bool write); // Bus slot after everything queued: its end
+    void transfer(uint32_t bytes, bool write);
+    void advance(Motor& m, uint64_t now);
+    void drive(int index, uint64_t now);
+    bool switchClosed(const Motor& m, bool sideB, uint64_t now) const;
+
+    std::mutex busMutex_;    // The wire itself: slots in order, and the statistics
+    std::mutex stateMutex_;  // Ports and motors; taken before busMutex_ when both are
+    BusConfig bus_;
+    BusStats stats_;
+    std::vector<Port> ports_;
+    std::vector<Motor> motors_;
+    std::vector<Pull> pulls_; // Scheduled by pullAt(), applied by read()
+    size_t nextPull_ = 0;
+    std::deque<Posted> posted_; // In bus order, so by atNs
+    uint64_t busFreeNs_ = 0;    // End of the last transfer taken or queued
+    uint64_t interrupts_ = 0;
+    GpioPin gpio_[GPIO_COUNT] = {};
+    uint32_t gpioOut_ = 0;
+    std::mt19937 rng_{1};
+    uint64_t violations_ = 0;
+    std::function<void(const StopEvent&)> stopHook_;
+    std::function<void(int, uint64_t)> startHook_;
+};
+
+World& world();
+
+} // namespace sim
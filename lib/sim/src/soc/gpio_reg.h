@@ -0,0 +1,10 @@
+#pragma once
+
+// The ESP32 GPIO registers sim::World models, at their real addresses.
+
+#define DR_REG_GPIO_BASE 0x3ff44000
+#define GPIO_OUT_REG (DR_REG_GPIO_BASE + 0x0004) // GPIO 0..31 output levels
+#define GPIO_OUT_W1TS_REG (DR_REG_GPIO_BASE + 0x0008) // Set the output bits written as 1
+#define GPIO_OUT_W1TC_REG (DR_REG_GPIO_BASE + 0x000c) // Clear the output bits written as 1
+#define GPIO_IN_REG  (DR_REG_GPIO_BASE + 0x003c) // GPIO 0..31 input levels
+#define GPIO_IN1_REG (DR_REG_GPIO_BASE + 0x0040) // GPIO 32..39 input levels, bits 0..7
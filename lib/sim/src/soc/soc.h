@@ -0,0 +1,13 @@
+#pragma once
+
+// Host stand-in for ESP-IDF's register access macros. Only the registers
+// sim::World models answer (soc/gpio_reg.h); the rest read 0 and ignore
+// writes.
+
+#include <stdint.h>
+
+uint32_t simRegRead(uint32_t reg);
+void simRegWrite(uint32_t reg, uint32_t value);
+
+#define REG_READ(reg) simRegRead((uint32_t)(reg))
+#define REG_WRITE(reg, val) simRegWrite((uint32_t)(reg), (uint32_t)(val))
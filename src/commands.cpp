@@ -0,0 +1,411 @@
+#include "commands.h"
+#include "group_engine.h"
+
+CommandAction commandDecode(char c) {
+    switch (c) {
+    case 's': case 'S': return CMD_ENABLE;
+    case 'x': case 'X': return CMD_DISABLE;
+    case 'd': case 'D': return CMD_TRACE_DUMP;
+    case 't': case 'T': return CMD_TRACE_ARM;
+    case 'p': case 'P': return CMD_STATUS;
+    case 'h': case 'H': return CMD_PAUSE;
+    case 'r': case 'R': return CMD_RESUME;
+    default: return CMD_NONE;
+    }
+}
+
+const char* commandErrorName(CommandError e) {
+    switch (e) {
+    case CMD_OK: return "ok";
+    case CMD_ERR_SYNTAX: return "syntax";
+    case CMD_ERR_CRC: return "crc";
+    case CMD_ERR_OP: return "unknown-command";
+    case CMD_ERR_ARG: return "bad-argument";
+    case CMD_ERR_TOO_LONG: return "too-long";
+    case CMD_ERR_MODE: return "text-only";
+    case CMD_ERR_BUSY: return "busy";
+    }
+    return "?";
+}
+
+namespace {
+
+bool isSpace(uint8_t c) { return c == ' ' || c == '\t'; }
+bool isDigit(uint8_t c) { return c >= '0' && c <= '9'; }
+
+// Next word of the current command; false at ';' or the end of the line.
+bool nextWord(const char*& p, const char*& word, int& n) {
+    while (isSpace(*p)) p++;
+    if (!*p || *p == ';') return false;
+    word = p;
+    while (*p && *p != ';' && !isSpace(*p)) p++;
+    n = (int)(p - word);
+    return true;
+}
+
+bool wordIs(const char* word, int n, const char* name) {
+    for (int i = 0; i < n; i++) {
+        char c = word[i] >= 'A' && word[i] <= 'Z' ? word[i] - 'A' + 'a' : word[i];
+        if (c != name[i]) return false;
+    }
+    return name[n] == 0;
+}
+
+bool parseNumber(const char* word, int n, uint32_t max, uint16_t& out) {
+    uint32_t v = 0;
+    for (int i = 0; i < n; i++) {
+        if (!isDigit(word[i])) return false;
+        v = v * 10 + (word[i] - '0');
+        if (v > max) return false;
+    }
+    out = (uint16_t)v;
+    return n > 0;
+}
+
+bool parsePair(const char* word, int n, uint8_t& pair) {
+    if (n == 1 && word[0] == '*') {
+        pair = COMMAND_ALL_PAIRS;
+        return true;
+    }
+    uint16_t v;
+    if (!parseNumber(word, n, COMMAND_ALL_PAIRS - 1, v)) return false;
+    pair = (uint8_t)v;
+    return true;
+}
+
+// Leading sequence number of a text line (0 if there is none).
+uint16_t lineSeq(const uint8_t* line, int n) {
+    uint32_t v = 0;
+    for (int i = 0; i < n && isDigit(line[i]); i++) v = (v * 10 + (line[i] - '0')) & 0xFFFF;
+    return (uint16_t)v;
+}
+
+// Returns the decoded length, or -1 for a malformed block, or -2 if it
+// would not fit cap.
+int cobsDecode(const uint8_t* in, size_t n, uint8_t* out, size_t cap) {
+    size_t i = 0, o = 0;
+    while (i < n) {
+        uint8_t code = in[i++];
+        if (!code || i + code - 1 > n) return -1;
+        for (uint8_t k = 1; k < code; k++) {
+            if (o >= cap) return -2;
+            out[o++] = in[i++];
+        }
+        if (code < 0xFF && i < n) {
+            if (o >= cap) return -2;
+            out[o++] = 0;
+        }
+    }
+    return (int)o;
+}
+
+uint16_t readU16(const uint8_t* p) { return (uint16_t)(p[0] | (p[1] << 8)); }
+
+void writeU16(uint8_t* p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+} // namespace
+
+CommandReader::Result CommandReader::feed(uint8_t byte) {
+    switch (mode_) {
+    case MODE_IDLE:
+        if (byte == 0) {
+            mode_ = MODE_FRAME;
+            len_ = 0;
+        } else if (byte != '\r' && byte != '\n' && !isSpace(byte)) {
+            mode_ = MODE_TEXT; // A batch, or a line of one command letter
+            buf_[0] = byte;
+            len_ = 1;
+        }
+        return READ_NONE;
+
+    case MODE_TEXT:
+        if (byte == '\r' || byte == '\n') {
+            mode_ = MODE_IDLE;
+            return parseLine();
+        }
+        if (byte == 0) { // A frame starts: drop the unfinished line
+            mode_ = MODE_FRAME;
+            len_ = 0;
+            return READ_NONE;
+        }
+        if (len_ >= COMMAND_LINE_MAX) {
+            batch_.seq = lineSeq(buf_, len_);
+            mode_ = MODE_DISCARD_TEXT;
+            return READ_NONE;
+        }
+        buf_[len_++] = byte;
+        return READ_NONE;
+
+    case MODE_FRAME:
+        if (byte == 0) {
+            if (!len_) return READ_NONE; // Back-to-back delimiters
+            mode_ = MODE_IDLE;
+            return parseFrame();
+        }
+        if (len_ >= COMMAND_LINE_MAX) {
+            mode_ = MODE_DISCARD_FRAME;
+            return READ_NONE;
+        }
+        buf_[len_++] = byte;
+        return READ_NONE;
+
+    case MODE_DISCARD_TEXT:
+        if (byte != '\r' && byte != '\n') return READ_NONE;
+        mode_ = MODE_IDLE;
+        batch_.binary = false;
+        return fail(CMD_ERR_TOO_LONG, 0);
+
+    case MODE_DISCARD_FRAME:
+        if (byte) return READ_NONE;
+        mode_ = MODE_IDLE;
+        batch_.seq = 0;
+        batch_.binary = true;
+        return fail(CMD_ERR_TOO_LONG, 0);
+    }
+    return READ_NONE;
+}
+
+CommandReader::Result CommandReader::fail(CommandError e, uint8_t index) {
+    error_ = e;
+    errorIndex_ = index;
+    return READ_ERROR;
+}
+
+CommandError CommandReader::check(const Command& c) const {
+    bool pairOk = c.pair == COMMAND_ALL_PAIRS || c.pair < pairCount_;
+    switch (c.op) {
+    case OP_ENABLE:
+    case OP_DISABLE:
+    case OP_TRACE_ARM:
+        return CMD_OK;
+    case OP_TRACE_DUMP:
+        return batch_.binary ? CMD_ERR_MODE : CMD_OK;
+    case OP_DWELL:
+        return pairOk && c.a <= c.b ? CMD_OK : CMD_ERR_ARG;
+    case OP_STATUS:
+    case OP_PAUSE:
+    case OP_RESUME:
+        return pairOk ? CMD_OK : CMD_ERR_ARG;
+    case OP_EXPOSE: {
+        int k = c.pair & EXPOSE_K_MASK, first = c.a & 0xFF, last = c.a >> 8;
+        if (!k) return CMD_OK; // Ends the group; the rest is ignored
+        return first <= last && last < pairCount_ && last - first < GROUP_PAIRS_MAX && k <= last - first + 1 && c.b
+                   ? CMD_OK
+                   : CMD_ERR_ARG;
+    }
+    case OP_RIPPLE: {
+        int first = c.a & 0xFF, last = c.a >> 8;
+        if (!c.b) return CMD_OK; // Ends the group
+        return first <= last && last < pairCount_ && last - first < GROUP_PAIRS_MAX ? CMD_OK : CMD_ERR_ARG;
+    }
+    case OP_AUX:
+        // Host lanes wider than PAIR_COUNT wire their extra pairs to the aux pins
+        if (pairCount_ > PAIR_COUNT || c.pair >= AUX_COUNT || c.a > AUX_STEP) return CMD_ERR_ARG;
+        return c.a == AUX_OFF || (c.b && c.b <= AUX_PULSE_MAX_MS) ? CMD_OK : CMD_ERR_ARG;
+    default:
+        return CMD_ERR_OP;
+    }
+}
+
+CommandReader::Result CommandReader::parseLine() {
+    buf_[len_] = 0;
+    batch_.binary = false;
+    batch_.count = 0;
+    batch_.seq = lineSeq(buf_, len_);
+
+    if (!isDigit(buf_[0])) {
+        // One command letter and nothing else: "disable" is not 'd' then 's'
+        int end = len_;
+        while (isSpace(buf_[end - 1])) end--;
+        if (end != 1 || commandDecode((char)buf_[0]) == CMD_NONE) return fail(CMD_ERR_OP, 0);
+        single_ = (char)buf_[0];
+        return READ_SINGLE;
+    }
+
+    const char* p = (const char*)buf_;
+    const char* word;
+    int n;
+    nextWord(p, word, n); // The line starts with a digit, so there is one
+    if (!parseNumber(word, n, 0xFFFF, batch_.seq) || !isSpace(*p)) return fail(CMD_ERR_SYNTAX, 0);
+
+    while (true) {
+        uint8_t index = batch_.count;
+        if (!nextWord(p, word, n)) return fail(CMD_ERR_SYNTAX, index); // Empty command
+        if (index >= COMMAND_BATCH_MAX) return fail(CMD_ERR_TOO_LONG, index);
+        Command& c = batch_.cmds[batch_.count++];
+        c = Command{0, COMMAND_ALL_PAIRS, 0, 0};
+
+        // Arguments: up to six words, meaning set by the verb
+        const char* args[6];
+        int argLen[6];
+        int argc = 0;
+        while (argc < 6 && nextWord(p, args[argc], argLen[argc])) argc++;
+        const char* extra;
+        int extraLen;
+        if (nextWord(p, extra, extraLen)) return fail(CMD_ERR_ARG, index);
+
+        bool argsOk;
+        if (wordIs(word, n, "enable")) {
+            c.op = OP_ENABLE;
+            argsOk = argc == 0;
+        } else if (wordIs(word, n, "disable")) {
+            c.op = OP_DISABLE;
+            argsOk = argc == 0;
+        } else if (wordIs(word, n, "dwell")) {
+            c.op = OP_DWELL;
+            argsOk = argc == 3 && parsePair(args[0], argLen[0], c.pair) &&
+                     parseNumber(args[1], argLen[1], 0xFFFF, c.a) && parseNumber(args[2], argLen[2], 0xFFFF, c.b);
+        } else if (wordIs(word, n, "status")) {
+            c.op = OP_STATUS;
+            argsOk = argc == 0 || (argc == 1 && parsePair(args[0], argLen[0], c.pair));
+        } else if (wordIs(word, n, "pause") || wordIs(word, n, "resume")) {
+            c.op = wordIs(word, n, "pause") ? OP_PAUSE : OP_RESUME;
+            argsOk = argc == 0 || (argc == 1 && parsePair(args[0], argLen[0], c.pair));
+        } else if (wordIs(word, n, "dump")) {
+            c.op = OP_TRACE_DUMP;
+            argsOk = argc == 0;
+        } else if (wordIs(word, n, "arm")) {
+            c.op = OP_TRACE_ARM;
+            argsOk = argc == 0;
+        } else if (wordIs(word, n, "expose")) {
+            c.op = OP_EXPOSE;
+            c.pair = 0;
+            argsOk = argc == 1 && wordIs(args[0], argLen[0], "off");
+            uint16_t k, first, last, gap = 0;
+            bool noRepeat = argc > 4 && wordIs(args[argc - 1], argLen[argc - 1], "norepeat");
+            int numbers = argc - (noRepeat ? 1 : 0);
+            if ((numbers == 4 || numbers == 5) && parseNumber(args[0], argLen[0], EXPOSE_K_MASK, k) &&
+                parseNumber(args[1], argLen[1], 0xFF, first) && parseNumber(args[2], argLen[2], 0xFF, last) &&
+                parseNumber(args[3], argLen[3], 0xFFFF, c.b) &&
+                (numbers == 4 || parseNumber(args[4], argLen[4], EXPOSE_GAP_MAX, gap))) {
+                c.pair = (uint8_t)(k | gap << EXPOSE_GAP_SHIFT | (noRepeat ? EXPOSE_NO_REPEAT : 0));
+                c.a = (uint16_t)(first | last << 8);
+                argsOk = k > 0;
+            }
+        } else if (wordIs(word, n, "ripple")) {
+            c.op = OP_RIPPLE;
+            c.pair = 0;
+            argsOk = argc == 1 && wordIs(args[0], argLen[0], "off");
+            uint16_t first, last, hold = 0;
+            if ((argc == 3 || argc == 4) && parseNumber(args[0], argLen[0], 0xFF, first) &&
+                parseNumber(args[1], argLen[1], 0xFF, last) && parseNumber(args[2], argLen[2], 0xFFFF, c.b) &&
+                (argc == 3 || parseNumber(args[3], argLen[3], 0xFF, hold))) {
+                c.pair = (uint8_t)hold;
+                c.a = (uint16_t)(first | last << 8);
+                argsOk = c.b > 0;
+            }
+        } else if (wordIs(word, n, "aux")) {
+            c.op = OP_AUX;
+            uint16_t channel = 0;
+            bool off = argc == 2 && wordIs(args[1], argLen[1], "off");
+            bool drill = argc == 3 && wordIs(args[1], argLen[1], "drill");
+            bool step = argc == 3 && wordIs(args[1], argLen[1], "step");
+            argsOk = (off || drill || step) && parseNumber(args[0], argLen[0], 0xFF, channel) &&
+                     (off || parseNumber(args[2], argLen[2], AUX_PULSE_MAX_MS, c.b));
+            c.pair = (uint8_t)channel;
+            c.a = off ? AUX_OFF : drill ? AUX_DRILL : AUX_STEP;
+        } else {
+            return fail(CMD_ERR_OP, index);
+        }
+        if (!argsOk) return fail(CMD_ERR_ARG, index);
+        CommandError e = check(c);
+        if (e != CMD_OK) return fail(e, index);
+
+        if (*p) p++; // ';'
+        while (isSpace(*p)) p++;
+        if (!*p) return READ_BATCH; // A trailing ';' is fine
+    }
+}
+
+CommandReader::Result CommandReader::parseFrame() {
+    uint8_t payload[COMMAND_PAYLOAD_MAX];
+    batch_.binary = true;
+    batch_.count = 0;
+    batch_.seq = 0;
+    int n = cobsDecode(buf_, len_, payload, sizeof(payload));
+    if (n == -2) return fail(CMD_ERR_TOO_LONG, 0);
+    if (n < 4) return fail(CMD_ERR_SYNTAX, 0);
+    batch_.seq = readU16(payload);
+    if (commandCrc16(payload, n - 2) != readU16(payload + n - 2)) return fail(CMD_ERR_CRC, 0);
+    int body = n - 4;
+    if (!body || body % COMMAND_WIRE_BYTES) return fail(CMD_ERR_SYNTAX, 0);
+
+    for (int i = 0; i < body / COMMAND_WIRE_BYTES; i++) {
+        const uint8_t* w = payload + 2 + i * COMMAND_WIRE_BYTES;
+        Command& c = batch_.cmds[batch_.count++];
+        c = Command{w[0], w[1], readU16(w + 2), readU16(w + 4)};
+        CommandError e = check(c);
+        if (e != CMD_OK) return fail(e, (uint8_t)i);
+    }
+    return READ_BATCH;
+}
+
+GroupRules commandGroupRules(const Command& c) {
+    GroupRules r = {};
+    r.first = (uint8_t)(c.a & 0xFF);
+    r.last = (uint8_t)(c.a >> 8);
+    r.windowMs = c.b;
+    if (c.op == OP_RIPPLE) {
+        r.mode = GROUP_RIPPLE;
+        r.holdSteps = c.pair;
+    } else {
+        r.k = c.pair & EXPOSE_K_MASK;
+        r.gap = (c.pair >> EXPOSE_GAP_SHIFT) & EXPOSE_GAP_MAX;
+        r.noRepeat = (c.pair & EXPOSE_NO_REPEAT) != 0;
+    }
+    return r;
+}
+
+uint16_t commandCrc16(const uint8_t* data, size_t n) {
+    uint16_t crc = 0xFFFF;
+    for (size_t i = 0; i < n; i++) {
+        crc ^= (uint16_t)data[i] << 8;
+        for (int bit = 0; bit < 8; bit++) crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+    }
+    return crc;
+}
+
+size_t commandFrame(const uint8_t* payload, size_t n, uint8_t* out) {
+    // COBS over payload + CRC as one stream, so the caller's buffer needs
+    // no room for the CRC
+    uint8_t tail[2];
+    writeU16(tail, commandCrc16(payload, n));
+    size_t o = 0;
+    out[o++] = 0;
+    size_t codeAt = o++, total = n + 2;
+    uint8_t code = 1;
+    for (size_t i = 0; i < total; i++) {
+        uint8_t b = i < n ? payload[i] : tail[i - n];
+        if (b) {
+            out[o++] = b;
+            code++;
+        }
+        if (!b || code == 0xFF) {
+            out[codeAt] = code;
+            codeAt = o++;
+            code = 1;
+        }
+    }
+    out[codeAt] = code;
+    out[o++] = 0;
+    return o;
+}
+
+size_t commandEncode(const CommandBatch& batch, uint8_t* out) {
+    uint8_t payload[2 + COMMAND_BATCH_MAX * COMMAND_WIRE_BYTES];
+    size_t n = 0;
+    writeU16(payload, batch.seq);
+    n += 2;
+    for (int i = 0; i < batch.count && i < COMMAND_BATCH_MAX; i++) {
+        const Command& c = batch.cmds[i];
+        payload[n++] = c.op;
+        payload[n++] = c.pair;
+        writeU16(payload + n, c.a);
+        writeU16(payload + n + 2, c.b);
+        n += 4;
+    }
+    return commandFrame(payload, n, out);
+}
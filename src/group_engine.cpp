@@ -0,0 +1,155 @@
+#include "group_engine.h"
+#include "commands.h"
+#include "pair_policies.h"
+
+typedef GroupEngine<PcfIo, MillisClock, TracedRandom, FirmwareLog, GatedStarts> FirmwareGroup;
+
+// Scratch for groupPlan(), so a rejected plan leaves the group as it was
+static uint16_t planned[GROUP_SELECTIONS_MAX];
+
+static int bitCount(uint16_t v) {
+    int n = 0;
+    for (; v; v &= v - 1) n++;
+    return n;
+}
+
+// Every k-of-count selection the rules allow into planned[]. Returns how
+// many, 0 if none or too many to precompute.
+static int planSelections(const GroupRules& rules, int count) {
+    // At least gap hidden pairs between two exposed ones
+    int n = 0;
+    for (uint32_t s = 1; s < (1u << count); s++) {
+        if (bitCount((uint16_t)s) != rules.k) continue;
+        bool spaced = true;
+        for (int d = 1; d <= rules.gap && spaced; d++) spaced = !(s & (s >> d));
+        if (!spaced) continue;
+        if (n == GROUP_SELECTIONS_MAX) return 0;
+        planned[n++] = (uint16_t)s;
+    }
+
+    // No repeats: drop every selection with no disjoint successor left,
+    // until each one that remains can always be followed
+    bool dropped = rules.noRepeat;
+    while (dropped) {
+        dropped = false;
+        int kept = 0;
+        for (int i = 0; i < n; i++) {
+            bool follows = false;
+            for (int j = 0; j < n && !follows; j++) follows = !(planned[i] & planned[j]);
+            if (follows) {
+                planned[kept++] = planned[i];
+            } else {
+                dropped = true;
+            }
+        }
+        n = kept;
+    }
+    return n;
+}
+
+bool groupPlan(GroupData* g, int pairCount, const GroupRules& rules) {
+    bool ripple = rules.mode == GROUP_RIPPLE;
+    if (ripple ? !rules.windowMs : !rules.k) {
+        g->count = 0;
+        g->selectionCount = 0;
+        g->rules = rules;
+        return true;
+    }
+    int count = rules.last - rules.first + 1;
+    if (rules.first > rules.last || rules.last >= pairCount || count > GROUP_PAIRS_MAX || rules.mode > GROUP_RIPPLE ||
+        (!ripple && rules.k > count) || !rules.windowMs) {
+        return false;
+    }
+    int n = ripple ? 0 : planSelections(rules, count); // A ripple draws nothing: its order is fixed
+    if (!ripple && !n) return false;
+
+    g->first = rules.first;
+    g->count = (uint8_t)count;
+    g->rules = rules;
+    for (int i = 0; i < n; i++) g->selections[i] = planned[i];
+    g->selectionCount = (uint16_t)n;
+    g->running = false;
+    g->paused = false;
+    g->moving = 0;
+    return true;
+}
+
+int groupCandidates(const GroupData* g, uint16_t after) {
+    if (!g->rules.noRepeat) return g->selectionCount;
+    int n = 0;
+    for (int i = 0; i < g->selectionCount; i++) n += !(g->selections[i] & after);
+    return n;
+}
+
+uint16_t groupCandidate(const GroupData* g, uint16_t after, int index) {
+    for (int i = 0; i < g->selectionCount; i++) {
+        if (g->rules.noRepeat && (g->selections[i] & after)) continue;
+        if (index-- == 0) return g->selections[i];
+    }
+    return g->selections[0]; // Not reached: index < groupCandidates()
+}
+
+uint16_t groupRippleNext(const GroupData* g) {
+    uint32_t slot = g->windows % (uint32_t)(g->count + g->rules.holdSteps);
+    return slot < g->count ? (uint16_t)(g->exposed ^ (1u << slot)) : g->exposed;
+}
+
+void groupPrepare(GroupData* g) {
+    uint16_t all = (uint16_t)((1u << g->count) - 1);
+    g->drive = g->fresh ? all : (uint16_t)((g->next ^ g->exposed) & all);
+    g->early = 0;
+    int n = 0;
+    for (int i = 0; i < g->count; i++) {
+        if (!(g->drive & (1u << i))) continue;
+        const MotorTaskData& p = g->pairs[g->first + i];
+        if (g->rules.mode == GROUP_EXPOSE && !g->fresh && (g->next & (1u << i)) && groupLeadMs(g, i)) {
+            g->early |= 1u << i; // Turns to B on its own clock, ahead of the boundary
+            continue;
+        }
+        PcfPort on = (g->next & (1u << i)) ? p.relayMaskB : p.relayMaskA;
+        groupAddWrite(g->writes, n, p.relayBank, p.relayMaskA | p.relayMaskB, (PcfPort)~on);
+    }
+    g->writeCount = (uint8_t)n;
+}
+
+uint32_t groupLeadMs(const GroupData* g, int i) {
+    uint32_t est = g->pairs[g->first + i].travelEstMs[1];
+    return est < g->rules.windowMs ? est : g->rules.windowMs;
+}
+
+bool groupSetAux(GroupData* g, int channel, uint8_t event, uint16_t pulseMs) {
+    if (channel < 0 || channel >= AUX_COUNT || event > AUX_STEP || (event != AUX_OFF && !pulseMs) ||
+        pulseMs > AUX_PULSE_MAX_MS) {
+        return false;
+    }
+    g->aux[channel] = GroupAux{event, event == AUX_OFF ? (uint16_t)0 : pulseMs, false, 0};
+    return true;
+}
+
+void groupTraceAux(const GroupData* g, int channel) {
+    traceRecord(TRACE_AUX, (uint8_t)channel, (uint16_t)(g->aux[channel].pulseMs | g->aux[channel].event << 14));
+}
+
+void groupTrace(const GroupRules& r) {
+    traceRecord(TRACE_GROUP, 0, r.first | r.last << 8);
+    traceRecord(TRACE_GROUP, 1, r.k | r.gap << EXPOSE_GAP_SHIFT | (r.noRepeat ? EXPOSE_NO_REPEAT : 0));
+    traceRecord(TRACE_GROUP, 2, r.windowMs);
+    traceRecord(TRACE_GROUP, 3, r.mode | r.holdSteps << 8);
+}
+
+GroupRules groupTraceRules(const uint16_t* fields) {
+    GroupRules r = {};
+    r.first = (uint8_t)(fields[0] & 0xFF);
+    r.last = (uint8_t)(fields[0] >> 8);
+    r.k = fields[1] & EXPOSE_K_MASK;
+    r.gap = (fields[1] >> EXPOSE_GAP_SHIFT) & EXPOSE_GAP_MAX;
+    r.noRepeat = (fields[1] & EXPOSE_NO_REPEAT) != 0;
+    r.windowMs = fields[2];
+    r.mode = (uint8_t)(fields[3] & 0xFF);
+    r.holdSteps = (uint8_t)(fields[3] >> 8);
+    return r;
+}
+
+uint32_t groupStep(GroupData* g, bool enabled, bool paused) {
+    return FirmwareGroup::step(g, enabled, paused);
+}
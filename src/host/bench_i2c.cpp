@@ -0,0 +1,278 @@
+// I2C layer microbenchmark ([env:bench_i2c]).
+//
+// Runs real host threads against the simulated bus (real-time clock, so
+// transfers genuinely hold the bus and tasks genuinely block on i2cMutex)
+// and compares three ways of doing one scan of a pair, i.e. read both
+// limit switches and write both relays:
+//
+//   per-pin  pcfReadInput() x2 + pcfWriteRelay() x2 per pair (today's path)
+//   batch    one pcfReadInputs() + one pcfWriteRelays() per task
+//   queued   tasks post to one I/O thread that merges every pending request
+//            into a single port write and a single port read per round
+//
+// "write us" is what one relay write costs its caller. On the default build
+// that is the transfer plus any wait for i2cMutex; under PAIR_I2C_ASYNC
+// ([env:bench_i2c-async]) the write is queued and the caller moves on, and
+// reads no longer hold i2cMutex at all.
+//
+// Tasks beyond the number of pairs act as status readers (e.g. a UI poll)
+// that read every input each cycle.
+//
+//   .pio/build/bench_i2c/program --pairs 1,2,4 --tasks 1,2,4,8 --byte-us 90 --arb-us 20
+
+#include <Arduino.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "config.h"
+#include "pair_io.h"
+#include "sim_options.h"
+#include "sim_world.h"
+
+enum Mode { MODE_PER_PIN, MODE_BATCH, MODE_QUEUED };
+static const char* const MODE_NAMES[] = {"per-pin", "batch", "queued"};
+
+// --- Queued I/O Owner ---
+// The only thread touching the bus in queued mode. Requests that arrive
+// while a round is on the wire are merged into the next round.
+class IoQueue {
+public:
+    struct Request {
+        uint8_t mask;
+        uint8_t value;
+        uint8_t inputs;
+        bool done;
+    };
+
+    void start() { worker_ = std::thread(&IoQueue::serve, this); }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(m_);
+            stopping_ = true;
+        }
+        cv_.notify_all();
+        worker_.join();
+    }
+
+    uint8_t submit(uint8_t mask, uint8_t value) {
+        Request r = {mask, value, 0xFF, false};
+        std::unique_lock<std::mutex> lock(m_);
+        pending_.push_back(&r);
+        cv_.notify_all();
+        done_.wait(lock, [&] { return r.done; });
+        return r.inputs;
+    }
+
+private:
+    void serve() {
+        std::vector<Request*> batch;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(m_);
+                cv_.wait(lock, [&] { return stopping_ || !pending_.empty(); });
+                if (stopping_ && pending_.empty()) return;
+                batch.swap(pending_);
+            }
+            uint8_t mask = 0, value = 0;
+            for (Request* r : batch) {
+                mask |= r->mask;
+                value = (value & ~r->mask) | (r->value & r->mask);
+            }
+            if (mask) pcfWriteRelays(mask, value);
+            uint8_t inputs = pcfReadInputs();
+            {
+                std::lock_guard<std::mutex> lock(m_);
+                for (Request* r : batch) {
+                    r->inputs = inputs;
+                    r->done = true;
+                }
+            }
+            done_.notify_all();
+            batch.clear();
+        }
+    }
+
+    std::mutex m_;
+    std::condition_variable cv_, done_;
+    std::vector<Request*> pending_;
+    bool stopping_ = false;
+    std::thread worker_;
+};
+
+struct Result {
+    double pairCyclesPerS;
+    double txnPerPairCycle;
+    double busBusyPct;
+    double lockWaitMeanUs;
+    double lockWaitMaxUs;
+    double cycleIoMeanUs;
+    double writeMeanUs;
+};
+
+static Result runOne(Mode mode, int pairs, int tasks, uint32_t ms) {
+    std::atomic<bool> running(true);
+    std::atomic<uint64_t> pairCycles(0), taskCycles(0), ioNs(0), writes(0), writeNs(0);
+    IoQueue queue;
+    if (mode == MODE_QUEUED) queue.start();
+
+    auto worker = [&](int t) {
+        std::vector<int> owned;
+        for (int p = t; p < pairs; p += tasks) owned.push_back(p);
+        uint8_t mask = 0;
+        for (int p : owned) mask |= (1 << (p * 2)) | (1 << (p * 2 + 1));
+        bool flip = false;
+        // A relay write, timed for the write column
+        auto write = [&](auto&& fn) {
+            auto t0 = std::chrono::steady_clock::now();
+            fn();
+            writeNs += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - t0).count();
+            writes++;
+        };
+
+        while (running.load(std::memory_order_relaxed)) {
+            flip = !flip;
+            uint8_t value = flip ? 0x55 : 0xAA; // A on / B off, then the reverse
+            auto start = std::chrono::steady_clock::now();
+            switch (mode) {
+            case MODE_PER_PIN:
+                if (owned.empty()) {
+                    for (int i = 0; i < pairs * 2; i++) pcfReadInput(i);
+                }
+                for (int p : owned) {
+                    pcfReadInput(p * 2);
+                    pcfReadInput(p * 2 + 1);
+                    write([&] { pcfWriteRelay(p * 2, (value >> (p * 2)) & 1); });
+                    write([&] { pcfWriteRelay(p * 2 + 1, (value >> (p * 2 + 1)) & 1); });
+                }
+                break;
+            case MODE_BATCH:
+                pcfReadInputs();
+                if (mask) write([&] { pcfWriteRelays(mask, value); });
+                break;
+            case MODE_QUEUED:
+                queue.submit(mask, value);
+                break;
+            }
+            ioNs += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::steady_clock::now() - start).count();
+            pairCycles += owned.size();
+            taskCycles++;
+        }
+    };
+
+    sim::World& world = sim::world();
+    simSemaphoreResetStats(i2cMutex);
+    sim::BusStats before = world.busStats();
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < tasks; t++) threads.emplace_back(worker, t);
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+    running = false;
+    for (std::thread& th : threads) th.join();
+    if (mode == MODE_QUEUED) queue.stop();
+
+    double elapsedNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    sim::BusStats after = world.busStats();
+    SimSemaphoreStats lock = simSemaphoreStats(i2cMutex);
+    uint64_t txns = after.transactions - before.transactions;
+
+    Result r;
+    r.pairCyclesPerS = pairCycles * 1e9 / elapsedNs;
+    r.txnPerPairCycle = pairCycles ? (double)txns / pairCycles : 0.0;
+    r.busBusyPct = 100.0 * (after.busyNs - before.busyNs) / elapsedNs;
+    r.lockWaitMeanUs = lock.takes ? lock.waitNs / 1e3 / lock.takes : 0.0;
+    r.lockWaitMaxUs = lock.maxWaitNs / 1e3;
+    r.cycleIoMeanUs = taskCycles ? ioNs / 1e3 / taskCycles : 0.0;
+    r.writeMeanUs = writes ? writeNs / 1e3 / writes : 0.0; // Queued mode: the I/O thread's, not timed
+    return r;
+}
+
+static std::vector<int> parseList(const char* s) {
+    std::vector<int> out;
+    while (*s) {
+        char* end;
+        long v = strtol(s, &end, 10);
+        if (end == s) break;
+        out.push_back((int)v);
+        s = (*end == ',') ? end + 1 : end;
+    }
+    return out;
+}
+
+static void usage(const char* prog) {
+    printf("Usage: %s [options]\n", prog);
+    sim::printPlantUsage();
+    printf("  --pairs LIST         Pair counts to sweep, max 4 (default 1,2,4)\n"
+           "  --tasks LIST         Contending task counts to sweep (default 1,2,4,8)\n"
+           "  --mode NAME          per-pin, batch, queued or all (default all)\n"
+           "  --ms N               Wall time per configuration (default 200)\n");
+}
+
+int main(int argc, char** argv) {
+    sim::PlantOptions opts;
+    std::vector<int> pairList = {1, 2, 4};
+    std::vector<int> taskList = {1, 2, 4, 8};
+    int onlyMode = -1;
+    uint32_t ms = 200;
+
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* val = (i + 1 < argc) ? argv[i + 1] : nullptr;
+        if (!val) { usage(argv[0]); return 2; }
+        if (!strcmp(arg, "--pairs")) pairList = parseList(val);
+        else if (!strcmp(arg, "--tasks")) taskList = parseList(val);
+        else if (!strcmp(arg, "--ms")) ms = strtoul(val, nullptr, 10);
+        else if (!strcmp(arg, "--mode")) {
+            for (int m = 0; m < 3; m++) {
+                if (!strcmp(val, MODE_NAMES[m])) onlyMode = m;
+            }
+            if (onlyMode < 0 && strcmp(val, "all")) { usage(argv[0]); return 2; }
+        } else if (!sim::parsePlantOption(opts, arg, val)) { usage(argv[0]); return 2; }
+        i++;
+    }
+
+    sim::World& world = sim::world();
+    world.configureBus(opts.bus);
+#ifdef PAIR_MCP23017
+    world.attachRegisters(PCF_ADDRESS_RELAYS);
+    world.attachRegisters(PCF_ADDRESS_INPUTS);
+#else
+    world.attach(PCF_ADDRESS_RELAYS, PCF_PINS / 8);
+    world.attach(PCF_ADDRESS_INPUTS, PCF_PINS / 8);
+#endif
+    pcfBeginBus();
+    i2cMutex = xSemaphoreCreateMutex();
+    for (int pin = 0; pin < 8; pin++) {
+        pcf_relays.pinMode(pin, OUTPUT);
+        pcf_inputs.pinMode(pin, INPUT);
+    }
+    pcf_relays.begin();
+    pcf_inputs.begin();
+
+    printf("I2C: byte %lu ns, arbitration %lu ns, %lu ms per configuration\n",
+           (unsigned long)opts.bus.byteNs, (unsigned long)opts.bus.arbitrationNs, (unsigned long)ms);
+    printf("%-8s %5s %5s %14s %14s %9s %16s %16s %14s %10s\n", "mode", "pairs", "tasks", "pair-cycles/s",
+           "txn/pair-cycle", "bus busy", "lock wait avg us", "lock wait max us", "cycle io us", "write us");
+    for (int m = 0; m < 3; m++) {
+        if (onlyMode >= 0 && m != onlyMode) continue;
+        for (int pairs : pairList) {
+            if (pairs < 1 || pairs > 4) continue;
+            for (int tasks : taskList) {
+                if (tasks < 1) continue;
+                Result r = runOne((Mode)m, pairs, tasks, ms);
+                printf("%-8s %5d %5d %14.0f %14.2f %8.1f%% %16.1f %16.1f %14.1f %10.1f\n", MODE_NAMES[m], pairs,
+                       tasks, r.pairCyclesPerS, r.txnPerPairCycle, r.busBusyPct, r.lockWaitMeanUs, r.lockWaitMaxUs,
+                       r.cycleIoMeanUs, r.writeMeanUs);
+            }
+        }
+    }
+    return 0;
+}
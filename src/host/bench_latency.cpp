@@ -0,0 +1,203 @@
+// Edge-to-stop latency benchmark ([env:bench_latency]).
+//
+// Measures the time from a limit switch closing to the relay write that
+// de-energizes its motor, across the full polling / locking / logging path.
+// Travel jitter puts each closure at a random phase of the poll period;
+// background readers contend for i2cMutex like other bus users would.
+// On a PAIR_NATIVE_GPIO build bank 0's relays are cut by the input interrupt
+// handler itself, so their edge->relay-off is --isr-us plus the handler.
+//
+// --flash-ms STALL,PERIOD adds a flash write (an NVS save) every PERIOD ms
+// that stops every task for STALL ms while the IRAM interrupt handler runs
+// on. The GPIO lane's figures must not move; the expander builds', whose
+// stop goes through a task, grow by up to STALL.
+//
+//   .pio/build/bench_latency/program --pairs 4 --load-hz 200 --max-p99-us 60000
+//
+// --variant compares the two firmware builds: "full" runs the engine with
+// its per-move log going out a 115200 baud UART that blocks once its FIFO is
+// full, as the default nodemcu-32s build does; "minimal" is the
+// PAIR_MIN_LATENCY build with the log compiled out. Core placement is not
+// modeled, so the difference is the log alone.
+//
+// The same measurement on hardware is the nodemcu-32s-latency and
+// nodemcu-32s-minimal-latency builds (src/latency_loop.cpp).
+//
+// --ripple measures a ripple group (group_engine.h) instead: when each
+// step's relay write lands against the stagger grid, with the remaining
+// pairs and any background load contending for the bus.
+//
+//   .pio/build/bench_latency/program --pairs 8 --ripple 0,5,150,10 --load-hz 200 --max-jitter-us 1000
+
+#include <Arduino.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pair_sim.h"
+#include "sim_options.h"
+#include "sim_stats.h"
+#include "sim_world.h"
+
+static void usage(const char* prog) {
+    printf("Usage: %s [options]\n", prog);
+    sim::printPlantUsage();
+    printf("  --pairs N            Pairs running concurrently (default PAIR_COUNT, max 64)\n"
+           "  --stops N            Stop events to collect (default 100000)\n"
+           "  --load-hz N          Background input-expander reads per second (default 0)\n"
+           "  --load-reads N       Reads per background wake-up (default 1)\n"
+           "  --step-us N          CPU time charged per motorStep() call (default 10)\n"
+           "  --isr-us N           Edge to input interrupt handler, edge builds (default 2)\n"
+           "  --flash-ms S,P       Every P ms a flash write stalls the tasks for S ms (default none)\n"
+           "  --variant V          full (logging at 115200 baud) or minimal (default minimal)\n"
+           "  --max-p99-us N       Exit 1 if p99 exceeds N us\n"
+           "  --max-us N           Exit 1 if the worst case exceeds N us\n"
+           "  --ripple SPEC        Time a ripple's steps instead: FIRST,LAST,STAGGER_MS[,HOLD_STEPS]\n"
+           "                       (--stops: steps to collect)\n"
+           "  --max-jitter-us N    Exit 1 if a ripple step lands more than N us off its spacing\n");
+}
+
+static uint64_t distanceUs(int64_t ns) { return (uint64_t)(ns < 0 ? -ns : ns) / 1000; }
+
+// Step spacing: each step against the one before it; drift: against the
+// first step's grid. Both in us off the ideal.
+static int runRipple(PairSim& sim, const GroupRules& rules, uint64_t steps, uint64_t maxJitterUs, bool full) {
+    sim.setEnabled(false);
+    if (!sim.setGroup(rules)) {
+        fprintf(stderr, "LATENCY: no ripple fits --ripple\n");
+        return 2;
+    }
+    sim.setEnabled(true);
+    sim::Histogram spacingUs(1, 1 << 20), driftUs(1, 1 << 20);
+    const int64_t staggerNs = (int64_t)rules.windowMs * 1000000;
+    uint32_t seen = 0;
+    uint16_t last = 0;
+    int64_t firstNs = -1, prevNs = 0;
+    uint32_t firstSlot = 0, prevSlot = 0;
+    sim.afterGroupStep = [&] {
+        const GroupData& g = sim.group();
+        if (g.windows == seen) return;
+        uint16_t turned = g.exposed ^ last;
+        seen = g.windows;
+        last = g.exposed;
+        if (!turned) return; // An empty step between ripples
+        int64_t at = (int64_t)sim::world().drivenSinceNs(g.first + __builtin_ctz(turned));
+        uint32_t slot = g.windows - 1;
+        if (firstNs < 0) {
+            firstNs = at;
+            firstSlot = slot;
+        } else {
+            spacingUs.add(distanceUs(at - prevNs - (int64_t)(slot - prevSlot) * staggerNs));
+            driftUs.add(distanceUs(at - firstNs - (int64_t)(slot - firstSlot) * staggerNs));
+        }
+        prevNs = at;
+        prevSlot = slot;
+    };
+    sim.run(UINT64_MAX, [&] { return spacingUs.count() >= steps; });
+
+    const GroupData& g = sim.group();
+    printf("LATENCY: %s build, %d pairs, ripple over pairs %d-%d every %u ms, %llu steps in %.1f h simulated\n",
+           full ? "full" : "minimal", sim.pairCount(), g.first, g.first + g.count - 1, rules.windowMs,
+           (unsigned long long)spacingUs.count(), sim.nowNs() / 3.6e12);
+    printf("LATENCY: step spacing error p50 %llu us  p99 %llu us  max %llu us\n",
+           (unsigned long long)spacingUs.percentile(50), (unsigned long long)spacingUs.percentile(99),
+           (unsigned long long)spacingUs.max());
+    printf("LATENCY: drift from the first step's grid p50 %llu us  p99 %llu us  max %llu us\n",
+           (unsigned long long)driftUs.percentile(50), (unsigned long long)driftUs.percentile(99),
+           (unsigned long long)driftUs.max());
+    bool failed = maxJitterUs && spacingUs.max() > maxJitterUs;
+    if (failed) printf("LATENCY: FAILED gate (step spacing error <= %llu us)\n", (unsigned long long)maxJitterUs);
+    return failed ? 1 : 0;
+}
+
+int main(int argc, char** argv) {
+    sim::PlantOptions opts;
+    PairSimConfig cfg;
+    uint64_t stops = 100000;
+    uint64_t maxP99 = 0, maxWorst = 0, maxJitter = 0;
+    GroupRules ripple = {};
+    unsigned long loadHz = 0;
+    bool full = false;
+
+    opts.motor.travelJitterMs = 200; // Spread closures across the poll period by default
+
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* val = (i + 1 < argc) ? argv[i + 1] : nullptr;
+        if (!val) { usage(argv[0]); return 2; }
+        if (!strcmp(arg, "--pairs")) cfg.pairs = atoi(val);
+        else if (!strcmp(arg, "--stops")) stops = strtoull(val, nullptr, 10);
+        else if (!strcmp(arg, "--load-hz")) loadHz = strtoul(val, nullptr, 10);
+        else if (!strcmp(arg, "--load-reads")) cfg.loadReads = strtoul(val, nullptr, 10);
+        else if (!strcmp(arg, "--step-us")) cfg.stepNs = strtoull(val, nullptr, 10) * 1000;
+        else if (!strcmp(arg, "--isr-us")) cfg.isrNs = strtoull(val, nullptr, 10) * 1000;
+        else if (!strcmp(arg, "--flash-ms")) {
+            unsigned long stall = 0, period = 0;
+            if (sscanf(val, "%lu,%lu", &stall, &period) != 2 || stall >= period) { usage(argv[0]); return 2; }
+            cfg.flashStallNs = (uint64_t)stall * 1000000;
+            cfg.flashPeriodNs = (uint64_t)period * 1000000;
+        }
+        else if (!strcmp(arg, "--variant") && !strcmp(val, "full")) full = true;
+        else if (!strcmp(arg, "--variant") && !strcmp(val, "minimal")) full = false;
+        else if (!strcmp(arg, "--max-p99-us")) maxP99 = strtoull(val, nullptr, 10);
+        else if (!strcmp(arg, "--max-us")) maxWorst = strtoull(val, nullptr, 10);
+        else if (!strcmp(arg, "--max-jitter-us")) maxJitter = strtoull(val, nullptr, 10);
+        else if (!strcmp(arg, "--ripple")) {
+            if (!parseRippleRules(val, &ripple)) { usage(argv[0]); return 2; }
+        }
+        else if (!sim::parsePlantOption(opts, arg, val)) { usage(argv[0]); return 2; }
+        i++;
+    }
+    if (loadHz) cfg.loadPeriodNs = 1000000000ULL / loadHz;
+
+    Serial.mute(true);
+    if (full) Serial.modelTx(115200);
+    cfg.log = full;
+    PairSim sim(opts, cfg);
+    sim::Histogram latencyUs(1, 1 << 18);
+    sim::Histogram serviceUs(1, 1 << 18); // Step that saw the switch -> relay off
+    if (!sim.begin()) {
+        fprintf(stderr, "LATENCY: expander init failed\n");
+        return 2;
+    }
+    if (ripple.windowMs) return runRipple(sim, ripple, stops, maxJitter, full);
+#ifdef PAIR_I2C_ASYNC
+    // A queued relay write lands once its step may be over: time it from
+    // the start of its pair's step that issued it
+    std::vector<uint64_t> stepOf(sim.pairCount(), 0);
+    sim.afterStep = [&](int pair) { stepOf[pair] = sim.stepStartNs(); };
+#endif
+    sim::world().setStopHook([&](const sim::StopEvent& e) {
+        uint64_t fromNs = sim.stepStartNs();
+#ifdef PAIR_I2C_ASYNC
+        if (sim.currentPair() != e.motor || e.releasedNs < fromNs) fromNs = stepOf[e.motor];
+#endif
+        latencyUs.add((e.releasedNs - e.closedNs) / 1000);
+        serviceUs.add((e.releasedNs - fromNs) / 1000);
+    });
+    sim.run(UINT64_MAX, [&] { return latencyUs.count() >= stops; });
+
+    uint64_t p99 = latencyUs.percentile(99);
+    printf("LATENCY: %s build, %d pairs, load %lu Hz x %lu reads, byte %lu ns, %llu stops in %.1f h simulated\n",
+           full ? "full" : "minimal", sim.pairCount(), loadHz, (unsigned long)cfg.loadReads,
+           (unsigned long)opts.bus.byteNs,
+           (unsigned long long)latencyUs.count(), sim.nowNs() / 3.6e12);
+    if (cfg.flashPeriodNs) {
+        printf("LATENCY: flash write stalls tasks %llu ms every %llu ms\n",
+               (unsigned long long)(cfg.flashStallNs / 1000000), (unsigned long long)(cfg.flashPeriodNs / 1000000));
+    }
+    uint64_t p50 = latencyUs.percentile(50);
+    printf("LATENCY: edge->relay-off p50 %llu us  p99 %llu us  max %llu us  mean %.0f us\n",
+           (unsigned long long)p50, (unsigned long long)p99,
+           (unsigned long long)latencyUs.max(), latencyUs.mean());
+    printf("LATENCY: jitter p99-p50 %llu us  max-min %llu us\n", (unsigned long long)(p99 - p50),
+           (unsigned long long)(latencyUs.max() - latencyUs.min()));
+    printf("LATENCY: detect->relay-off p50 %llu us  p99.9 %llu us  max %llu us  (poll phase excluded)\n",
+           (unsigned long long)serviceUs.percentile(50), (unsigned long long)serviceUs.percentile(99.9),
+           (unsigned long long)serviceUs.max());
+
+    bool failed = (maxP99 && p99 > maxP99) || (maxWorst && latencyUs.max() > maxWorst);
+    if (failed) printf("LATENCY: FAILED gate (p99 <= %llu us, max <= %llu us)\n",
+                       (unsigned long long)maxP99, (unsigned long long)maxWorst);
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,565 @@
+// Chaos property checker (chaos.h), shared by [env:sim]'s --chaos and the
+// unit tests.
+
+#include <Arduino.h>
+#include <stdio.h>
+#include <queue>
+#include <vector>
+#include "chaos.h"
+#include "pair_engine.h"
+#include "pair_state.h"
+#include "sim_world.h"
+
+static const uint64_t NS_PER_MS = 1000000ULL;
+static const uint64_t NS_PER_TICK = 1000000000ULL / configTICK_RATE_HZ;
+static const uint32_t SPIN_WAKES = 100; // Back-to-back wakes within one tick before it counts as spinning
+
+// --- Pair Group ---
+bool windowOk(PairSim& sim, uint16_t after, uint16_t deferred) {
+    const GroupData& g = sim.group();
+    uint16_t s = g.exposed;
+    uint32_t banks = 0, caughtUp = 0;
+    for (int i = 0; i < g.count; i++) {
+        banks |= 1u << sim.pair(g.first + i).relayBank;
+        if ((deferred & ~g.deferred) & (1u << i)) caughtUp |= 1u << sim.pair(g.first + i).relayBank;
+    }
+    uint16_t checked = (uint16_t)((1u << g.count) - 1);
+    bool ok;
+    if (g.rules.mode == GROUP_RIPPLE) {
+        uint32_t slot = (g.windows - 1) % (uint32_t)(g.count + g.rules.holdSteps);
+        if (slot < g.count) caughtUp |= 1u << sim.pair(g.first + slot).relayBank;
+        ok = s == (slot < g.count ? (uint16_t)(after ^ (1u << slot)) : after) &&
+             sim.stepWrites() <= (uint64_t)(caughtUp ? __builtin_popcount(caughtUp) : 1);
+        checked = s ^ after; // The rest have not had their turn yet
+    } else {
+        ok = __builtin_popcount(s) == g.rules.k && !(s >> g.count) && !(g.rules.noRepeat && (s & after)) &&
+             sim.stepWrites() <= (uint64_t)__builtin_popcount(banks);
+        for (int d = 1; d <= g.rules.gap; d++) ok = ok && !(s & (s >> d));
+    }
+    for (int i = 0; i < g.count; i++) {
+        if (checked & (1u << i)) ok = ok && sim.pair(g.first + i).activeRelayA != !!(s & (1u << i));
+    }
+    return ok;
+}
+
+// --- Chaos / Property Check ---
+struct Property {
+    const char* name;
+    uint64_t failures = 0;
+    uint64_t firstNs = 0;
+    int firstPair = -1;
+
+    void fail(uint64_t ns, int pair) {
+        if (!failures++) {
+            firstNs = ns;
+            firstPair = pair;
+        }
+    }
+};
+
+int randomBatch(std::mt19937& rng, int pairCount, uint16_t seq, CommandBatch& b) {
+    b = CommandBatch{};
+    b.seq = seq;
+    b.count = 1 + rng() % 4;
+    int bad = -1;
+    for (int i = 0; i < b.count; i++) {
+        Command& c = b.cmds[i];
+        uint32_t pick = rng() % 100;
+        c = Command{(uint8_t)(pick < 25 ? OP_ENABLE : pick < 50 ? OP_DISABLE : pick < 66 ? OP_DWELL
+                              : pick < 76 ? OP_STATUS : pick < 86 ? OP_PAUSE : pick < 94 || i > 1 ? OP_RESUME
+                              : pick < 96 ? OP_AUX : pick < 98 ? OP_EXPOSE : OP_RIPPLE),
+                    COMMAND_ALL_PAIRS, 0, 0};
+        if (c.op == OP_EXPOSE) {
+            // A group over some of the pairs, or none (k 0); last may be one past the end
+            int k = rng() % 4, first = rng() % pairCount, last = first + rng() % (pairCount - first + 1);
+            c.pair = 0;
+            if (k) {
+                c.pair = (uint8_t)(k | (rng() % 3) << EXPOSE_GAP_SHIFT | ((rng() & 1) ? EXPOSE_NO_REPEAT : 0));
+                c.a = (uint16_t)(first | last << 8);
+                c.b = (uint16_t)(300 + rng() % 4000);
+                if ((last >= pairCount || k > last - first + 1 || last - first >= GROUP_PAIRS_MAX) && bad < 0) bad = i;
+            }
+            b.count = (uint8_t)(i + 1); // Ends the batch early, so the text line fits
+        } else if (c.op == OP_RIPPLE) {
+            // As an exposure group; stagger 0 ends the group
+            int first = rng() % pairCount, last = first + rng() % (pairCount - first + 1);
+            c.pair = 0;
+            if (rng() % 4) {
+                c.pair = (uint8_t)(rng() % 12);
+                c.a = (uint16_t)(first | last << 8);
+                c.b = (uint16_t)(50 + rng() % 500);
+                if ((last >= pairCount || last - first >= GROUP_PAIRS_MAX) && bad < 0) bad = i;
+            }
+            b.count = (uint8_t)(i + 1);
+        } else if (c.op == OP_AUX) {
+            // A channel one past the last is out of range, as is any on a wider host lane
+            c.pair = (uint8_t)(rng() % (AUX_COUNT + 1));
+            c.a = (uint16_t)(rng() % 3);
+            c.b = c.a == AUX_OFF ? 0 : (uint16_t)(1 + rng() % 2000);
+            if ((c.pair >= AUX_COUNT || pairCount > PAIR_COUNT) && bad < 0) bad = i;
+        } else if (c.op != OP_ENABLE && c.op != OP_DISABLE) {
+            uint32_t target = rng() % (pairCount + 2); // pairCount: out of range, +1: every pair
+            c.pair = target <= (uint32_t)pairCount ? (uint8_t)target : COMMAND_ALL_PAIRS;
+            if (c.pair == pairCount && bad < 0) bad = i;
+        }
+        if (c.op == OP_DWELL) {
+            c.a = rng() % 3000;
+            c.b = c.a + rng() % 3000;
+            if (rng() % 10 == 0) std::swap(c.a, c.b);
+            if (c.a > c.b && bad < 0) bad = i;
+        }
+    }
+    return bad;
+}
+
+std::string textBatch(const CommandBatch& b) {
+    static const char* const verbs[] = {"", "enable", "disable", "dwell", "status", "dump", "arm", "pause", "resume",
+                                        "expose", "ripple", "aux"};
+    static const char* const auxEvents[] = {"off", "drill", "step"};
+    std::string line = std::to_string(b.seq) + " ";
+    for (int i = 0; i < b.count; i++) {
+        const Command& c = b.cmds[i];
+        std::string pair = c.pair == COMMAND_ALL_PAIRS ? "*" : std::to_string(c.pair);
+        if (i) line += "; ";
+        line += verbs[c.op];
+        if (c.op == OP_DWELL) line += " " + pair + " " + std::to_string(c.a) + " " + std::to_string(c.b);
+        if ((c.op == OP_STATUS || c.op == OP_PAUSE || c.op == OP_RESUME) && c.pair != COMMAND_ALL_PAIRS) {
+            line += " " + pair;
+        }
+        if (c.op == OP_EXPOSE && !c.pair) line += " off";
+        if (c.op == OP_EXPOSE && c.pair) {
+            line += " " + std::to_string(c.pair & EXPOSE_K_MASK) + " " + std::to_string(c.a & 0xFF) + " " +
+                    std::to_string(c.a >> 8) + " " + std::to_string(c.b) + " " +
+                    std::to_string((c.pair >> EXPOSE_GAP_SHIFT) & EXPOSE_GAP_MAX);
+            if (c.pair & EXPOSE_NO_REPEAT) line += " norepeat";
+        }
+        if (c.op == OP_RIPPLE && !c.b) line += " off";
+        if (c.op == OP_RIPPLE && c.b) {
+            line += " " + std::to_string(c.a & 0xFF) + " " + std::to_string(c.a >> 8) + " " + std::to_string(c.b) + " " +
+                    std::to_string(c.pair);
+        }
+        if (c.op == OP_AUX) {
+            line += " " + std::to_string(c.pair) + " " + auxEvents[c.a];
+            if (c.a != AUX_OFF) line += " " + std::to_string(c.b);
+        }
+    }
+    return line + "\n";
+}
+
+bool sameBatch(const CommandBatch& x, const CommandBatch& y) {
+    if (x.seq != y.seq || x.count != y.count) return false;
+    for (int i = 0; i < x.count; i++) {
+        const Command& a = x.cmds[i];
+        const Command& b = y.cmds[i];
+        if (a.op != b.op || a.pair != b.pair || a.a != b.a || a.b != b.b) return false;
+    }
+    return true;
+}
+
+int runChaos(const sim::PlantOptions& opts, const PairSimConfig& cfg, double hours, uint32_t meanMs,
+             uint32_t stopTicks) {
+    PairSim sim(opts, cfg);
+    if (!sim.begin()) {
+        fprintf(stderr, "SIM: expander init failed\n");
+        return 2;
+    }
+    sim.setEnabled(false); // As after boot
+    sim::World& world = sim::world();
+    const int pairCount = sim.pairCount();
+    const uint64_t stopNs = (uint64_t)stopTicks * NS_PER_TICK;
+    const uint64_t endNs = (uint64_t)(hours * 3600.0 * 1000.0) * NS_PER_MS;
+    std::mt19937 rng(opts.seed ^ 0x9E3779B9u);
+
+    Property interlock{"interlock"}, stop{"stop"}, limit{"limit"}, spin{"spin"}, unwind{"unwind"}, quiet{"quiet"},
+        state{"state"}, hold{"hold"}, resume{"resume"}, group{"group"}, inrush{"inrush"}, aux{"aux"},
+        parser{"parser"};
+    uint64_t commands = 0, glitches = 0, disables = 0, batches = 0;
+    CommandReader reader(pairCount);
+    uint16_t seq = 0;
+
+    // As commanded: a queued write (PAIR_I2C_ASYNC) counts from the step that
+    // queued it; the plant's own checks (interlock count, hooks) see it land
+    auto relayOn = [&](int pin) {
+        uint16_t v = PCF_ALL_HIGH;
+        world.committed(sim.relayAddress(PCF_BANK(pin)), v);
+        return !(v & (1u << PCF_BIT(pin)));
+    };
+
+    // Time left in a pair's dwell at millis() t
+    auto dwellLeft = [](const MotorTaskData& p, uint32_t t) {
+        uint32_t elapsed = t - p.phaseStartMs;
+        return elapsed < p.dwellMs ? p.dwellMs - elapsed : 0;
+    };
+
+    // interlock + spin + state + resume after every step
+    std::vector<uint64_t> lastStepNs(pairCount, 0);
+    std::vector<uint32_t> fastWakes(pairCount, 0);
+    struct Held {
+        bool paused = false;
+        PairPhase phase = PHASE_IDLE;
+        bool sideA = true;
+        uint32_t dwellLeftMs = 0;
+        uint32_t windows = 0; // The group's, for a member
+    };
+    std::vector<Held> held(pairCount);
+    sim.afterStep = [&](int i) {
+        MotorTaskData& p = sim.pair(i);
+        uint64_t now = sim.nowNs();
+        if (relayOn(p.relayA) && relayOn(p.relayB)) interlock.fail(now, i);
+        fastWakes[i] = now - lastStepNs[i] < NS_PER_TICK ? fastWakes[i] + 1 : 0;
+        if (fastWakes[i] == SPIN_WAKES) spin.fail(now, i);
+        lastStepNs[i] = now;
+        PairState snap;
+        uint8_t relays = (relayOn(p.relayA) ? PAIR_RELAY_A : 0) | (relayOn(p.relayB) ? PAIR_RELAY_B : 0);
+        if (!pairStateRead(i, &snap) || snap.phase != p.phase || snap.cycles != p.cycles ||
+            snap.sideB == p.activeRelayA || snap.relays != relays || snap.paused != p.paused) {
+            state.fail(now, i);
+        }
+        if (groupMember(&sim.group(), i)) {
+            const GroupData& g = sim.group();
+            GroupState gs;
+            int m = i - g.first;
+            if (!groupStateRead(&gs) || gs.count != g.count || gs.running != g.running || gs.windows != g.windows ||
+                gs.exposed != g.exposed || gs.members[m].travelToBMs != p.travelEstMs[1] ||
+                gs.members[m].faceErrorMs != p.faceErrorMs) {
+                state.fail(now, i);
+            }
+        }
+
+        Held& h = held[i];
+        if (p.paused && !h.paused) {
+            h.phase = p.phase;
+            h.sideA = p.activeRelayA;
+            h.dwellLeftMs = p.phase == PHASE_DWELL ? dwellLeft(p, p.pausedAtMs) : 0;
+            h.windows = sim.group().windows;
+        }
+        if (!p.paused && h.paused && sim.enabled()) {
+            // The step that released it: nothing may have moved on but the clock
+            bool ok = true;
+            if (groupMember(&sim.group(), i) && sim.group().windows != h.windows) {
+                // The release step went on to the window boundary the member
+                // was waiting for: it has moved on by design
+            } else if (h.phase == PHASE_DWELL && h.dwellLeftMs > 0) {
+                // The step's own bus time (a group step's spans several banks)
+                // may have rolled millis() on
+                uint32_t left = dwellLeft(p, millis());
+                uint32_t stepMs = (uint32_t)((now - sim.stepStartNs()) / NS_PER_MS) + 1;
+                ok = p.phase == PHASE_DWELL && p.activeRelayA == h.sideA && left <= h.dwellLeftMs &&
+                     left + stepMs >= h.dwellLeftMs;
+            } else if (h.phase == PHASE_TRAVEL) {
+                bool relay = relayOn(h.sideA ? p.relayA : p.relayB);
+                ok = p.phase == PHASE_TRAVEL ? p.activeRelayA == h.sideA && relay
+                   : p.phase == PHASE_IDLE   ? p.activeRelayA == h.sideA && !relay // No start to spare yet
+                                             : p.phase == PHASE_DWELL;
+            }
+            if (!ok) resume.fail(now, i);
+        }
+        h.paused = p.paused;
+    };
+    // group: at every window boundary; aux: after every group step
+    uint32_t groupWindows = 0;
+    uint16_t groupLast = 0, groupDeferred = 0;
+    const bool auxWired = pairCount <= PAIR_COUNT;
+    std::vector<uint64_t> auxOnNs(AUX_COUNT, 0); // 0: off
+    std::vector<uint32_t> auxFiredMs(AUX_COUNT, 0); // The engine's onSinceMs
+    sim.afterGroupStep = [&] {
+        const GroupData& g = sim.group();
+        uint64_t now = sim.nowNs();
+        for (int c = 0; c < AUX_COUNT && auxWired; c++) {
+            bool on = relayOn(AUX_PINS[c]);
+            bool fired = on && (!auxOnNs[c] || g.aux[c].onSinceMs != auxFiredMs[c]); // Again: a new pulse
+            if (fired && (!g.running || g.windows == groupWindows)) aux.fail(now, -1); // Off a boundary
+            auxOnNs[c] = !on ? 0 : fired ? now : auxOnNs[c];
+            auxFiredMs[c] = g.aux[c].onSinceMs;
+            if (on && now - auxOnNs[c] > (uint64_t)g.aux[c].pulseMs * NS_PER_MS + stopNs) {
+                aux.fail(now, -1);
+                auxOnNs[c] = now; // Once per pulse
+            }
+        }
+        uint16_t deferred = groupDeferred;
+        groupDeferred = g.deferred;
+        if (!g.running) groupWindows = 0; // Unwound: the next enable starts over
+        if (!g.running || g.windows == groupWindows) return;
+        if (!windowOk(sim, g.windows == 1 ? 0 : groupLast, deferred)) group.fail(sim.nowNs(), g.first);
+        groupWindows = g.windows;
+        groupLast = g.exposed;
+    };
+    // limit: the plant reports every release of a motor sitting on its switch
+    world.setStopHook([&](const sim::StopEvent& e) {
+        if (e.releasedNs - e.closedNs > stopNs) limit.fail(e.releasedNs, e.motor);
+    });
+    // inrush: ...and every start
+    StartCounter starts;
+    world.setStartHook([&](int motor, uint64_t ns) {
+        if (startGateCap() && starts.add(ns) > startGateCap()) inrush.fail(ns, motor);
+    });
+
+    // Events: the next random injection, input releases and stop deadlines
+    enum Kind { EV_RANDOM, EV_RELEASE, EV_STOP_CHECK, EV_LIMIT_CHECK, EV_HOLD_CHECK };
+    struct Event {
+        uint64_t atNs;
+        Kind kind;
+        int pin;          // EV_RELEASE / EV_LIMIT_CHECK: input pin; EV_HOLD_CHECK: pair
+        uint64_t since;   // EV_STOP_CHECK / EV_HOLD_CHECK: disable or pause time it belongs to
+        bool operator>(const Event& o) const { return atNs > o.atNs; }
+    };
+    std::priority_queue<Event, std::vector<Event>, std::greater<Event>> events;
+    std::exponential_distribution<double> gap(1.0 / meanMs);
+    auto nextRandom = [&](uint64_t now) {
+        events.push(Event{now + (uint64_t)(gap(rng) * NS_PER_MS) + 1, EV_RANDOM, 0, 0});
+    };
+    nextRandom(0);
+    uint64_t disabledSince = 0;
+    uint64_t travelling = 0;  // Pairs moving (in PHASE_TRAVEL, not held) at the last disable
+    std::vector<uint64_t> pausedSince(pairCount, 0);
+    sim::BusStats atDisable;
+#ifdef PAIR_NATIVE_GPIO
+    uint64_t disableEdges = 0; // Input interrupts by the last disable
+#endif
+    bool quietArmed = false;  // Stopped and past the deadline: the bus must stay silent
+    uint64_t quietFrom = 0;   // Transactions at the stop deadline
+#ifdef PAIR_MCP23017
+    uint64_t quietFalls = 0;  // INT line falls by then
+#endif
+    auto checkQuiet = [&](uint64_t now) {
+        uint64_t allowed = 0;
+#ifdef PAIR_MCP23017
+        // One read per bank for every interrupt since, and for one from
+        // before the deadline that may still be owed its reads
+        allowed = (world.sampleInterrupts() - quietFalls + 1) * pcfBankCount();
+#endif
+        if (quietArmed && world.busStats().transactions - quietFrom > allowed) quiet.fail(now, -1);
+        quietArmed = false;
+    };
+    std::vector<int> heldLow((PCF_BANK(PairSim::MAX_PAIRS * 2) + 1) * PCF_PINS, 0); // Pulls per input pin
+
+    while (!events.empty() && events.top().atNs < endNs) {
+        Event ev = events.top();
+        events.pop();
+        sim.run(ev.atNs);
+        uint64_t now = sim.nowNs();
+
+        switch (ev.kind) {
+        case EV_RANDOM: {
+            uint32_t roll = rng() % 100;
+            if (roll < 50) {
+                // Mostly the real commands, sometimes line noise
+                uint32_t pick = rng() % 20;
+                std::string bytes;
+                CommandBatch sent = {}; // count 0: not a batch
+                int bad = -1;
+                bool binary = false, corrupt = false;
+                if (pick < 10) {
+                    bytes = pick < 4 ? "s\n" : pick < 6 ? "x\n" : pick < 7 ? "h\n" : pick < 8 ? "r\n"
+                          : std::string(1, (char)(1 + rng() % 255)) + "\n";
+                } else {
+                    bad = randomBatch(rng, pairCount, seq++, sent);
+                    binary = pick >= 15;
+                    if (binary) {
+                        uint8_t frame[COMMAND_PAYLOAD_MAX + 8];
+                        bytes.assign((const char*)frame, commandEncode(sent, frame));
+                    } else {
+                        bytes = textBatch(sent);
+                    }
+                    // Flip one bit between the delimiters, never into a delimiter
+                    corrupt = rng() % 5 == 0;
+                    if (corrupt) {
+                        size_t at = binary ? 1 + rng() % (bytes.size() - 2) : rng() % (bytes.size() - 1);
+                        uint8_t flipped = (uint8_t)bytes[at] ^ (uint8_t)(1 << (rng() % 8));
+                        for (int bit = 7; !flipped || flipped == '\n' || flipped == '\r'; bit--) {
+                            flipped = (uint8_t)bytes[at] ^ (uint8_t)(1 << bit); // 0x80 ^ 0x80 would be a delimiter
+                        }
+                        bytes[at] = (char)flipped;
+                    }
+                }
+
+                int results = 0;
+                for (char byte : bytes) {
+                    CommandReader::Result r = reader.feed((uint8_t)byte);
+                    if (r == CommandReader::READ_NONE) continue;
+                    results++;
+                    struct Action {
+                        CommandAction action;
+                        uint8_t pair;
+                        bool configure; // OP_EXPOSE / OP_RIPPLE, with these rules
+                        GroupRules rules;
+                        bool bind;      // OP_AUX, with this binding
+                        AuxBinding binding;
+                    };
+                    std::vector<Action> actions;
+                    if (r == CommandReader::READ_SINGLE) actions.push_back({commandDecode(reader.single()), COMMAND_ALL_PAIRS, false, {}});
+                    if (r == CommandReader::READ_BATCH) {
+                        const CommandBatch& got = reader.batch();
+                        batches++;
+                        if (sent.count && !corrupt && (bad >= 0 || !sameBatch(got, sent))) parser.fail(now, -1);
+                        if (corrupt && binary) parser.fail(now, -1);
+                        for (int i = 0; i < got.count; i++) {
+                            const Command& c = got.cmds[i];
+                            if (c.op == OP_EXPOSE || c.op == OP_RIPPLE) {
+                                GroupRules rules = commandGroupRules(c);
+                                if ((rules.k || (rules.mode == GROUP_RIPPLE && rules.windowMs)) &&
+                                    rules.last >= pairCount) {
+                                    parser.fail(now, -1);
+                                }
+                                actions.push_back({CMD_NONE, 0, true, rules});
+                                continue;
+                            }
+                            if (c.op == OP_AUX) {
+                                if (c.pair >= AUX_COUNT || !auxWired) parser.fail(now, -1);
+                                actions.push_back({CMD_NONE, 0, false, {}, true, {c.pair, (uint8_t)c.a, c.b}});
+                                continue;
+                            }
+                            if (c.pair != COMMAND_ALL_PAIRS && c.pair >= pairCount) parser.fail(now, c.pair);
+                            if (c.op == OP_ENABLE) actions.push_back({CMD_ENABLE, c.pair, false, {}});
+                            if (c.op == OP_DISABLE) actions.push_back({CMD_DISABLE, c.pair, false, {}});
+                            if (c.op == OP_PAUSE) actions.push_back({CMD_PAUSE, c.pair, false, {}});
+                            if (c.op == OP_RESUME) actions.push_back({CMD_RESUME, c.pair, false, {}});
+                            if (c.op != OP_DWELL) continue;
+                            if (c.a > c.b) parser.fail(now, -1);
+                            for (int p = 0; p < pairCount; p++) {
+                                if (c.pair != COMMAND_ALL_PAIRS && c.pair != p) continue;
+                                sim.pair(p).dwellMinMs = c.a;
+                                sim.pair(p).dwellMaxMs = c.b;
+                            }
+                        }
+                    }
+                    if (r == CommandReader::READ_ERROR && sent.count && !corrupt &&
+                        (bad < 0 || reader.errorIndex() != bad || reader.batch().seq != sent.seq)) {
+                        parser.fail(now, -1);
+                    }
+                    for (const Action& a : actions) {
+                        CommandAction action = a.action;
+                        commands++;
+                        if (a.configure && !sim.setGroup(a.rules)) break; // Busy: the rest of the batch is dropped
+                        if (a.bind && !sim.setAux(a.binding)) break;
+                        if (action == CMD_PAUSE || action == CMD_RESUME) {
+                            sim.setPaused(a.pair == COMMAND_ALL_PAIRS ? -1 : a.pair, action == CMD_PAUSE);
+                            for (int i = 0; i < pairCount; i++) {
+                                if (a.pair != COMMAND_ALL_PAIRS && a.pair != i) continue;
+                                pausedSince[i] = now;
+                                if (action == CMD_PAUSE) events.push(Event{now + stopNs, EV_HOLD_CHECK, i, now});
+                            }
+                        }
+                        if (action == CMD_ENABLE && !sim.enabled()) {
+                            checkQuiet(now);
+                            sim.setEnabled(true);
+                        }
+                        if (action == CMD_DISABLE && sim.enabled()) {
+                            // One write per moving pair, but the group stops its
+                            // moving pairs together: one write per bank
+                            travelling = 0;
+                            uint32_t groupBanksMoving = 0;
+                            for (int i = 0; i < pairCount; i++) {
+                                const MotorTaskData& p = sim.pair(i);
+                                if (p.phase != PHASE_TRAVEL || p.paused) continue;
+                                if (groupMember(&sim.group(), i)) {
+                                    groupBanksMoving |= 1u << p.relayBank;
+                                } else {
+                                    travelling++;
+                                }
+                            }
+                            travelling += __builtin_popcount(groupBanksMoving);
+                            bool auxOn = false; // Off in a write of its own
+                            for (int c = 0; c < AUX_COUNT; c++) auxOn = auxOn || sim.group().aux[c].on;
+                            travelling += auxOn && !sim.group().paused;
+                            atDisable = world.busStats();
+#ifdef PAIR_NATIVE_GPIO
+                            disableEdges = world.sampleInterrupts();
+#endif
+                            sim.setEnabled(false);
+                            disabledSince = now;
+                            disables++;
+                            events.push(Event{now + stopNs, EV_STOP_CHECK, 0, now});
+                        }
+                    }
+                }
+                // A message is read as exactly one result, corrupted or not: a
+                // flipped bit never makes a delimiter or a newline
+                if (sent.count && results != 1) parser.fail(now, -1);
+            } else {
+                // A switch reads closed for a while: chatter, a stray hit or a stuck contact
+                MotorTaskData& p = sim.pair(rng() % pairCount);
+                int pin = (rng() & 1) ? p.inputB : p.inputA;
+                uint64_t holdNs = roll < 90 ? (uint64_t)(rng() % 200000) * 1000 : (uint64_t)(rng() % 10000) * NS_PER_MS;
+                glitches++;
+                heldLow[pin]++;
+                world.pull(sim.inputAddress(PCF_BANK(pin)), PCF_BIT(pin), true);
+                events.push(Event{now + holdNs, EV_RELEASE, pin, 0});
+                if (holdNs > stopNs) events.push(Event{now + stopNs, EV_LIMIT_CHECK, pin, 0});
+            }
+            nextRandom(now);
+            break;
+        }
+        case EV_RELEASE:
+            if (--heldLow[ev.pin] == 0) world.pull(sim.inputAddress(PCF_BANK(ev.pin)), PCF_BIT(ev.pin), false);
+            break;
+        case EV_STOP_CHECK:
+            if (sim.enabled() || disabledSince != ev.since) break; // Re-enabled since
+            for (int i = 0; i < pairCount; i++) {
+                if (relayOn(sim.pair(i).relayA) || relayOn(sim.pair(i).relayB)) stop.fail(now, i);
+                if (sim.pair(i).phase != PHASE_IDLE) unwind.fail(now, i);
+            }
+            for (int c = 0; c < AUX_COUNT && auxWired; c++) {
+                if (relayOn(AUX_PINS[c])) aux.fail(now, -1);
+            }
+            {
+                uint64_t writes = world.busStats().portWrites() - atDisable.portWrites(), cuts = 0;
+#ifdef PAIR_NATIVE_GPIO
+                // A switch that closed before its pair saw the disable: the
+                // handler's own write comes on top (at most one per interrupt)
+                cuts = world.sampleInterrupts() - disableEdges;
+#endif
+                if (writes < travelling || writes > travelling + cuts) unwind.fail(now, -1);
+            }
+            quietArmed = true;
+            quietFrom = world.busStats().transactions;
+#ifdef PAIR_MCP23017
+            quietFalls = world.sampleInterrupts();
+#endif
+            break;
+        case EV_HOLD_CHECK: {
+            // Still held since that pause, and the sequence is running: relays off
+            int i = ev.pin;
+            if (!sim.enabled() || !sim.paused(i) || pausedSince[i] != ev.since) break;
+            MotorTaskData& p = sim.pair(i);
+            if (!p.paused || relayOn(p.relayA) || relayOn(p.relayB)) hold.fail(now, i);
+            for (int c = 0; c < AUX_COUNT && auxWired && groupMember(&sim.group(), i); c++) {
+                if (relayOn(AUX_PINS[c])) aux.fail(now, -1);
+            }
+            break;
+        }
+        case EV_LIMIT_CHECK:
+            // Still held: the relay driving toward this switch must be off by now
+            if (!heldLow[ev.pin]) break;
+            for (int i = 0; i < pairCount; i++) {
+                MotorTaskData& p = sim.pair(i);
+                if (p.inputA == ev.pin && relayOn(p.relayA)) limit.fail(now, i);
+                if (p.inputB == ev.pin && relayOn(p.relayB)) limit.fail(now, i);
+            }
+            break;
+        }
+    }
+    sim.run(endNs);
+    checkQuiet(endNs);
+
+    uint64_t cycles = 0;
+    for (int i = 0; i < pairCount; i++) cycles += sim.pair(i).cycles;
+    if (world.interlockViolations() && !interlock.failures) interlock.fail(endNs, -1);
+    printf("CHAOS: %.2f h simulated, %d pairs, seed %lu: %llu commands (%llu batches, %llu disables), "
+           "%llu input glitches, %llu cycles, %llu steps\n",
+           sim.nowNs() / 3.6e12, pairCount, (unsigned long)opts.seed, (unsigned long long)commands,
+           (unsigned long long)batches, (unsigned long long)disables, (unsigned long long)glitches, (unsigned long long)cycles,
+           (unsigned long long)sim.steps());
+    bool ok = true;
+    for (const Property* p :
+         {&interlock, &stop, &limit, &spin, &unwind, &quiet, &state, &hold, &resume, &group, &inrush, &aux, &parser}) {
+        if (p->failures) {
+            printf("CHAOS: %-9s FAIL %llu times, first at %.3f s on pair %d\n", p->name,
+                   (unsigned long long)p->failures, p->firstNs / 1e9, p->firstPair);
+            ok = false;
+        } else {
+            printf("CHAOS: %-9s ok\n", p->name);
+        }
+    }
+    return ok ? 0 : 1;
+}
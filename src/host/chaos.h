@@ -0,0 +1,51 @@
+#pragma once
+
+// Property checker behind sim --chaos, and the checks the soak shares with
+// it. Kept out of sim_main.cpp so the unit tests (test/) run the same
+// checker on a few fixed seeds.
+
+#include <stdint.h>
+#include <deque>
+#include <random>
+#include <string>
+#include "commands.h"
+#include "pair_sim.h"
+#include "sim_options.h"
+#include "start_gate.h"
+
+// Motor starts the plant saw within any start window, as the gate counts
+// them: less the millisecond its clock rounds to and the write's bus time.
+struct StartCounter {
+    uint64_t windowNs = startGateWindowMs() > 2 ? (startGateWindowMs() - 2) * 1000000ULL : 0;
+    std::deque<uint64_t> recent;
+    int most = 0;
+    int add(uint64_t ns) {
+        while (!recent.empty() && ns - recent.front() >= windowNs) recent.pop_front();
+        recent.push_back(ns);
+        if ((int)recent.size() > most) most = (int)recent.size();
+        return (int)recent.size();
+    }
+};
+
+// Whether the window (ripple: step) the group has just started keeps its
+// rules, coming after selection after (0 for the first): the selection, one
+// write per member relay bank (a ripple: one, and one per further bank of
+// the members in deferred the gate let go with it), and the turned pairs'
+// relays.
+bool windowOk(PairSim& sim, uint16_t after, uint16_t deferred);
+
+// A random batch for the console, with some out-of-range arguments.
+// Returns the index of the first command the reader must reject, or -1.
+int randomBatch(std::mt19937& rng, int pairCount, uint16_t seq, CommandBatch& b);
+
+// The batch as a console text line, newline included.
+std::string textBatch(const CommandBatch& b);
+
+bool sameBatch(const CommandBatch& x, const CommandBatch& y);
+
+// Random serial traffic and limit-switch glitches, a random event every
+// meanMs on average, for hours of simulated time; the properties are listed
+// in sim_main.cpp. Prints a report. Returns 0 if every property held, 1 if
+// any failed, 2 if the expanders did not come up.
+int runChaos(const sim::PlantOptions& opts, const PairSimConfig& cfg, double hours, uint32_t meanMs,
+             uint32_t stopTicks);
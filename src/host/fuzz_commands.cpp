@@ -0,0 +1,219 @@
+// Console parser fuzz target ([env:fuzz_commands]).
+//
+// LLVMFuzzerTestOneInput() pushes arbitrary bytes through CommandReader, as
+// a noisy serial line would, and checks what comes out:
+//
+//   batch      1..COMMAND_BATCH_MAX known commands, every argument the
+//              console acts on in range for the reader's pair count;
+//              re-encoded as a frame it reads back identical (or, holding a
+//              dump, is refused as text-only at that command)
+//   error      a known reason, at a command index inside the batch
+//   frame      commandFrame() of the same bytes as a payload is delimited,
+//              has no 0x00 inside, fits the size its header promises, and
+//              reads back as exactly one result: the payload's own batch or
+//              an argument error if it is a whole number of commands, a
+//              syntax or length error otherwise, never a CRC error
+//
+// The first input byte picks the pair count (1..64). Any failed check
+// aborts, so the fuzzer keeps the input.
+//
+// Built with clang and -fsanitize=fuzzer this is a libFuzzer target.
+// Otherwise (gcc, the env's default) fuzz_main.cpp's driver runs it on
+// fuzzCommandInput()'s random inputs, or on the files given; the unit tests
+// (test/test_commands) run a short batch of them too:
+//
+//   .pio/build/fuzz_commands/program --runs 2000000 --seed 3
+//   .pio/build/fuzz_commands/program crash-1a2b3c
+//   clang++ -std=gnu++17 -g -O1 -fsanitize=fuzzer,address,undefined -Iinclude
+//       src/commands.cpp src/host/fuzz_commands.cpp -o fuzz_commands && ./fuzz_commands
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "commands.h"
+#include "fuzz_commands.h"
+#include "group_engine.h"
+
+static const int FUZZ_PAIRS_MAX = 64;
+
+static void fuzzFail(const char* what, int line) {
+    fprintf(stderr, "FUZZ: check failed at line %d: %s\n", line, what);
+    abort();
+}
+
+#define FUZZ_CHECK(cond) \
+    do { \
+        if (!(cond)) fuzzFail(#cond, __LINE__); \
+    } while (0)
+
+// Feed bytes to a fresh reader; the results that were not READ_NONE, and the
+// index of the byte each came on.
+struct ReadBack {
+    CommandReader reader;
+    std::vector<CommandReader::Result> results;
+    std::vector<size_t> at;
+    explicit ReadBack(int pairCount) : reader(pairCount) {}
+    void feed(const uint8_t* data, size_t n) {
+        for (size_t i = 0; i < n; i++) {
+            CommandReader::Result r = reader.feed(data[i]);
+            if (r == CommandReader::READ_NONE) continue;
+            results.push_back(r);
+            at.push_back(i);
+        }
+    }
+};
+
+static bool sameCommands(const CommandBatch& x, const CommandBatch& y) {
+    if (x.seq != y.seq || x.count != y.count) return false;
+    for (int i = 0; i < x.count; i++) {
+        const Command& a = x.cmds[i];
+        const Command& b = y.cmds[i];
+        if (a.op != b.op || a.pair != b.pair || a.a != b.a || a.b != b.b) return false;
+    }
+    return true;
+}
+
+static void checkBatch(const CommandBatch& b, int pairCount) {
+    FUZZ_CHECK(b.count >= 1 && b.count <= COMMAND_BATCH_MAX);
+    int textOnly = -1;
+    for (int i = 0; i < b.count; i++) {
+        const Command& c = b.cmds[i];
+        FUZZ_CHECK(c.op >= OP_ENABLE && c.op <= OP_AUX);
+        if (c.op == OP_EXPOSE || c.op == OP_RIPPLE) {
+            GroupRules rules = commandGroupRules(c);
+            bool ends = c.op == OP_EXPOSE ? !rules.k : !rules.windowMs;
+            FUZZ_CHECK(ends || (rules.first <= rules.last && rules.last < pairCount));
+        } else if (c.op == OP_AUX) {
+            FUZZ_CHECK(c.pair < AUX_COUNT && c.a <= AUX_STEP);
+        } else if (c.op == OP_DWELL || c.op == OP_STATUS || c.op == OP_PAUSE || c.op == OP_RESUME) {
+            FUZZ_CHECK(c.pair == COMMAND_ALL_PAIRS || c.pair < pairCount); // The console indexes by it
+        }
+        if (c.op == OP_DWELL) FUZZ_CHECK(c.a <= c.b);
+        if (c.op == OP_TRACE_DUMP && textOnly < 0) textOnly = i;
+    }
+    FUZZ_CHECK(!b.binary || textOnly < 0);
+
+    // Round trip through the binary form
+    uint8_t frame[COMMAND_PAYLOAD_MAX + 8];
+    size_t n = commandEncode(b, frame);
+    ReadBack back(pairCount);
+    back.feed(frame, n);
+    FUZZ_CHECK(back.results.size() == 1 && back.at[0] == n - 1);
+    if (textOnly >= 0) {
+        FUZZ_CHECK(back.results[0] == CommandReader::READ_ERROR && back.reader.error() == CMD_ERR_MODE &&
+                   back.reader.errorIndex() == textOnly);
+    } else {
+        FUZZ_CHECK(back.results[0] == CommandReader::READ_BATCH && back.reader.batch().binary &&
+                   sameCommands(back.reader.batch(), b));
+    }
+}
+
+static void checkFrame(const uint8_t* payload, size_t n, int pairCount) {
+    std::vector<uint8_t> frame(n + 2 + n / 254 + 4);
+    size_t len = commandFrame(payload, n, frame.data());
+    FUZZ_CHECK(len >= 4 && len <= frame.size());
+    FUZZ_CHECK(frame[0] == 0 && frame[len - 1] == 0);
+    for (size_t i = 1; i + 1 < len; i++) FUZZ_CHECK(frame[i] != 0);
+
+    ReadBack back(pairCount);
+    back.feed(frame.data(), len);
+    FUZZ_CHECK(back.results.size() == 1 && back.at[0] == len - 1);
+    const CommandReader& r = back.reader;
+    bool whole = n >= 2 + COMMAND_WIRE_BYTES && n <= 2 + COMMAND_BATCH_MAX * COMMAND_WIRE_BYTES &&
+                 (n - 2) % COMMAND_WIRE_BYTES == 0;
+    if (!whole) {
+        FUZZ_CHECK(back.results[0] == CommandReader::READ_ERROR &&
+                   (r.error() == CMD_ERR_SYNTAX || r.error() == CMD_ERR_TOO_LONG));
+        return;
+    }
+    uint16_t seq = (uint16_t)(payload[0] | payload[1] << 8);
+    FUZZ_CHECK(r.batch().seq == seq);
+    if (back.results[0] == CommandReader::READ_ERROR) {
+        FUZZ_CHECK(r.error() == CMD_ERR_OP || r.error() == CMD_ERR_ARG || r.error() == CMD_ERR_MODE);
+        FUZZ_CHECK(r.errorIndex() < (n - 2) / COMMAND_WIRE_BYTES);
+        return;
+    }
+    FUZZ_CHECK(back.results[0] == CommandReader::READ_BATCH);
+    const CommandBatch& b = r.batch();
+    FUZZ_CHECK(b.binary && b.count == (n - 2) / COMMAND_WIRE_BYTES);
+    for (int i = 0; i < b.count; i++) {
+        const uint8_t* w = payload + 2 + i * COMMAND_WIRE_BYTES;
+        const Command& c = b.cmds[i];
+        FUZZ_CHECK(c.op == w[0] && c.pair == w[1] && c.a == (w[2] | w[3] << 8) && c.b == (w[4] | w[5] << 8));
+    }
+    checkBatch(b, pairCount);
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    if (size < 1) return 0;
+    int pairCount = 1 + data[0] % FUZZ_PAIRS_MAX;
+    data++;
+    size--;
+
+    CommandReader reader(pairCount);
+    for (size_t i = 0; i < size; i++) {
+        switch (reader.feed(data[i])) {
+        case CommandReader::READ_NONE:
+            break;
+        case CommandReader::READ_SINGLE:
+            FUZZ_CHECK(data[i] == '\r' || data[i] == '\n');
+            FUZZ_CHECK(commandDecode(reader.single()) != CMD_NONE);
+            break;
+        case CommandReader::READ_BATCH:
+            checkBatch(reader.batch(), pairCount);
+            break;
+        case CommandReader::READ_ERROR:
+            FUZZ_CHECK(reader.error() > CMD_OK && reader.error() <= CMD_ERR_BUSY);
+            FUZZ_CHECK(reader.errorIndex() < COMMAND_BATCH_MAX);
+            break;
+        }
+    }
+
+    checkFrame(data, size < 256 ? size : 256, pairCount);
+    return 0;
+}
+
+// --- Random Inputs ---
+static const char* const SEED_LINES[] = {
+    "1 enable\n", "2 disable; status\n", "3 dwell * 500 900\n", "4 dwell 1 900 500\n", "5 status 2\n",
+    "6 pause; resume 0\n", "7 expose 2 0 5 3000 1 norepeat\n", "8 expose off\n", "9 ripple 0 5 150 10\n",
+    "10 ripple off\n", "11 aux 0 step 200; aux 1 off\n", "12 dump\n", "13 arm\n", "65535 enable; enable; enable\n",
+};
+
+void fuzzCommandInput(std::mt19937& rng, std::vector<uint8_t>& in) {
+    in.clear();
+    in.push_back((uint8_t)rng());
+    int pieces = 1 + rng() % 6;
+    for (int p = 0; p < pieces; p++) {
+        uint32_t pick = rng() % 10;
+        std::vector<uint8_t> piece;
+        if (pick < 3) {
+            const char* line = SEED_LINES[rng() % (sizeof(SEED_LINES) / sizeof(SEED_LINES[0]))];
+            piece.assign(line, line + strlen(line));
+        } else if (pick < 6) {
+            CommandBatch b = {};
+            b.seq = (uint16_t)rng();
+            b.count = (uint8_t)(1 + rng() % COMMAND_BATCH_MAX);
+            for (int i = 0; i < b.count; i++) {
+                b.cmds[i] = Command{(uint8_t)(rng() % 13), (uint8_t)(rng() % 4 ? rng() % 8 : COMMAND_ALL_PAIRS),
+                                    (uint16_t)(rng() % 4 ? rng() % 4000 : rng()), (uint16_t)(rng() % 4 ? rng() % 4000 : rng())};
+            }
+            uint8_t frame[COMMAND_PAYLOAD_MAX + 8];
+            piece.assign(frame, frame + commandEncode(b, frame));
+        } else if (pick < 8) {
+            piece.resize(rng() % 300);
+            for (uint8_t& byte : piece) byte = (uint8_t)rng();
+        } else {
+            // Overlong: a text line or a frame past the buffer
+            piece.assign(COMMAND_LINE_MAX + 1 + rng() % 64, (uint8_t)(rng() & 1 ? '7' : 0x55));
+            piece[0] = rng() & 1 ? '1' : 0x00;
+        }
+        if (!piece.empty() && rng() % 3 == 0) piece.resize(rng() % piece.size()); // Cut short
+        for (int flips = rng() % 3; flips > 0 && !piece.empty(); flips--) {
+            uint8_t& byte = piece[rng() % piece.size()];
+            static const uint8_t boundary[] = {0x00, '\n', '\r', ';', ' ', '*', 0xFF, 0x01};
+            byte = rng() & 1 ? (uint8_t)(byte ^ (1u << (rng() % 8))) : boundary[rng() % sizeof(boundary)];
+        }
+        in.insert(in.end(), piece.begin(), piece.end());
+    }
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+// Console parser fuzz target (fuzz_commands.cpp) and the random inputs the
+// stand-alone driver and the unit tests run it on.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <random>
+#include <vector>
+
+// Aborts on any failed check.
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size);
+
+// A random input built from pieces the reader cares about: whole text
+// lines and frames, cut short, run together, overlong, with bytes flipped
+// or delimiters dropped in, and plain noise.
+void fuzzCommandInput(std::mt19937& rng, std::vector<uint8_t>& in);
@@ -0,0 +1,62 @@
+// Stand-alone driver for the console parser fuzz target ([env:fuzz_commands],
+// without libFuzzer): random inputs from fuzzCommandInput(), or the files
+// given, through LLVMFuzzerTestOneInput().
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <random>
+#include <vector>
+#include "fuzz_commands.h"
+
+static void usage(const char* prog) {
+    printf("Usage: %s [options] [input files]\n"
+           "  --runs N     Random inputs to run when no files are given (default 200000)\n"
+           "  --seed S     Random seed (default 1)\n",
+           prog);
+}
+
+int main(int argc, char** argv) {
+    unsigned long runs = 200000, seed = 1;
+    std::vector<const char*> files;
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* val = i + 1 < argc ? argv[i + 1] : "";
+        if (!strcmp(arg, "--runs")) runs = strtoul(val, nullptr, 10), i++;
+        else if (!strcmp(arg, "--seed")) seed = strtoul(val, nullptr, 10), i++;
+        else if (!strcmp(arg, "--help") || arg[0] == '-') {
+            usage(argv[0]);
+            return 2;
+        } else {
+            files.push_back(arg);
+        }
+    }
+
+    if (!files.empty()) {
+        for (const char* path : files) {
+            FILE* f = fopen(path, "rb");
+            if (!f) {
+                fprintf(stderr, "FUZZ: cannot open %s\n", path);
+                return 2;
+            }
+            std::vector<uint8_t> in;
+            int c;
+            while ((c = fgetc(f)) != EOF) in.push_back((uint8_t)c);
+            fclose(f);
+            LLVMFuzzerTestOneInput(in.data(), in.size());
+        }
+        printf("FUZZ: %zu inputs ok\n", files.size());
+        return 0;
+    }
+
+    std::mt19937 rng(seed);
+    std::vector<uint8_t> in;
+    uint64_t bytes = 0;
+    for (unsigned long run = 0; run < runs; run++) {
+        fuzzCommandInput(rng, in);
+        bytes += in.size();
+        LLVMFuzzerTestOneInput(in.data(), in.size());
+    }
+    printf("FUZZ: %lu random inputs (%llu bytes), seed %lu: ok\n", runs, (unsigned long long)bytes, seed);
+    return 0;
+}
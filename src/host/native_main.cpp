@@ -0,0 +1,101 @@
+// Host entry point for [env:native]: runs the firmware's setup()/loop()
+// against simulated expanders and a motor model, in real time.
+//
+//   .pio/build/native/program --start --run-ms 20000 --travel-ms 800
+//
+// Type 's' / 'x' lines, or batches such as "1 dwell * 500 900; status", on stdin
+// exactly as on the board's serial console.
+
+#include <Arduino.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "config.h"
+#include "pair_io.h"
+#include "sim_options.h"
+#include "sim_world.h"
+
+void setup();
+void loop();
+
+// pio test -e native links this env's sources with a test's own main()
+#ifndef PIO_UNIT_TESTING
+
+#ifdef PAIR_INPUT_EDGES
+// The chips' shared INT line on EXPANDER_INT_GPIO, or the lane's input
+// GPIOs: the firmware's handler runs on every interrupt, looked for once a
+// tick.
+static void interruptLine(void*) {
+    uint64_t seen = sim::world().sampleInterrupts();
+    for (;;) {
+        vTaskDelay(1);
+        uint64_t falls = sim::world().sampleInterrupts();
+        if (falls != seen) {
+            seen = falls;
+            pcfInputsInterrupt();
+        }
+    }
+}
+#endif
+
+static void usage(const char* prog) {
+    printf("Usage: %s [options]\n", prog);
+    sim::printPlantUsage();
+    printf("  --start              Send 's' once setup() is done\n"
+           "  --run-ms N           Exit after N ms and print bus statistics\n");
+}
+
+int main(int argc, char** argv) {
+    sim::PlantOptions opts;
+    bool autostart = false;
+    unsigned long runMs = 0;
+
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* val = (i + 1 < argc) ? argv[i + 1] : nullptr;
+        if (!strcmp(arg, "--start")) { autostart = true; continue; }
+        if (!val) { usage(argv[0]); return 2; }
+        if (!strcmp(arg, "--run-ms")) runMs = strtoul(val, nullptr, 10);
+        else if (!sim::parsePlantOption(opts, arg, val)) { usage(argv[0]); return 2; }
+        i++;
+    }
+
+    sim::World& world = sim::world();
+    world.configureBus(opts.bus);
+    world.seed(opts.seed);
+#if defined(PAIR_NATIVE_GPIO)
+    world.attachGpio(PCF_ADDRESS_RELAYS, LANE_RELAY_GPIOS, PCF_PINS, true);
+    world.attachGpio(PCF_ADDRESS_INPUTS, LANE_INPUT_GPIOS, PCF_PINS, false);
+#elif defined(PAIR_MCP23017)
+    world.attachRegisters(PCF_ADDRESS_RELAYS);
+    world.attachRegisters(PCF_ADDRESS_INPUTS);
+#else
+    world.attach(PCF_ADDRESS_RELAYS, PCF_PINS / 8);
+    world.attach(PCF_ADDRESS_INPUTS, PCF_PINS / 8);
+#endif
+    for (int i = 0; i < PAIR_COUNT; i++) {
+        world.addMotor(PCF_ADDRESS_RELAYS, RELAY_PINS[i * 2], RELAY_PINS[i * 2 + 1],
+                       PCF_ADDRESS_INPUTS, INPUT_PINS[i * 2], INPUT_PINS[i * 2 + 1], opts.motor);
+    }
+
+    setup();
+#ifdef PAIR_INPUT_EDGES
+    xTaskCreate(interruptLine, "INT", 2048, NULL, 1, NULL);
+#endif
+    if (autostart) Serial.inject("s\n");
+
+    unsigned long start = millis();
+    while (!runMs || millis() - start < runMs) {
+        loop();
+    }
+
+    sim::BusStats stats = world.busStats();
+    unsigned long elapsed = millis() - start;
+    Serial.printf("\nSIM: %lu ms, %llu transactions, %llu bytes, bus busy %.1f%%, interlock violations %llu\n",
+                  elapsed, (unsigned long long)stats.transactions, (unsigned long long)stats.bytes,
+                  elapsed ? 100.0 * stats.busyNs / (elapsed * 1e6) : 0.0,
+                  (unsigned long long)world.interlockViolations());
+    return world.interlockViolations() ? 1 : 0;
+}
+
+#endif // PIO_UNIT_TESTING
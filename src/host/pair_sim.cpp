@@ -0,0 +1,347 @@
+#include "pair_sim.h"
+
+#include <Arduino.h>
+#include <algorithm>
+#include <stdio.h>
+#include <string.h>
+#include "commands.h"
+#include "config.h"
+#include "pair_io.h"
+#include "pair_policies.h"
+#include "pair_state.h"
+#include "sim_world.h"
+#include "start_gate.h"
+
+// Same drivers as the firmware, minus the log
+typedef PairEngine<PcfIo, MillisClock, TracedRandom, NullLog, GatedStarts> QuietEngine;
+typedef GroupEngine<PcfIo, MillisClock, TracedRandom, NullLog, GatedStarts> QuietGroup;
+
+static const uint64_t NS_PER_TICK = 1000000000ULL / configTICK_RATE_HZ;
+
+namespace {
+
+// Next free expander address, PCF8574 range first, then PCF8574A (the
+// PCF8575 has no A variant). Once those are exhausted the simulation carries
+// on with addresses no real bus has.
+uint8_t allocateAddress(std::vector<uint8_t>& used, bool& fits) {
+#if defined(PAIR_PCF8575) || defined(PAIR_MCP23017)
+    static const uint8_t ranges[][2] = {{0x20, 0x27}};
+#else
+    static const uint8_t ranges[][2] = {{0x20, 0x27}, {0x38, 0x3F}};
+#endif
+    for (const auto& r : ranges) {
+        for (uint8_t a = r[0]; a <= r[1]; a++) {
+            bool taken = false;
+            for (uint8_t u : used) taken |= (u == a);
+            if (!taken) {
+                used.push_back(a);
+                return a;
+            }
+        }
+    }
+    fits = false;
+    uint8_t a = (uint8_t)(0x40 + used.size());
+    used.push_back(a);
+    return a;
+}
+
+int relayPin(int pair, int side) { return pair < PAIR_COUNT ? RELAY_PINS[pair * 2 + side] : pair * 2 + side; }
+int inputPin(int pair, int side) { return pair < PAIR_COUNT ? INPUT_PINS[pair * 2 + side] : pair * 2 + side; }
+
+} // namespace
+
+bool parseExposeRules(const char* spec, GroupRules* out) {
+    unsigned k, first, last, window, gap = 0;
+    char tail[16] = "";
+    int n = sscanf(spec, "%u,%u,%u,%u,%u,%15s", &k, &first, &last, &window, &gap, tail);
+    if (n < 4 || k > EXPOSE_K_MASK || first > 0xFF || last > 0xFF || !window || window > 0xFFFF ||
+        gap > EXPOSE_GAP_MAX || (n == 6 && strcmp(tail, "norepeat"))) {
+        return false;
+    }
+    *out = GroupRules{(uint8_t)first, (uint8_t)last, (uint8_t)k, (uint8_t)gap, n == 6, (uint16_t)window};
+    return true;
+}
+
+bool parseRippleRules(const char* spec, GroupRules* out) {
+    unsigned first, last, stagger, hold = 0;
+    char tail;
+    int n = sscanf(spec, "%u,%u,%u,%u%c", &first, &last, &stagger, &hold, &tail);
+    if (n < 3 || n > 4 || first > 0xFF || last > 0xFF || !stagger || stagger > 0xFFFF || hold > 0xFF) return false;
+    *out = GroupRules{};
+    out->first = (uint8_t)first;
+    out->last = (uint8_t)last;
+    out->windowMs = (uint16_t)stagger;
+    out->mode = GROUP_RIPPLE;
+    out->holdSteps = (uint8_t)hold;
+    return true;
+}
+
+bool parseAuxBinding(const char* spec, AuxBinding* out) {
+    unsigned channel, pulse;
+    char event[8], tail;
+    if (sscanf(spec, "%u,%7[a-z],%u%c", &channel, event, &pulse, &tail) != 3) return false;
+    bool drill = !strcmp(event, "drill");
+    if ((!drill && strcmp(event, "step")) || channel >= AUX_COUNT || !pulse || pulse > AUX_PULSE_MAX_MS) return false;
+    *out = AuxBinding{(int)channel, drill ? AUX_DRILL : AUX_STEP, (uint16_t)pulse};
+    return true;
+}
+
+PairSim::PairSim(const sim::PlantOptions& plant, const PairSimConfig& cfg)
+    : plant_(plant), cfg_(cfg) {
+    int n = cfg.pairs > 0 ? cfg.pairs : PAIR_COUNT;
+    pairs_.resize(n > MAX_PAIRS ? MAX_PAIRS : n);
+}
+
+bool PairSim::begin() {
+    sim::setClock(&clock_);
+    sim::World& world = sim::world();
+    world.reset();
+    world.configureBus(plant_.bus);
+    world.seed(plant_.seed);
+    randomSeed(plant_.seed);
+    pcfResetBanks();
+    startGateReset();
+
+    // Bank 0 keeps the firmware's addresses (on a GPIO bank 0 they only name
+    // its ports); further banks get free ones.
+    int maxPin = 0;
+    for (int i = 0; i < pairCount(); i++) {
+        for (int side = 0; side < 2; side++) {
+            if (relayPin(i, side) > maxPin) maxPin = relayPin(i, side);
+            if (inputPin(i, side) > maxPin) maxPin = inputPin(i, side);
+        }
+    }
+    banks_ = PCF_BANK(maxPin) + 1;
+    addressesFit_ = true;
+    std::vector<uint8_t> used = {PCF_ADDRESS_RELAYS, PCF_ADDRESS_INPUTS};
+    relayAddr_ = {PCF_ADDRESS_RELAYS};
+    inputAddr_ = {PCF_ADDRESS_INPUTS};
+    for (int b = 1; b < banks_; b++) {
+        relayAddr_.push_back(allocateAddress(used, addressesFit_));
+        inputAddr_.push_back(allocateAddress(used, addressesFit_));
+        pcfAddBank(relayAddr_[b], inputAddr_[b]);
+    }
+    for (int b = 0; b < banks_; b++) {
+#if defined(PAIR_NATIVE_GPIO)
+        if (b < PCF_GPIO_BANKS) {
+            world.attachGpio(relayAddr_[b], LANE_RELAY_GPIOS, PCF_PINS, true);
+            world.attachGpio(inputAddr_[b], LANE_INPUT_GPIOS, PCF_PINS, false);
+        } else {
+            world.attach(relayAddr_[b], PCF_PINS / 8);
+            world.attach(inputAddr_[b], PCF_PINS / 8);
+        }
+#elif defined(PAIR_MCP23017)
+        world.attachRegisters(relayAddr_[b]);
+        world.attachRegisters(inputAddr_[b]);
+#else
+        world.attach(relayAddr_[b], PCF_PINS / 8);
+        world.attach(inputAddr_[b], PCF_PINS / 8);
+#endif
+    }
+
+    pcfBeginBus();
+    i2cMutex = xSemaphoreCreateMutex();
+    for (int i = 0; i < pairCount(); i++) {
+        MotorTaskData& p = pairs_[i];
+        p.pairIndex = i;
+        p.dwellMinMs = MIN_DELAY_MS;
+        p.dwellMaxMs = MAX_DELAY_MS;
+        motorAssignPins(&p, relayPin(i, 0), relayPin(i, 1), inputPin(i, 0), inputPin(i, 1));
+        if (cfg_.plant) {
+            world.addMotor(relayAddr_[PCF_BANK(p.relayA)], PCF_BIT(p.relayA), PCF_BIT(p.relayB),
+                           inputAddr_[PCF_BANK(p.inputA)], PCF_BIT(p.inputA), PCF_BIT(p.inputB), plant_.motor);
+        }
+        pcfRelayBank(PCF_BANK(p.relayA)).pinMode(PCF_BIT(p.relayA), OUTPUT);
+        pcfRelayBank(PCF_BANK(p.relayB)).pinMode(PCF_BIT(p.relayB), OUTPUT);
+        pcfInputBank(PCF_BANK(p.inputA)).pinMode(PCF_BIT(p.inputA), PCF_INPUT_MODE);
+        pcfInputBank(PCF_BANK(p.inputB)).pinMode(PCF_BIT(p.inputB), PCF_INPUT_MODE);
+    }
+    for (int c = 0; c < AUX_COUNT && pairCount() <= PAIR_COUNT; c++) { // As pcfConfigurePins()
+        pcfRelayBank(PCF_BANK(AUX_PINS[c])).pinMode(PCF_BIT(AUX_PINS[c]), OUTPUT);
+    }
+    for (int b = 0; b < banks_; b++) {
+        if (!pcfBeginBank(b)) return false;
+        pcfWriteRelays(PCF_ALL_HIGH, PCF_ALL_HIGH, b); // Every relay OFF, whatever an earlier run left
+        PcfPort inputs = 0;
+        for (const MotorTaskData& p : pairs_) {
+            if (p.inputBank == b) inputs |= p.inputMaskA | p.inputMaskB;
+        }
+        if (!pcfInputsCapture(b, inputs)) return false;
+    }
+    for (MotorTaskData& p : pairs_) {
+        motorReset(&p);
+        pairStatePublish(&p);
+    }
+    queue_ = decltype(queue_)();
+    startNs_.assign(pairCount(), -1);
+    gen_.assign(pairCount(), 0);
+    dueNs_.assign(pairCount() + 1, UINT64_MAX);
+    paused_.assign(pairCount(), false);
+    group_ = GroupData{};
+    group_.pairs = pairs_.data();
+    started_ = false;
+    interrupts_ = 0;
+    return true;
+}
+
+void PairSim::setStart(int pair, uint64_t ns) { startNs_[pair] = (int64_t)ns; }
+
+#ifdef PAIR_INPUT_EDGES
+void PairSim::deliverEdges(uint64_t untilNs) {
+    sim::World& world = sim::world();
+    while (true) {
+        uint64_t interrupts = world.sampleInterrupts();
+        if (interrupts != interrupts_) {
+            // The handler wakes every task, as setEnabled() does (one
+            // already due just runs when it was)
+            interrupts_ = interrupts;
+            clock_.sleepNs(cfg_.isrNs);
+            stepStartNs_ = clock_.nowNs();
+            pcfInputsInterrupt();
+            uint64_t now = clock_.nowNs();
+            for (int i = 0; i < pairCount(); i++) {
+                if (dueNs_[i] > now) push(Wake{now, i, ++gen_[i]});
+            }
+            if (dueNs_[pairCount()] > now) push(Wake{now, GROUP, ++groupGen_});
+            return;
+        }
+        // Nothing to signal yet: run the clock to the next input change
+        // that could, if it comes before the next wake
+        uint64_t edgeNs = world.nextEdgeNs();
+        if (edgeNs >= untilNs) return;
+        clock_.advanceTo(edgeNs);
+    }
+}
+#endif
+
+void PairSim::setEnabled(bool enabled) {
+    enabled_ = enabled;
+    if (!started_) return; // Everyone steps on the first run() anyway
+    for (int i = 0; i < pairCount(); i++) push(Wake{clock_.nowNs(), i, ++gen_[i]});
+    push(Wake{clock_.nowNs(), GROUP, ++groupGen_});
+}
+
+void PairSim::setPaused(int pair, bool paused) {
+    for (int i = 0; i < pairCount(); i++) {
+        if (pair >= 0 && pair != i) continue;
+        paused_[i] = paused;
+        if (started_) push(Wake{clock_.nowNs(), i, ++gen_[i]});
+    }
+    if (started_) push(Wake{clock_.nowNs(), GROUP, ++groupGen_});
+}
+
+bool PairSim::setGroup(const GroupRules& rules) {
+    bool idle = !enabled_ && !group_.running;
+    for (int i = 0; i < pairCount(); i++) idle = idle && !paused_[i] && pairs_[i].phase == PHASE_IDLE;
+    return idle && groupPlan(&group_, pairCount(), rules);
+}
+
+bool PairSim::setAux(const AuxBinding& b) {
+    bool idle = !enabled_ && !group_.running && pairCount() <= PAIR_COUNT;
+    for (int i = 0; i < pairCount(); i++) idle = idle && !paused_[i] && pairs_[i].phase == PHASE_IDLE;
+    return idle && groupSetAux(&group_, b.channel, b.event, b.pulseMs);
+}
+
+void PairSim::push(const Wake& w) {
+    if (w.pair != -1) dueNs_[w.pair == GROUP ? pairCount() : w.pair] = w.atNs;
+    queue_.push(w);
+}
+
+void PairSim::schedule(int pair, uint32_t gen, uint32_t waitMs) {
+    if (waitMs == MOTOR_WAIT_FOREVER) return; // Parked until setEnabled() / setPaused()
+    // vTaskDelay(n) wakes on the n-th tick interrupt from now, so a task
+    // whose work fits in a tick keeps its phase instead of drifting.
+    uint64_t now = clock_.nowNs();
+    uint64_t wakeNs = waitMs ? (now / NS_PER_TICK + pdMS_TO_TICKS(waitMs)) * NS_PER_TICK : now;
+    push(Wake{wakeNs, pair, gen});
+}
+
+uint64_t PairSim::flashDoneNs(uint64_t ns) const {
+    if (!cfg_.flashStallNs || !cfg_.flashPeriodNs) return ns;
+    uint64_t into = ns % cfg_.flashPeriodNs;
+    return into < cfg_.flashStallNs ? ns - into + cfg_.flashStallNs : ns;
+}
+
+void PairSim::run(uint64_t endNs, const std::function<bool()>& stop) {
+    if (!started_) {
+        uint64_t now = clock_.nowNs();
+        for (int i = 0; i < pairCount(); i++) {
+            push(Wake{startNs_[i] < 0 ? now : (uint64_t)startNs_[i], i, gen_[i]});
+        }
+        push(Wake{now, GROUP, groupGen_});
+        if (cfg_.loadPeriodNs) queue_.push(Wake{now + cfg_.loadPeriodNs, -1, 0});
+        started_ = true;
+    }
+
+    while (true) {
+        if (stop && stop()) return;
+#ifdef PAIR_INPUT_EDGES
+        deliverEdges(queue_.empty() ? endNs : std::min(queue_.top().atNs, endNs));
+#endif
+        if (queue_.empty() || queue_.top().atNs >= endNs) {
+            // Nothing due before endNs (every pair may be parked): time still passes
+            if (endNs != UINT64_MAX) clock_.advanceTo(endNs);
+            return;
+        }
+        Wake w = queue_.top();
+        queue_.pop();
+        if (w.pair >= 0 && w.gen != gen_[w.pair]) continue; // Superseded by an earlier wake
+        if (w.pair == GROUP && w.gen != groupGen_) continue;
+        if (w.pair >= 0 && groupMember(&group_, w.pair)) continue; // Its MotorTask stands aside
+        uint64_t resumeNs = flashDoneNs(w.atNs);
+        if (resumeNs > w.atNs) {
+            // Stalled behind a flash write; edges meanwhile still interrupt
+            w.atNs = resumeNs;
+            push(w);
+            continue;
+        }
+        // A wake-up that lands while the bus or CPU is still busy runs late.
+        clock_.advanceTo(w.atNs);
+        // Queued transactions (PAIR_I2C_ASYNC) finished meanwhile, as their
+        // completion interrupts would have, before anything else runs
+        sim::world().settle();
+
+        if (w.pair == -1) {
+            for (uint32_t i = 0; i < cfg_.loadReads; i++) pcfReadInput(0);
+            queue_.push(Wake{w.atNs + cfg_.loadPeriodNs, -1, 0});
+            continue;
+        }
+
+        current_ = w.pair;
+        stepStartNs_ = clock_.nowNs();
+        dueNs_[w.pair == GROUP ? pairCount() : w.pair] = UINT64_MAX; // Running, then blocked until pushed again
+        uint64_t writes = sim::world().busStats().portWrites();
+        uint32_t waitMs;
+        if (w.pair == GROUP) {
+            bool held = false;
+            for (int i = 0; i < group_.count; i++) held = held || paused_[group_.first + i];
+            waitMs = cfg_.log ? groupStep(&group_, enabled_, held) : QuietGroup::step(&group_, enabled_, held);
+            for (int i = 0; i < group_.count; i++) pairStatePublish(&pairs_[group_.first + i]);
+            groupStatePublish(&group_);
+        } else {
+            MotorTaskData* p = &pairs_[w.pair];
+            bool held = paused_[w.pair];
+            waitMs = cfg_.log ? motorStep(p, enabled_, held) : QuietEngine::step(p, enabled_, held);
+            pairStatePublish(p);
+        }
+        pcfInputsService();
+        stepWrites_ = sim::world().busStats().portWrites() - writes;
+        clock_.sleepNs(cfg_.stepNs);
+        current_ = -1;
+        steps_++;
+        if (w.pair == GROUP) {
+            if (afterGroupStep) afterGroupStep();
+            for (int i = 0; i < group_.count && afterStep; i++) afterStep(group_.first + i);
+        } else if (afterStep) {
+            afterStep(w.pair);
+        }
+        uint32_t gen = w.pair == GROUP ? groupGen_ : gen_[w.pair];
+        if (waitMs == 0) {
+            // More to do at once: the task does not block, so it runs again
+            // before anything queued behind it
+            push(Wake{w.atNs, w.pair, gen});
+            continue;
+        }
+        schedule(w.pair, gen, waitMs);
+    }
+}
@@ -0,0 +1,147 @@
+#pragma once
+
+// Shared discrete-event harness for the host programs: runs every pair's
+// motorStep() (and the pair group's groupStep(), as GroupTask) on a
+// sim::VirtualClock against the simulated expanders.
+
+#include <stdint.h>
+#include <functional>
+#include <queue>
+#include <vector>
+#include "group_engine.h"
+#include "pair_engine.h"
+#include "pair_io.h"
+#include "sim_clock.h"
+#include "sim_options.h"
+
+struct PairSimConfig {
+    int pairs = 0;                // 0 = PAIR_COUNT from config.h
+    uint64_t stepNs = 10000;      // CPU time charged per motorStep() call
+    uint64_t loadPeriodNs = 0;    // Background bus reader period (0 = none)
+    uint32_t loadReads = 1;       // Input-expander reads per background wake-up
+    bool plant = true;            // false: no motors, the harness drives the inputs (World::pull)
+    bool log = true;              // false: run the engine with NullLog (no serial formatting at all)
+    uint64_t isrNs = 2000;        // Edge to the first instruction of pcfInputsInterrupt()
+    // A flash write (an NVS save) starting every flashPeriodNs turns the
+    // cache off for flashStallNs: no task runs, only interrupt handlers in
+    // IRAM (pcfInputsInterrupt()) do. 0 = none.
+    uint64_t flashStallNs = 0;
+    uint64_t flashPeriodNs = 0;
+};
+
+// "K,FIRST,LAST,WINDOW_MS[,GAP[,norepeat]]" as the host programs' --expose,
+// and "FIRST,LAST,STAGGER_MS[,HOLD_STEPS]" as their --ripple.
+bool parseExposeRules(const char* spec, GroupRules* out);
+bool parseRippleRules(const char* spec, GroupRules* out);
+
+// "CHANNEL,drill|step,PULSE_MS" as the host programs' --aux.
+struct AuxBinding {
+    int channel;
+    uint8_t event; // AuxEvent
+    uint16_t pulseMs;
+};
+bool parseAuxBinding(const char* spec, AuxBinding* out);
+
+class PairSim {
+public:
+    // PCF_PINS / 2 pairs per relay + input expander bank, one state slot each
+    static const int MAX_PAIRS = PCF_MAX_BANKS * PCF_PINS / 2 < PAIR_STATE_SLOTS ? PCF_MAX_BANKS * PCF_PINS / 2
+                                                                                : PAIR_STATE_SLOTS;
+    static const int GROUP = -2; // currentPair() inside groupStep()
+
+    PairSim(const sim::PlantOptions& plant, const PairSimConfig& cfg);
+
+    // Wires the motors, configures the expanders and resets every pair.
+    bool begin();
+
+    // First wake-up of a pair (default: when run() is first called). Call
+    // between begin() and run().
+    void setStart(int pair, uint64_t ns);
+
+    // Steps pairs in wake-up order until the virtual clock reaches endNs or
+    // stop() returns true. Can be called again to continue.
+    void run(uint64_t endNs, const std::function<bool()>& stop = nullptr);
+
+    int pairCount() const { return (int)pairs_.size(); }
+    int currentPair() const { return current_; } // Pair inside motorStep(), GROUP, -1 outside
+    uint64_t stepStartNs() const { return stepStartNs_; } // When the current (or last) motorStep() or input interrupt began
+    MotorTaskData& pair(int i) { return pairs_[i]; }
+    uint64_t nowNs() { return clock_.nowNs(); }
+    uint64_t steps() const { return steps_; }
+    uint64_t stepWrites() const { return stepWrites_; } // Relay port writes the last step made (bus or GPIO)
+
+    // Expander chips on the bus, and whether they all fit the sixteen
+    // addresses PCF8574 (0x20-0x27) and PCF8574A (0x38-0x3F) can take (the
+    // eight of 0x20-0x27 for PCF8575s and MCP23017s). A GPIO bank has none.
+    int bankCount() const { return banks_; }
+    int expanderCount() const { return 2 * (banks_ - PCF_GPIO_BANKS); }
+    bool addressesFit() const { return addressesFit_; }
+    uint8_t relayAddress(int bank) const { return relayAddr_[bank]; }
+    uint8_t inputAddress(int bank) const { return inputAddr_[bank]; }
+
+    // The firmware's setSequenceEnabled(): the flag passed to motorStep(),
+    // and every pair wakes now, cutting short whatever wait it was in.
+    void setEnabled(bool enabled);
+    bool enabled() const { return enabled_; }
+
+    // The firmware's setPaused(): hold or release a pair (-1: every pair),
+    // waking it now.
+    void setPaused(int pair, bool paused);
+    bool paused(int pair) const { return paused_[pair]; }
+
+    // The console's expose and ripple: set up, replace or end the group.
+    // False, changing nothing, unless the sequence is disabled and every
+    // pair idle and released, or if no group fits the rules.
+    bool setGroup(const GroupRules& rules);
+    const GroupData& group() const { return group_; }
+
+    // The console's aux: bind an aux output, under the same conditions as
+    // setGroup(). Also false while more than PAIR_COUNT pairs run: the
+    // extra pairs are wired to the aux pins.
+    bool setAux(const AuxBinding& binding);
+
+    std::function<void(int pair)> afterStep;  // Observe a pair right after it ran (members: after each group step)
+    std::function<void()> afterGroupStep;     // Observe the group right after it ran, before its members
+
+private:
+    void schedule(int pair, uint32_t gen, uint32_t waitMs);
+    uint64_t flashDoneNs(uint64_t ns) const; // ns, or the end of the flash write it falls in
+#ifdef PAIR_INPUT_EDGES
+    // Fire pcfInputsInterrupt() when the shared INT line falls or a watched
+    // GPIO changes, stepping the clock through input changes before untilNs
+    // to find out when it does.
+    void deliverEdges(uint64_t untilNs);
+#endif
+
+    struct Wake {
+        uint64_t atNs;
+        int pair;     // -1: background load, GROUP: the group
+        uint32_t gen; // Stale once the pair has been woken again
+        bool operator>(const Wake& o) const {
+            return atNs != o.atNs ? atNs > o.atNs : pair > o.pair; // Ties: lowest pair first
+        }
+    };
+    void push(const Wake& w); // Queue a wake, noting when a pair (or the group) is next due
+
+    sim::PlantOptions plant_;
+    PairSimConfig cfg_;
+    sim::VirtualClock clock_;
+    std::vector<MotorTaskData> pairs_;
+    std::priority_queue<Wake, std::vector<Wake>, std::greater<Wake>> queue_;
+    std::vector<int64_t> startNs_; // -1: start with the first run()
+    std::vector<uint32_t> gen_;    // Current wake-up generation per pair
+    std::vector<uint64_t> dueNs_;  // Per pair, then the group: current wake, UINT64_MAX if none
+    std::vector<bool> paused_;     // Passed to motorStep()
+    GroupData group_ = {};
+    uint32_t groupGen_ = 0;
+    bool enabled_ = true;
+    bool started_ = false;
+    uint64_t interrupts_ = 0; // Input interrupts already handled
+    int current_ = -1;
+    uint64_t stepStartNs_ = 0;
+    uint64_t steps_ = 0;
+    uint64_t stepWrites_ = 0;
+    int banks_ = 1;
+    bool addressesFit_ = true;
+    std::vector<uint8_t> relayAddr_, inputAddr_;
+};
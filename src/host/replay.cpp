@@ -0,0 +1,389 @@
+// Golden-trace replay ([env:replay]).
+//
+// Feeds a trace captured on the range ('d' on the serial console, see
+// include/trace.h) back through the engine and the I2C layer on the virtual
+// clock, and compares the relay timeline the native build produces with
+// the one the firmware recorded:
+//
+//   - input edges are pulled on the simulated input expanders at the time
+//     the firmware observed them, less --edge-lead-us (the port is sampled
+//     during the read and stamped after it; every pair reads the whole
+//     bank, so the previous read of it may be only a transaction earlier);
+//     a GPIO bank's edges are stamped by the interrupt handler, so they are
+//     applied PairSimConfig::isrNs before instead
+//   - serial commands and pause holds are applied at their recorded time
+//     (the firmware wakes the tasks as it changes the flag)
+//   - every dwell is answered from the recorded draws, per pair, and every
+//     group selection from the recorded picks
+//   - a group is set up again from its TRACE_GROUP records, and its aux
+//     outputs bound again from their TRACE_AUX records
+//   - each MotorTask starts at its recorded start time
+//
+// A relay pin whose sequence of levels differs is a divergence; a commit
+// that matches but lands more than --tol-us from the recording is a timing
+// difference. Either makes the exit status 1.
+//
+// --record writes a trace from the simulated plant instead, e.g. to check
+// the tool itself or to keep a golden trace next to a change.
+//
+//   .pio/build/replay/program --trace range.log --tol-us 2000
+//   .pio/build/replay/program --record golden.log --minutes 10 --travel-jitter-ms 40
+
+#include <Arduino.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <deque>
+#include <map>
+#include <vector>
+#include "commands.h"
+#include "config.h"
+#include "pair_sim.h"
+#include "sim_options.h"
+#include "sim_stats.h"
+#include "sim_world.h"
+#include "trace.h"
+
+static const uint64_t NS_PER_US = 1000ULL;
+
+// One record with its micros() wraps folded back in, relative to TRACE_BOOT.
+struct Event {
+    uint64_t us;
+    uint8_t type;
+    uint8_t arg;
+    uint16_t value;
+};
+
+static std::vector<Event> unwrap(const std::vector<TraceRecord>& records) {
+    std::vector<Event> out;
+    uint64_t epoch = 0, last = 0, boot = 0;
+    bool haveBoot = false;
+    for (const TraceRecord& r : records) {
+        if (r.type == TRACE_EPOCH) {
+            epoch = r.value;
+            continue;
+        }
+        uint64_t t = (epoch << 32) | r.us;
+        // A record stamped just before a wrap can land after the EPOCH marker
+        if (t > last + (1ULL << 31) && epoch > 0) t -= 1ULL << 32;
+        last = t;
+        if (r.type == TRACE_BOOT) {
+            boot = t;
+            haveBoot = true;
+        }
+        out.push_back(Event{haveBoot ? t - boot : 0, r.type, r.arg, r.value});
+    }
+    return out;
+}
+
+static bool loadTrace(const char* path, std::vector<TraceRecord>& records, bool& full) {
+    FILE* f = fopen(path, "r");
+    if (!f) return false;
+    char line[256];
+    bool inside = false;
+    while (fgets(line, sizeof(line), f)) {
+        // Serial captures interleave the dump with the firmware's own log;
+        // take the last complete BEGIN..END block.
+        const char* begin = strstr(line, "TRACE BEGIN");
+        if (begin) {
+            records.clear();
+            full = strstr(begin, "FULL") != nullptr;
+            inside = true;
+            continue;
+        }
+        if (strstr(line, "TRACE END")) {
+            inside = false;
+            continue;
+        }
+        unsigned long us;
+        char type;
+        unsigned arg, value;
+        if (inside && sscanf(line, "T %lu %c %u %u", &us, &type, &arg, &value) == 4) {
+            records.push_back(TraceRecord{(uint32_t)us, (uint8_t)type, (uint8_t)arg, (uint16_t)value});
+        }
+    }
+    fclose(f);
+    return true;
+}
+
+static bool writeTrace(const char* path, const TraceRecord* records, uint32_t n, bool full) {
+    FILE* f = fopen(path, "w");
+    if (!f) return false;
+    fprintf(f, "TRACE BEGIN %lu%s\n", (unsigned long)n, full ? " FULL" : "");
+    for (uint32_t i = 0; i < n; i++) {
+        fprintf(f, "T %lu %c %u %u\n", (unsigned long)records[i].us, (char)records[i].type, records[i].arg,
+                records[i].value);
+    }
+    fprintf(f, "TRACE END\n");
+    fclose(f);
+    return true;
+}
+
+// --- Record ---
+static int record(const char* path, const sim::PlantOptions& opts, double minutes, const GroupRules& group,
+                  const std::vector<AuxBinding>& aux) {
+    PairSimConfig cfg;
+    PairSim sim(opts, cfg);
+    if (!sim.begin()) return 2;
+    sim.setEnabled(false);
+    traceBegin(sim.pairCount(), 0);
+    for (int i = 0; i < sim.pairCount(); i++) traceRecord(TRACE_TASK, i, 0);
+
+    // Boot idle, as the firmware sits until 's' arrives
+    sim.run(sim.nowNs() + 1000000000ULL);
+    if (group.windowMs) {
+        if (!sim.setGroup(group)) {
+            fprintf(stderr, "REPLAY: no group fits --expose / --ripple\n");
+            return 2;
+        }
+        groupTrace(group);
+    }
+    for (const AuxBinding& b : aux) {
+        if (!sim.setAux(b)) {
+            fprintf(stderr, "REPLAY: --aux needs at most %d pairs\n", PAIR_COUNT);
+            return 2;
+        }
+        groupTraceAux(&sim.group(), b.channel);
+    }
+    traceRecord(TRACE_COMMAND, 's', 0);
+    sim.setEnabled(true);
+    sim.run(sim.nowNs() + (uint64_t)(minutes * 60e9), [] { return traceFull(); });
+
+    if (!writeTrace(path, traceRecords(), traceCount(), traceFull())) return 2;
+    printf("REPLAY: recorded %lu records, %d pairs, %.1f min to %s\n", (unsigned long)traceCount(),
+           sim.pairCount(), sim.nowNs() / 60e9, path);
+    return 0;
+}
+
+// --- Replay ---
+struct Commit {
+    uint64_t us;
+    uint8_t level;
+};
+
+static int replay(const char* path, const sim::PlantOptions& opts, uint64_t tolUs, uint32_t leadUs, bool verbose) {
+    std::vector<TraceRecord> raw;
+    bool full = false;
+    if (!loadTrace(path, raw, full)) {
+        fprintf(stderr, "REPLAY: cannot read %s\n", path);
+        return 2;
+    }
+    if (raw.empty() || raw[0].type != TRACE_BOOT) {
+        fprintf(stderr, "REPLAY: no trace found in %s (expected TRACE BEGIN / T B ...)\n", path);
+        return 2;
+    }
+    std::vector<Event> recorded = unwrap(raw);
+    uint64_t endUs = recorded.back().us;
+
+    PairSimConfig cfg;
+    cfg.pairs = raw[0].arg;
+    cfg.plant = false;
+    cfg.log = verbose;
+    PairSim sim(opts, cfg);
+    if (!sim.begin()) return 2;
+    sim.setEnabled(false); // sequenceEnabled at boot
+    for (int i = 0; i < sim.pairCount(); i++) {
+        if (raw[0].value & (1 << i)) sim.pair(i).activeRelayA = false;
+    }
+
+    // Everything recorded is relative to TRACE_BOOT; in the replay that is now.
+    uint64_t baseNs = sim.nowNs();
+    std::vector<std::deque<long>> dwells(sim.pairCount());
+    std::deque<long> picks;
+    struct Inject {
+        uint64_t atNs;
+        const Event* e;
+    };
+    std::vector<Inject> injects;
+    for (const Event& e : recorded) {
+        uint64_t atNs = baseNs + e.us * NS_PER_US;
+        switch (e.type) {
+        case TRACE_TASK:
+            if (e.arg < sim.pairCount()) sim.setStart(e.arg, atNs);
+            break;
+        case TRACE_DWELL:
+            if (e.arg < sim.pairCount()) dwells[e.arg].push_back(e.value);
+            break;
+        case TRACE_PICK:
+            picks.push_back(e.value);
+            break;
+        case TRACE_INPUT: {
+            uint64_t leadNs = PCF_BANK(e.arg) < PCF_GPIO_BANKS ? cfg.isrNs : (uint64_t)leadUs * NS_PER_US;
+            uint64_t pullNs = atNs > baseNs + leadNs ? atNs - leadNs : baseNs;
+            if (PCF_BANK(e.arg) < sim.bankCount()) {
+                sim::world().pullAt(pullNs, sim.inputAddress(PCF_BANK(e.arg)), PCF_BIT(e.arg), e.value == LOW);
+            }
+            break;
+        }
+        case TRACE_COMMAND:
+        case TRACE_PAUSE:
+        case TRACE_GROUP:
+        case TRACE_AUX:
+            injects.push_back(Inject{atNs, &e});
+            break;
+        }
+    }
+    std::stable_sort(injects.begin(), injects.end(), [](const Inject& a, const Inject& b) { return a.atNs < b.atNs; });
+
+    uint64_t missingDwells = 0;
+    simSetRandomHook([&](long min, long max) -> long {
+        int p = sim.currentPair();
+        std::deque<long>* q = p == PairSim::GROUP ? &picks : p >= 0 ? &dwells[p] : nullptr;
+        if (!q || q->empty()) {
+            missingDwells++;
+            return (min + max) / 2;
+        }
+        long v = q->front();
+        q->pop_front();
+        return v;
+    });
+
+    traceBegin(sim.pairCount(), raw[0].value);
+    uint16_t groupFields[GROUP_TRACE_FIELDS] = {};
+    uint64_t groupsRefused = 0;
+    for (const Inject& in : injects) {
+        sim.run(in.atNs);
+        if (in.e->type == TRACE_PAUSE) {
+            sim.setPaused(in.e->arg == COMMAND_ALL_PAIRS ? -1 : in.e->arg, in.e->value != 0);
+            continue;
+        }
+        if (in.e->type == TRACE_GROUP) {
+            if (in.e->arg < GROUP_TRACE_FIELDS) groupFields[in.e->arg] = in.e->value;
+            if (in.e->arg != GROUP_TRACE_FIELDS - 1) continue;
+            if (!sim.setGroup(groupTraceRules(groupFields))) groupsRefused++;
+            continue;
+        }
+        if (in.e->type == TRACE_AUX) {
+            AuxBinding b = {in.e->arg, (uint8_t)(in.e->value >> 14), (uint16_t)(in.e->value & AUX_PULSE_MAX_MS)};
+            if (!sim.setAux(b)) groupsRefused++;
+            continue;
+        }
+        CommandAction action = commandDecode((char)in.e->arg);
+        // As the console: only a change of state notifies the tasks
+        if (action == CMD_ENABLE && !sim.enabled()) sim.setEnabled(true);
+        if (action == CMD_DISABLE && sim.enabled()) sim.setEnabled(false);
+    }
+    sim.run(baseNs + (endUs + tolUs) * NS_PER_US);
+    simSetRandomHook(nullptr);
+
+    // --- Compare Relay Timelines ---
+    std::vector<TraceRecord> replayedRaw(traceRecords(), traceRecords() + traceCount());
+    std::vector<Event> replayed = unwrap(replayedRaw);
+    std::map<int, std::vector<Commit>> recCommits, repCommits;
+    for (const Event& e : recorded) {
+        if (e.type == TRACE_RELAY) recCommits[e.arg].push_back(Commit{e.us, (uint8_t)e.value});
+    }
+    for (const Event& e : replayed) {
+        if (e.type == TRACE_RELAY && e.us <= endUs + tolUs) repCommits[e.arg].push_back(Commit{e.us, (uint8_t)e.value});
+    }
+
+    sim::Histogram diffUs(1, 1 << 20);
+    uint64_t compared = 0, late = 0, early = 0, divergent = 0;
+    for (auto& kv : recCommits) repCommits[kv.first]; // Pins only the recording drove
+    for (auto& kv : repCommits) {
+        int pin = kv.first;
+        const std::vector<Commit>& rec = recCommits[pin];
+        const std::vector<Commit>& rep = kv.second;
+        size_t n = std::min(rec.size(), rep.size());
+        size_t i = 0;
+        for (; i < n; i++) {
+            if (rec[i].level != rep[i].level) break;
+            int64_t d = (int64_t)rep[i].us - (int64_t)rec[i].us;
+            uint64_t a = d < 0 ? -d : d;
+            diffUs.add(a);
+            compared++;
+            if (a > tolUs) {
+                (d > 0 ? late : early)++;
+                if (verbose) {
+                    printf("  relay %d commit %zu (%s): recorded %.3f s, replay %+.3f ms\n", pin, i,
+                           rec[i].level == LOW ? "ON" : "OFF", rec[i].us / 1e6, d / 1e3);
+                }
+            }
+        }
+        // The recording may stop mid-move when it is full; a replay commit
+        // past the last recorded one is not a divergence.
+        bool tailOnly = i == n && rep.size() > rec.size() && full;
+        if ((i < n || rec.size() != rep.size()) && !tailOnly) {
+            divergent++;
+            printf("REPLAY: relay %d diverges at commit %zu: recorded %zu commits, replay %zu", pin, i, rec.size(),
+                   rep.size());
+            if (i < n) printf(" (recorded %s at %.3f s, replay %s at %.3f s)", rec[i].level == LOW ? "ON" : "OFF",
+                              rec[i].us / 1e6, rep[i].level == LOW ? "ON" : "OFF", rep[i].us / 1e6);
+            printf("\n");
+        }
+    }
+    uint64_t leftoverDwells = picks.size();
+    for (const auto& q : dwells) leftoverDwells += q.size();
+
+    printf("REPLAY: %s, %lu records, %.1f s, %d pairs%s\n", path, (unsigned long)raw.size(), endUs / 1e6,
+           sim.pairCount(), full ? " (recording was full)" : "");
+    printf("REPLAY: %llu relay commits compared, |replay - recorded| p50 %llu us, p99 %llu us, max %llu us\n",
+           (unsigned long long)compared, (unsigned long long)diffUs.percentile(50),
+           (unsigned long long)diffUs.percentile(99), (unsigned long long)diffUs.max());
+    printf("REPLAY: beyond %llu us: %llu late, %llu early; divergent relays %llu; random draws missing %llu, unused %llu\n",
+           (unsigned long long)tolUs, (unsigned long long)late, (unsigned long long)early,
+           (unsigned long long)divergent, (unsigned long long)missingDwells, (unsigned long long)leftoverDwells);
+    if (groupsRefused) printf("REPLAY: %llu group or aux setups refused\n", (unsigned long long)groupsRefused);
+    // Unused draws are normal at the end of a full recording (the last dwell
+    // was drawn but its commits fell outside the window), so only missing
+    // draws count against the replay.
+    bool ok = !divergent && !late && !early && !missingDwells && !groupsRefused;
+    printf("REPLAY: %s\n", ok ? "MATCH" : "MISMATCH");
+    return ok ? 0 : 1;
+}
+
+static void usage(const char* prog) {
+    printf("Usage: %s --trace FILE [options] | --record FILE [options]\n", prog);
+    sim::printPlantUsage();
+    printf("  --trace FILE         Serial capture containing a trace dump to replay\n"
+           "  --tol-us N           Allowed commit time difference (default 2000)\n"
+           "  --edge-lead-us N     Apply input edges this much before they were observed (default 50)\n"
+           "  --verbose            List every commit beyond the tolerance and the firmware log\n"
+           "  --record FILE        Write a trace from the simulated plant instead\n"
+           "  --minutes M          Length of a --record run (default 10)\n"
+           "  --expose K,FIRST,LAST,WINDOW_MS[,GAP[,norepeat]]\n"
+           "                       Record with pairs FIRST..LAST as an exposure group\n"
+           "  --ripple FIRST,LAST,STAGGER_MS[,HOLD_STEPS]\n"
+           "                       Record with pairs FIRST..LAST as a ripple\n"
+           "  --aux CHANNEL,drill|step,PULSE_MS\n"
+           "                       Record with an aux output bound (repeatable)\n");
+}
+
+int main(int argc, char** argv) {
+    sim::PlantOptions opts;
+    const char* tracePath = nullptr;
+    const char* recordPath = nullptr;
+    uint64_t tolUs = 2000;
+    uint32_t leadUs = 50;
+    double minutes = 10.0;
+    bool verbose = false;
+    GroupRules group = {};
+    std::vector<AuxBinding> aux;
+
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        if (!strcmp(arg, "--verbose")) { verbose = true; continue; }
+        const char* val = (i + 1 < argc) ? argv[i + 1] : nullptr;
+        if (!val) { usage(argv[0]); return 2; }
+        if (!strcmp(arg, "--trace")) tracePath = val;
+        else if (!strcmp(arg, "--record")) recordPath = val;
+        else if (!strcmp(arg, "--tol-us")) tolUs = strtoull(val, nullptr, 10);
+        else if (!strcmp(arg, "--edge-lead-us")) leadUs = strtoul(val, nullptr, 10);
+        else if (!strcmp(arg, "--minutes")) minutes = atof(val);
+        else if (!strcmp(arg, "--expose")) { if (!parseExposeRules(val, &group)) { usage(argv[0]); return 2; } }
+        else if (!strcmp(arg, "--ripple")) { if (!parseRippleRules(val, &group)) { usage(argv[0]); return 2; } }
+        else if (!strcmp(arg, "--aux")) {
+            AuxBinding b;
+            if (!parseAuxBinding(val, &b)) { usage(argv[0]); return 2; }
+            aux.push_back(b);
+        }
+        else if (!sim::parsePlantOption(opts, arg, val)) { usage(argv[0]); return 2; }
+        i++;
+    }
+    if (!tracePath == !recordPath) { usage(argv[0]); return 2; }
+
+    Serial.mute(!verbose);
+    if (recordPath) return record(recordPath, opts, minutes, group, aux);
+    return replay(tracePath, opts, tolUs, leadUs, verbose);
+}
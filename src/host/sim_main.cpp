@@ -0,0 +1,354 @@
+// Discrete-event soak simulator for the pair engine ([env:sim]).
+//
+// Every pair's motorStep() runs on a virtual clock: instead of sleeping,
+// each pair is queued to wake when its step asks to, and the clock jumps
+// straight to the next wake-up. Bus transfers advance the clock by their
+// modeled duration, so the result is the same sequence of I2C traffic and
+// relay edges the board would produce, only months of it in seconds.
+//
+//   .pio/build/sim/program --days 7 --travel-jitter-ms 150 --bounce-us 3000
+//
+// --expose runs pairs FIRST..LAST as an exposure group (group_engine.h) and
+// checks every window against its rules: K exposed, GAP, no repeats, and
+// one relay write per bank at the boundary. A window whose selection was
+// not all in place when the next one began (travel longer than the window)
+// is reported as late. Every scheduled face is timed against its boundary
+// and reported per pair (face: how far off, either way), and the spread
+// between a window's first and last face against GROUP_FACE_TOLERANCE_MS;
+// --lane-spread-ms gives each motor its own speed for the group to learn. --ripple runs them
+// as a ripple instead, checking that every step turns the next pair in line
+// with a single write.
+//
+//   .pio/build/sim/program --hours 12 --expose 2,0,5,3000,1,norepeat --pairs 6 --lane-spread-ms 300
+//   .pio/build/sim/program --hours 12 --ripple 0,5,150,10 --pairs 6
+//
+// --aux binds an aux output to the group's events (up to PAIR_COUNT pairs:
+// more are wired to the aux pins) and checks every pulse: that it began in
+// its boundary's write and how long it lasted.
+//
+//   .pio/build/sim/program --hours 12 --expose 1,0,2,3000 --aux 0,step,200 --aux 1,drill,1000
+//
+// --chaos turns it into a property checker: random serial traffic (command
+// letters, text and binary batches, some corrupted, all through the
+// firmware's own CommandReader) and spurious or stuck limit-switch inputs
+// are thrown at the pairs, and after every step the run checks
+//
+//   interlock   both relays of a pair are never on together
+//   stop        after a disable, every relay is off within --stop-ticks
+//   limit       a closed limit switch releases its relay within --stop-ticks
+//   spin        no pair wakes back-to-back without a tick passing (a task
+//               that never sleeps starves the idle task and trips the WDT)
+//   unwind      by the stop deadline every pair is Idle, having made exactly
+//               one relay write if it was travelling and none otherwise
+//   quiet       from then until the next enable, no bus transaction at all
+//               (MCP23017: but the one read per bank an input edge's
+//               interrupt asks for)
+//   state       after every step the pair state store holds exactly that
+//               pair: phase, cycles, side and the relays on the expander
+//   hold        a paused pair has both relays off within --stop-ticks
+//   resume      released, it carries on toward the same side (or waits in
+//               Idle for a start), and a dwell has exactly the time left it
+//               had when the hold began
+//   group       every group window keeps its rules and turns its pairs in
+//               one write per relay bank (a ripple step: its one pair, one write)
+//   inrush      no more motor starts within any start window than the start
+//               gate's cap (start_gate.h)
+//   aux         an aux output comes on only in a group boundary's write, goes
+//               off within --stop-ticks of its pulse ending, and is off once
+//               the sequence stops or the group is held
+//   parser      an intact batch reads back exactly as sent, or is rejected
+//               at its first bad command; a corrupted frame never runs; no
+//               batch that runs has an out-of-range argument
+//
+// Every failure is reported with the first time it was seen; the run exits
+// 1 on any. The sequence is reproducible from --seed. The checker is in
+// chaos.cpp; pio test -e native runs it on a few seeds (test/test_chaos).
+//
+//   .pio/build/sim/program --chaos 2000 --hours 2 --seed 7
+
+#include <Arduino.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+#include "chaos.h"
+#include "pair_engine.h"
+#include "pair_sim.h"
+#include "sim_options.h"
+#include "sim_stats.h"
+#include "sim_world.h"
+#include "start_gate.h"
+
+static const uint64_t NS_PER_MS = 1000000ULL;
+static const uint32_t OVERRUN_SLACK_MS = 200; // Beyond modeled travel + poll period
+
+struct PairReport {
+    sim::Histogram travelMs;
+    sim::Histogram dwellMs;
+    sim::Histogram cycleMs;
+    sim::Histogram faceMs;   // Scheduled faces: distance from the boundary, either way
+    int64_t faceSumMs = 0;   // ...and signed (late positive), for the mean
+    uint32_t lastCycleEndMs = 0;
+    uint32_t lastCycles = 0;
+    uint64_t overruns = 0;
+    bool overrunning = false;
+};
+
+// One aux output's pulses in a soak
+struct AuxReport {
+    sim::Histogram pulseMs;
+    uint64_t pulses = 0;
+    uint64_t offBoundary = 0; // Came on in a step that began no window
+    uint64_t onSinceNs = 0;   // 0: off
+    uint32_t firedMs = 0;     // The engine's onSinceMs for it
+};
+
+static void usage(const char* prog) {
+    printf("Usage: %s [options]\n", prog);
+    sim::printPlantUsage();
+    printf("  --days D             Simulated range time in days (default 1)\n"
+           "  --hours H            Simulated range time in hours\n"
+           "  --cycles N           Stop after N completed moves in total\n"
+           "  --pairs N            Number of pairs (default PAIR_COUNT, max 64)\n"
+           "  --step-us N          CPU time charged per motorStep() call (default 10)\n"
+           "  --verbose            Keep the engine's serial log\n"
+           "  --expose SPEC        Run pairs as an exposure group: K,FIRST,LAST,WINDOW_MS[,GAP[,norepeat]]\n"
+           "  --ripple SPEC        Run pairs as a ripple: FIRST,LAST,STAGGER_MS[,HOLD_STEPS]\n"
+           "  --aux SPEC           Bind an aux output to the group: CHANNEL,drill|step,PULSE_MS (repeatable)\n"
+           "  --start-cap N        Motor starts allowed within a start window, 0: no cap (default START_CAP)\n"
+           "  --start-window-ms N  Start window (default START_WINDOW_MS)\n"
+           "  --chaos MS           Property check: a random event every MS on average (default 1 h run)\n"
+           "  --stop-ticks N       Deadline for the stop properties in ticks (default 60)\n");
+}
+
+static void printDist(const char* name, const sim::Histogram& h) {
+    printf("  %-7s p50 %6llu  p99 %6llu  max %6llu  mean %8.1f ms\n", name,
+           (unsigned long long)h.percentile(50), (unsigned long long)h.percentile(99),
+           (unsigned long long)h.max(), h.mean());
+}
+
+int main(int argc, char** argv) {
+    sim::PlantOptions opts;
+    PairSimConfig cfg;
+    double hours = -1.0;
+    uint64_t maxCycles = 0;
+    bool verbose = false;
+    uint32_t chaosMs = 0;
+    uint32_t stopTicks = 60; // One input poll plus slack
+    GroupRules group = {};
+    std::vector<AuxBinding> auxBindings;
+    int startCap = START_CAP;
+    uint32_t startWindowMs = START_WINDOW_MS;
+
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* val = (i + 1 < argc) ? argv[i + 1] : nullptr;
+        if (!strcmp(arg, "--verbose")) { verbose = true; continue; }
+        if (!val) { usage(argv[0]); return 2; }
+        if (!strcmp(arg, "--days")) hours = atof(val) * 24.0;
+        else if (!strcmp(arg, "--hours")) hours = atof(val);
+        else if (!strcmp(arg, "--cycles")) maxCycles = strtoull(val, nullptr, 10);
+        else if (!strcmp(arg, "--pairs")) cfg.pairs = atoi(val);
+        else if (!strcmp(arg, "--step-us")) cfg.stepNs = strtoull(val, nullptr, 10) * 1000;
+        else if (!strcmp(arg, "--chaos")) chaosMs = strtoul(val, nullptr, 10);
+        else if (!strcmp(arg, "--stop-ticks")) stopTicks = strtoul(val, nullptr, 10);
+        else if (!strcmp(arg, "--start-cap")) startCap = atoi(val);
+        else if (!strcmp(arg, "--start-window-ms")) startWindowMs = strtoul(val, nullptr, 10);
+        else if (!strcmp(arg, "--expose")) {
+            if (!parseExposeRules(val, &group)) { usage(argv[0]); return 2; }
+        }
+        else if (!strcmp(arg, "--ripple")) {
+            if (!parseRippleRules(val, &group)) { usage(argv[0]); return 2; }
+        }
+        else if (!strcmp(arg, "--aux")) {
+            AuxBinding b;
+            if (!parseAuxBinding(val, &b)) { usage(argv[0]); return 2; }
+            auxBindings.push_back(b);
+        }
+        else if (!sim::parsePlantOption(opts, arg, val)) { usage(argv[0]); return 2; }
+        i++;
+    }
+
+    Serial.mute(!verbose);
+    cfg.log = verbose;
+    startGateConfigure(startCap, startWindowMs);
+    if (chaosMs) return runChaos(opts, cfg, hours < 0 ? 1.0 : hours, chaosMs, stopTicks);
+    if (hours < 0) hours = 24.0;
+    PairSim sim(opts, cfg);
+    if (!sim.begin()) {
+        fprintf(stderr, "SIM: expander init failed\n");
+        return 2;
+    }
+
+    const int pairCount = sim.pairCount();
+    std::vector<PairReport> reports(pairCount);
+    bool ripple = group.mode == GROUP_RIPPLE;
+    if (group.windowMs) {
+        sim.setEnabled(false);
+        if (!sim.setGroup(group)) {
+            fprintf(stderr, "SIM: --expose / --ripple: no group fits those rules and pairs\n");
+            return 2;
+        }
+        for (const AuxBinding& b : auxBindings) {
+            if (!sim.setAux(b)) {
+                fprintf(stderr, "SIM: --aux: at most %d pairs, the rest are wired to the aux pins\n", PAIR_COUNT);
+                return 2;
+            }
+        }
+        sim.setEnabled(true);
+    } else if (!auxBindings.empty()) {
+        fprintf(stderr, "SIM: --aux follows a group: give --expose or --ripple\n");
+        return 2;
+    }
+    const uint32_t overrunMs = opts.motor.travelMs + opts.motor.laneSpreadMs + opts.motor.travelJitterMs +
+                               opts.motor.closeDelayMs + opts.motor.bounceUs / 1000 + OVERRUN_SLACK_MS;
+    uint64_t totalCycles = 0;
+    StartCounter starts;
+    sim::world().setStartHook([&](int, uint64_t ns) { starts.add(ns); });
+
+    sim.afterStep = [&](int i) {
+        MotorTaskData& p = sim.pair(i);
+        PairReport& r = reports[i];
+        uint32_t now = millis();
+        if (p.cycles != r.lastCycles) {
+            r.travelMs.add(p.lastTravelMs);
+            r.dwellMs.add(p.dwellMs);
+            if (r.lastCycles) r.cycleMs.add(now - r.lastCycleEndMs);
+            r.lastCycleEndMs = now;
+            totalCycles += p.cycles - r.lastCycles;
+            r.lastCycles = p.cycles;
+        }
+        bool overrunning = p.phase == PHASE_TRAVEL && now - p.phaseStartMs > overrunMs;
+        if (overrunning && !r.overrunning) r.overruns++;
+        r.overrunning = overrunning;
+    };
+
+    // Every window: its rules, its turn in one write per bank, and whether
+    // the last window's selection was all in place when it ended (a ripple
+    // step: only its rules)
+    sim::World& world = sim::world();
+    uint64_t windows = 0, lateWindows = 0, ruleViolations = 0;
+    uint32_t windowsSeen = 0;
+    uint16_t lastExposed = 0, lastDue = 0, lastDeferred = 0;
+    std::vector<uint64_t> exposures(pairCount, 0);
+    sim::Histogram spreadMs;
+    uint64_t wideSpreads = 0;
+    uint32_t faceWindowsSeen = 0;
+    std::vector<AuxReport> auxReports(AUX_COUNT);
+    sim.afterGroupStep = [&] {
+        const GroupData& g = sim.group();
+        for (int c = 0; c < AUX_COUNT && !auxBindings.empty(); c++) {
+            AuxReport& a = auxReports[c];
+            uint16_t latch = PCF_ALL_HIGH;
+            world.committed(sim.relayAddress(PCF_BANK(AUX_PINS[c])), latch);
+            bool on = !(latch & (1u << PCF_BIT(AUX_PINS[c])));
+            bool fired = on && (!a.onSinceNs || g.aux[c].onSinceMs != a.firedMs); // Again: a new pulse
+            if (a.onSinceNs && (!on || fired)) a.pulseMs.add((sim.nowNs() - a.onSinceNs) / NS_PER_MS);
+            if (fired) {
+                a.pulses++;
+                a.offBoundary += g.windows == windowsSeen;
+            }
+            a.onSinceNs = !on ? 0 : fired ? sim.nowNs() : a.onSinceNs;
+            a.firedMs = g.aux[c].onSinceMs;
+        }
+        if (g.faceWindows != faceWindowsSeen) {
+            spreadMs.add(g.faceSpreadMs);
+            wideSpreads += g.faceSpreadMs > GROUP_FACE_TOLERANCE_MS;
+            faceWindowsSeen = g.faceWindows;
+        }
+        uint16_t faced = g.running ? lastDue & ~g.due : 0;
+        lastDue = g.running ? g.due : 0;
+        for (int i = 0; i < g.count; i++) {
+            if (!(faced & (1u << i))) continue;
+            int16_t err = sim.pair(g.first + i).faceErrorMs;
+            reports[g.first + i].faceMs.add((uint64_t)(err < 0 ? -err : err));
+            reports[g.first + i].faceSumMs += err;
+        }
+        uint16_t deferred = lastDeferred;
+        lastDeferred = g.deferred;
+        if (g.windows == windowsSeen) return;
+        bool late = false;
+        for (int i = 0; i < g.count && windowsSeen && !ripple; i++) {
+            // Barely moved yet by this boundary's writes; a pair turning to
+            // B ahead of its face has left already
+            if ((g.exposed & ~lastExposed) & (1u << i)) continue;
+            double at = world.position(g.first + i);
+            late = late || ((lastExposed & (1u << i)) ? at < 0.99 : at > 0.01);
+        }
+        lateWindows += late;
+        ruleViolations += !windowOk(sim, windowsSeen ? lastExposed : 0, deferred);
+        for (int i = 0; i < g.count; i++) exposures[g.first + i] += (g.exposed >> i) & 1;
+        windows++;
+        windowsSeen = g.windows;
+        lastExposed = g.exposed;
+    };
+
+    auto wallStart = std::chrono::steady_clock::now();
+    sim.run((uint64_t)(hours * 3600.0 * 1000.0) * NS_PER_MS,
+            [&] { return maxCycles && totalCycles >= maxCycles; });
+
+    double wallS = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+    double simS = sim.nowNs() / 1e9;
+    sim::BusStats bus = world.busStats();
+    uint64_t overruns = 0;
+
+    printf("SIM: %.2f days simulated in %.2f s wall (%.0fx), %d pairs, seed %lu\n",
+           simS / 86400.0, wallS, wallS > 0 ? simS / wallS : 0.0, pairCount, (unsigned long)opts.seed);
+    printf("SIM: %llu cycles, %llu steps, %llu bus transactions, bus busy %.2f%%\n",
+           (unsigned long long)totalCycles, (unsigned long long)sim.steps(),
+           (unsigned long long)bus.transactions, simS > 0 ? 100.0 * bus.busyNs / (simS * 1e9) : 0.0);
+    for (int i = 0; i < pairCount; i++) {
+        printf("Pair %d: %lu cycles, %llu travel overruns\n", i, (unsigned long)sim.pair(i).cycles,
+               (unsigned long long)reports[i].overruns);
+        printDist("travel", reports[i].travelMs);
+        printDist("dwell", reports[i].dwellMs);
+        printDist("cycle", reports[i].cycleMs);
+        if (reports[i].faceMs.count()) {
+            printDist("face", reports[i].faceMs);
+            printf("          signed mean %+.1f ms over %llu faces\n",
+                   (double)reports[i].faceSumMs / (double)reports[i].faceMs.count(),
+                   (unsigned long long)reports[i].faceMs.count());
+        }
+        overruns += reports[i].overruns;
+    }
+    if (group.windowMs && ripple) {
+        const GroupData& g = sim.group();
+        printf("GROUP: pairs %d-%d, ripple every %u ms, %d steps held: %llu steps, %llu rule violations\n",
+               g.first, g.first + g.count - 1, g.rules.windowMs, g.rules.holdSteps, (unsigned long long)windows,
+               (unsigned long long)ruleViolations);
+    } else if (group.windowMs) {
+        const GroupData& g = sim.group();
+        printf("GROUP: pairs %d-%d, %d of %d every %u ms (gap %d%s): %llu windows, %llu late, %llu rule violations\n",
+               g.first, g.first + g.count - 1, g.rules.k, g.count, g.rules.windowMs, g.rules.gap,
+               g.rules.noRepeat ? ", no repeats" : "", (unsigned long long)windows, (unsigned long long)lateWindows,
+               (unsigned long long)ruleViolations);
+        printf("GROUP: exposed");
+        for (int i = 0; i < g.count; i++) printf(" %llu", (unsigned long long)exposures[g.first + i]);
+        printf(" windows per pair\n");
+        if (spreadMs.count()) {
+            printf("GROUP: faces of %llu windows landed within p50 %llu  p99 %llu  max %llu ms, "
+                   "%llu over the %lu ms tolerance\n",
+                   (unsigned long long)spreadMs.count(), (unsigned long long)spreadMs.percentile(50),
+                   (unsigned long long)spreadMs.percentile(99), (unsigned long long)spreadMs.max(),
+                   (unsigned long long)wideSpreads, (unsigned long)GROUP_FACE_TOLERANCE_MS);
+        }
+    }
+    uint64_t auxOffBoundary = 0;
+    for (const AuxBinding& b : auxBindings) {
+        const AuxReport& a = auxReports[b.channel];
+        printf("AUX: channel %d (pin %d) on %s, %u ms: %llu pulses, %llu off a boundary's write; lasted "
+               "p50 %llu  max %llu ms\n",
+               b.channel, AUX_PINS[b.channel], b.event == AUX_DRILL ? "drill" : "step", b.pulseMs,
+               (unsigned long long)a.pulses, (unsigned long long)a.offBoundary,
+               (unsigned long long)a.pulseMs.percentile(50), (unsigned long long)a.pulseMs.max());
+        auxOffBoundary += a.offBoundary;
+    }
+    bool inrush = startGateCap() && starts.most > startGateCap();
+    printf("SIM: at most %d motor starts within %lu ms (cap %d%s)\n", starts.most,
+           (unsigned long)startGateWindowMs(), startGateCap(), startGateCap() ? "" : ": none");
+    uint64_t violations = world.interlockViolations();
+    printf("SIM: interlock violations %llu, travel overruns %llu\n",
+           (unsigned long long)violations, (unsigned long long)overruns);
+    return (violations || overruns || ruleViolations || inrush || auxOffBoundary) ? 1 : 0;
+}
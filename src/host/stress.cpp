@@ -0,0 +1,191 @@
+// Scalability stress test ([env:stress]).
+//
+// Instantiates large lanes (32 and 64 pairs by default) on the simulated
+// bus, one relay + one input expander per PCF_PINS / 2 pairs, runs them on the
+// virtual clock and writes a JSON report per lane size:
+//
+//   ram        Target-side estimate: MotorTask stacks + TCBs + pair state +
+//              expander objects, against the heap an Arduino-ESP32 has free
+//   cpu        Modeled CPU per core (MotorTask i runs on core i % 2)
+//   wakeups    Scheduler wake-ups per second, total and per core
+//   bus        Transactions/s, occupancy, chip count and address-space fit
+//   serial     Log bytes/s and the share of a 115200 baud UART they need
+//   stop       Switch-close to relay-off latency, p50/p99/max
+//   limits     Which of the above the lane size breaks
+//
+//   .pio/build/stress/program --pairs 32,64 --hours 2 --json stress.json
+
+#include <Arduino.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "config.h"
+#include "pair_engine.h"
+#include "pair_sim.h"
+#include "pair_state.h"
+#include "sim_options.h"
+#include "sim_stats.h"
+#include "sim_world.h"
+
+// Target-side sizes the host cannot measure. Estimates for ESP-IDF 4.x.
+const uint32_t FREERTOS_TCB_BYTES = 376;           // StaticTask_t incl. per-core fields
+const uint32_t EXPANDER_OBJECT_BYTES = 64;         // xreef PCF8574 / PCF8575 instance
+const uint32_t ESP32_FREE_HEAP_BYTES = 280 * 1024; // Free heap after Arduino boot, no WiFi
+const uint32_t UART_BYTES_PER_S = 115200 / 10;     // 8N1
+
+// Limits for the "limits" list
+const double BUS_BUSY_LIMIT_PCT = 50.0;
+const double UART_LIMIT_PCT = 80.0;
+const double CPU_LIMIT_PCT = 50.0;
+const uint64_t STOP_LATENCY_LIMIT_US = 100000;
+
+struct LaneReport {
+    int pairs;
+    double simS;
+    uint64_t cycles;
+    uint64_t steps[2];
+    uint64_t ramStacks, ramTcbs, ramState, ramExpanders, ramTotal;
+    double cpuPct[2];
+    double txnPerS;
+    double busBusyPct;
+    int expanders;
+    bool addressesFit;
+    double serialBytesPerS;
+    double uartPct;
+    sim::Histogram stopUs{1, 1 << 18};
+    uint64_t violations;
+    std::vector<std::string> limits;
+};
+
+static void runLane(LaneReport& r, const sim::PlantOptions& opts, PairSimConfig cfg, double hours) {
+    cfg.pairs = r.pairs;
+    PairSim sim(opts, cfg);
+    if (!sim.begin()) {
+        fprintf(stderr, "STRESS: expander init failed for %d pairs\n", r.pairs);
+        exit(2);
+    }
+    r.pairs = sim.pairCount();
+    r.steps[0] = r.steps[1] = 0;
+    sim::world().setStopHook([&](const sim::StopEvent& e) { r.stopUs.add((e.releasedNs - e.closedNs) / 1000); });
+    sim.afterStep = [&](int i) { r.steps[i % 2]++; };
+
+    uint64_t serialBefore = Serial.bytesWritten();
+    sim.run((uint64_t)(hours * 3.6e12));
+
+    r.simS = sim.nowNs() / 1e9;
+    r.cycles = 0;
+    for (int i = 0; i < r.pairs; i++) r.cycles += sim.pair(i).cycles;
+
+    r.ramStacks = (uint64_t)r.pairs * MOTOR_TASK_STACK;
+    r.ramTcbs = (uint64_t)r.pairs * FREERTOS_TCB_BYTES;
+    r.ramState = (uint64_t)r.pairs * (sizeof(MotorTaskData) + sizeof(uint32_t) + sizeof(PairState)); // + seqlock slot
+    r.expanders = sim.expanderCount();
+    r.ramExpanders = (uint64_t)r.expanders * EXPANDER_OBJECT_BYTES;
+    r.ramTotal = r.ramStacks + r.ramTcbs + r.ramState + r.ramExpanders;
+
+    for (int c = 0; c < 2; c++) r.cpuPct[c] = 100.0 * r.steps[c] * cfg.stepNs / (r.simS * 1e9);
+
+    sim::BusStats bus = sim::world().busStats();
+    r.txnPerS = bus.transactions / r.simS;
+    r.busBusyPct = 100.0 * bus.busyNs / (r.simS * 1e9);
+    r.addressesFit = sim.addressesFit();
+    r.serialBytesPerS = (Serial.bytesWritten() - serialBefore) / r.simS;
+    r.uartPct = 100.0 * r.serialBytesPerS / UART_BYTES_PER_S;
+    r.violations = sim::world().interlockViolations();
+
+    if (r.ramTotal > ESP32_FREE_HEAP_BYTES) r.limits.push_back("ram");
+    if (!r.addressesFit) r.limits.push_back("i2c_address_space");
+    if (r.busBusyPct > BUS_BUSY_LIMIT_PCT) r.limits.push_back("bus_occupancy");
+    if (r.uartPct > UART_LIMIT_PCT) r.limits.push_back("serial_log_bandwidth");
+    if (r.cpuPct[0] > CPU_LIMIT_PCT || r.cpuPct[1] > CPU_LIMIT_PCT) r.limits.push_back("cpu");
+    if (r.stopUs.max() > STOP_LATENCY_LIMIT_US) r.limits.push_back("stop_latency");
+    if (r.violations) r.limits.push_back("interlock");
+}
+
+static void writeJson(FILE* f, const std::vector<LaneReport>& lanes, const sim::PlantOptions& opts,
+                      const PairSimConfig& cfg, double hours) {
+    fprintf(f, "{\n  \"sim_hours\": %.3f,\n  \"seed\": %lu,\n  \"byte_ns\": %lu,\n  \"step_ns\": %llu,\n",
+            hours, (unsigned long)opts.seed, (unsigned long)opts.bus.byteNs, (unsigned long long)cfg.stepNs);
+    fprintf(f, "  \"heap_budget_bytes\": %lu,\n  \"lanes\": [\n", (unsigned long)ESP32_FREE_HEAP_BYTES);
+    for (size_t i = 0; i < lanes.size(); i++) {
+        const LaneReport& r = lanes[i];
+        fprintf(f, "    {\n      \"pairs\": %d,\n      \"cycles\": %llu,\n", r.pairs, (unsigned long long)r.cycles);
+        fprintf(f, "      \"ram\": {\"task_stacks\": %llu, \"tcbs\": %llu, \"pair_state\": %llu, "
+                   "\"expander_objects\": %llu, \"total\": %llu, \"fits\": %s},\n",
+                (unsigned long long)r.ramStacks, (unsigned long long)r.ramTcbs, (unsigned long long)r.ramState,
+                (unsigned long long)r.ramExpanders, (unsigned long long)r.ramTotal,
+                r.ramTotal <= ESP32_FREE_HEAP_BYTES ? "true" : "false");
+        fprintf(f, "      \"cpu_pct\": [%.3f, %.3f],\n", r.cpuPct[0], r.cpuPct[1]);
+        fprintf(f, "      \"wakeups_per_s\": %.1f,\n      \"wakeups_per_s_per_core\": [%.1f, %.1f],\n",
+                (r.steps[0] + r.steps[1]) / r.simS, r.steps[0] / r.simS, r.steps[1] / r.simS);
+        fprintf(f, "      \"bus\": {\"transactions_per_s\": %.1f, \"busy_pct\": %.2f, \"expanders\": %d, "
+                   "\"address_space_fits\": %s},\n",
+                r.txnPerS, r.busBusyPct, r.expanders, r.addressesFit ? "true" : "false");
+        fprintf(f, "      \"serial\": {\"bytes_per_s\": %.1f, \"uart_pct\": %.1f},\n", r.serialBytesPerS, r.uartPct);
+        fprintf(f, "      \"stop_latency_us\": {\"p50\": %llu, \"p99\": %llu, \"max\": %llu},\n",
+                (unsigned long long)r.stopUs.percentile(50), (unsigned long long)r.stopUs.percentile(99),
+                (unsigned long long)r.stopUs.max());
+        fprintf(f, "      \"interlock_violations\": %llu,\n      \"limits\": [", (unsigned long long)r.violations);
+        for (size_t j = 0; j < r.limits.size(); j++) fprintf(f, "%s\"%s\"", j ? ", " : "", r.limits[j].c_str());
+        fprintf(f, "]\n    }%s\n", i + 1 < lanes.size() ? "," : "");
+    }
+    fprintf(f, "  ]\n}\n");
+}
+
+static void usage(const char* prog) {
+    printf("Usage: %s [options]\n", prog);
+    sim::printPlantUsage();
+    printf("  --pairs LIST         Lane sizes to run, max %d (default 32,64)\n"
+           "  --hours H            Simulated time per lane size (default 1)\n"
+           "  --step-us N          CPU time charged per motorStep() call (default 10)\n"
+           "  --json FILE          Write the report here instead of stdout\n",
+           PairSim::MAX_PAIRS);
+}
+
+int main(int argc, char** argv) {
+    sim::PlantOptions opts;
+    PairSimConfig cfg;
+    std::vector<int> sizes = {32, 64};
+    double hours = 1.0;
+    const char* jsonPath = nullptr;
+
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* val = (i + 1 < argc) ? argv[i + 1] : nullptr;
+        if (!val) { usage(argv[0]); return 2; }
+        if (!strcmp(arg, "--pairs")) {
+            sizes.clear();
+            for (const char* s = val; *s;) {
+                char* end;
+                long v = strtol(s, &end, 10);
+                if (end == s) break;
+                sizes.push_back((int)v);
+                s = (*end == ',') ? end + 1 : end;
+            }
+        } else if (!strcmp(arg, "--hours")) hours = atof(val);
+        else if (!strcmp(arg, "--step-us")) cfg.stepNs = strtoull(val, nullptr, 10) * 1000;
+        else if (!strcmp(arg, "--json")) jsonPath = val;
+        else if (!sim::parsePlantOption(opts, arg, val)) { usage(argv[0]); return 2; }
+        i++;
+    }
+
+    Serial.mute(true);
+    std::vector<LaneReport> lanes(sizes.size());
+    bool broken = false;
+    for (size_t i = 0; i < sizes.size(); i++) {
+        lanes[i].pairs = sizes[i];
+        runLane(lanes[i], opts, cfg, hours);
+        broken |= lanes[i].violations != 0;
+    }
+
+    FILE* f = jsonPath ? fopen(jsonPath, "w") : stdout;
+    if (!f) {
+        fprintf(stderr, "STRESS: cannot write %s\n", jsonPath);
+        return 2;
+    }
+    writeJson(f, lanes, opts, cfg, hours);
+    if (jsonPath) fclose(f);
+    return broken ? 1 : 0;
+}
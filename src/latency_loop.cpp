@@ -0,0 +1,144 @@
+// Hardware edge-to-stop benchmark rig ([env:nodemcu-32s-latency]).
+//
+// Pair 0 is disconnected from its motor and looped back through the ESP32:
+//   relay PCF pin RELAY_PINS[0] / [1]  -> LOOP_RELAY_A_GPIO / LOOP_RELAY_B_GPIO (inputs)
+//   LOOP_INPUT_A_GPIO / LOOP_INPUT_B_GPIO (open drain) -> input PCF pin INPUT_PINS[0] / [1]
+// The rig plays the motor: once a relay turns on it waits a random travel
+// time, closes the matching "switch" and timestamps it; an interrupt on the
+// relay loop-back timestamps the release. The target starts parked on limit
+// B, as the engine's first move is toward A. The other pairs keep running
+// normally and LATENCY_LOOP_LOAD_HZ adds extra bus readers.
+
+#ifdef LATENCY_LOOP_BENCH
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <stdlib.h>
+#include "config.h"
+#include "latency_loop.h"
+#include "pair_io.h"
+
+#define LOOP_RELAY_A_GPIO 25
+#define LOOP_RELAY_B_GPIO 26
+#define LOOP_INPUT_A_GPIO 32
+#define LOOP_INPUT_B_GPIO 33
+
+#ifndef LATENCY_LOOP_LOAD_HZ
+#define LATENCY_LOOP_LOAD_HZ 0 // Background input reads per second
+#endif
+
+const int LOOP_SAMPLES = 500;      // Report every this many stops
+const int LOOP_MIN_TRAVEL_MS = 200;
+const int LOOP_MAX_TRAVEL_MS = 1200;
+const uint32_t LOOP_WAIT_MS = 1000; // Release timeout; also the energize wait's slice
+
+static const int relayGpio[2] = {LOOP_RELAY_A_GPIO, LOOP_RELAY_B_GPIO};
+static const int inputGpio[2] = {LOOP_INPUT_A_GPIO, LOOP_INPUT_B_GPIO};
+static TaskHandle_t loopTask = NULL;
+static volatile uint32_t releaseUs[2];
+static volatile bool armed[2];
+static volatile bool energized[2]; // Relay turned on since the task last served that side
+static uint32_t samples[LOOP_SAMPLES];
+
+// Both edges: falling (energized) wakes the task, rising is the timed release
+static void IRAM_ATTR onRelayEdge(int side) {
+    if (digitalRead(relayGpio[side]) == LOW) {
+        energized[side] = true;
+        BaseType_t woken = pdFALSE;
+        vTaskNotifyGiveFromISR(loopTask, &woken);
+        portYIELD_FROM_ISR(woken);
+    } else if (armed[side]) {
+        releaseUs[side] = micros();
+        armed[side] = false;
+    }
+}
+
+static void IRAM_ATTR onRelayAEdge() { onRelayEdge(0); }
+static void IRAM_ATTR onRelayBEdge() { onRelayEdge(1); }
+
+static int compareU32(const void* a, const void* b) {
+    uint32_t x = *(const uint32_t*)a, y = *(const uint32_t*)b;
+    return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+static void report(int count) {
+    qsort(samples, count, sizeof(samples[0]), compareU32);
+    Serial.printf("LATENCY: %d stops, load %d Hz: p50 %lu us  p99 %lu us  max %lu us\n",
+                  count, LATENCY_LOOP_LOAD_HZ, (unsigned long)samples[count / 2],
+                  (unsigned long)samples[(count * 99) / 100], (unsigned long)samples[count - 1]);
+}
+
+static void LatencyLoopTask(void*) {
+    int count = 0;
+    int next = 0; // Side the engine should drive next; served first if both are flagged
+
+    while (true) {
+        // Wait for the engine to energize a side. Whichever it drives is the
+        // one served, so a missed or unexpected move cannot stall the rig.
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(LOOP_WAIT_MS));
+        int side = energized[next] ? next : (energized[1 - next] ? 1 - next : -1);
+        if (side < 0) continue; // Idle (not started, paused, dwelling)
+        energized[side] = false;
+        if (digitalRead(relayGpio[side]) == HIGH) continue; // Already released: a pulse, no move
+        if (side != next) Serial.printf("LATENCY: engine drove %c, expected %c\n", side ? 'B' : 'A', next ? 'B' : 'A');
+        next = 1 - side;
+        // Leaving the opposite end opens its switch
+        digitalWrite(inputGpio[1 - side], HIGH);
+
+        vTaskDelay(pdMS_TO_TICKS(random(LOOP_MIN_TRAVEL_MS, LOOP_MAX_TRAVEL_MS + 1)));
+        armed[side] = true;
+        uint32_t edgeUs = micros();
+        digitalWrite(inputGpio[side], LOW); // Switch closes
+
+        TickType_t start = xTaskGetTickCount();
+        while (armed[side] && (xTaskGetTickCount() - start) < pdMS_TO_TICKS(LOOP_WAIT_MS)) vTaskDelay(1);
+        if (armed[side]) {
+            armed[side] = false;
+            Serial.printf("LATENCY: relay %c not released within %lu ms\n", side ? 'B' : 'A',
+                          (unsigned long)LOOP_WAIT_MS);
+            continue;
+        }
+        samples[count++] = releaseUs[side] - edgeUs;
+        if (count == LOOP_SAMPLES) {
+            report(count);
+            count = 0;
+        }
+    }
+}
+
+static void LatencyLoadTask(void*) {
+    TickType_t period = pdMS_TO_TICKS(1000 / LATENCY_LOOP_LOAD_HZ);
+    if (period == 0) period = 1;
+    TickType_t last = xTaskGetTickCount();
+    while (true) {
+        pcfReadInput(INPUT_PINS[0]);
+        vTaskDelayUntil(&last, period);
+    }
+}
+
+void latencyLoopBegin() {
+    pinMode(LOOP_RELAY_A_GPIO, INPUT_PULLUP);
+    pinMode(LOOP_RELAY_B_GPIO, INPUT_PULLUP);
+    pinMode(LOOP_INPUT_A_GPIO, OUTPUT_OPEN_DRAIN);
+    pinMode(LOOP_INPUT_B_GPIO, OUTPUT_OPEN_DRAIN);
+    // Target starts parked at limit B: the engine's first move is toward A
+    // (motorReset()), so parking on A would have it stop that move at once
+    digitalWrite(LOOP_INPUT_A_GPIO, HIGH);
+    digitalWrite(LOOP_INPUT_B_GPIO, LOW);
+
+#ifdef PAIR_MIN_LATENCY
+    const int loadCore = CONSOLE_CORE; // Core 1 belongs to the motor tasks
+#else
+    const int loadCore = 1;
+#endif
+    xTaskCreatePinnedToCore(LatencyLoopTask, "LatencyLoop", 4096, NULL, 2, &loopTask, 0);
+    attachInterrupt(digitalPinToInterrupt(LOOP_RELAY_A_GPIO), onRelayAEdge, CHANGE);
+    attachInterrupt(digitalPinToInterrupt(LOOP_RELAY_B_GPIO), onRelayBEdge, CHANGE);
+    if (LATENCY_LOOP_LOAD_HZ > 0) {
+        xTaskCreatePinnedToCore(LatencyLoadTask, "LatencyLoad", 2048, NULL, 1, NULL, loadCore);
+    }
+    Serial.println("LATENCY: loop-back rig started on pair 0. Send 's' to run.");
+}
+
+#endif // LATENCY_LOOP_BENCH
@@ -1,81 +1,53 @@
 #include <Arduino.h>
+#ifndef PAIR_I2C_ASYNC
 #include <Wire.h>      // Explicitly include Wire
-#include <PCF8574.h>   // Include the xreef/PCF8574 library
+#endif
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
 #include <freertos/semphr.h>
 #include <stdlib.h>    // Required for random()
-
-// --- Hardware Configuration ---
-#define PCF_ADDRESS_RELAYS 0x24 // I2C Address for the RELAY PCF8574
-#define PCF_ADDRESS_INPUTS 0x22 // I2C Address for the INPUT PCF8574
-#define I2C_SDA_PIN 4           // Your SDA pin
-#define I2C_SCL_PIN 15          // Your SCL pin
-
-// --- Pin Configuration ---
-const int PAIR_COUNT = 3;
-const int RELAY_PINS[PAIR_COUNT * 2] = {0, 1, 2, 3, 4, 5}; // Pins on RELAY PCF (0x24)
-const int INPUT_PINS[PAIR_COUNT * 2] = {0, 1, 2, 3, 4, 5}; // Pins on INPUT PCF (0x22)
-
-// --- Timing Configuration ---
-const int MIN_DELAY_MS = 1500; // Minimum delay after input trigger
-const int MAX_DELAY_MS = 4000; // Maximum delay after input trigger
-
-// --- Global Objects ---
-PCF8574 pcf_relays(PCF_ADDRESS_RELAYS);
-PCF8574 pcf_inputs(PCF_ADDRESS_INPUTS);
-SemaphoreHandle_t i2cMutex; // Mutex for thread-safe I2C bus access
+#include "config.h"    // Pin map and timing constants
+#include "pair_io.h"
+#include "pair_engine.h"
+#include "group_engine.h"
+#include "pair_state.h"
+#include "trace.h"
+#include "commands.h"
+#ifdef LATENCY_LOOP_BENCH
+#include "latency_loop.h"
+#endif
 
 // --- Global Control Flag ---
 volatile bool sequenceEnabled = false; // <<< ADDED: Start in disabled state
 
-// --- Task Data Structure ---
-struct MotorTaskData {
-    int pairIndex;
-    int relayA;
-    int relayB;
-    int inputA;
-    int inputB;
-    bool activeRelayA; // Tracks which relay (A or B) is the target for the next activation
-};
-
 // Global array to hold runtime data for all pairs
 MotorTaskData motorTaskData[PAIR_COUNT];
+TaskHandle_t motorTaskHandles[PAIR_COUNT];
+volatile bool pairPaused[PAIR_COUNT]; // Holds set by pause / resume; kept across a disable
 
-// --- Thread-Safe PCF8574 Functions ---
-void pcfWriteRelay(uint8_t pin, uint8_t value) {
-    if (xSemaphoreTake(i2cMutex, portMAX_DELAY) == pdTRUE) {
-        pcf_relays.digitalWrite(pin, value);
-        xSemaphoreGive(i2cMutex);
-    } else {
-        Serial.printf("ERROR: Failed to get I2C mutex for RELAY write on pin %d\n", pin);
-    }
-}
+// The exposure group, if any; changed only while the sequence is disabled
+GroupData group;
+TaskHandle_t groupTaskHandle;
 
-uint8_t pcfReadInput(uint8_t pin) {
-    uint8_t value = HIGH; // Default to not pressed
-    if (xSemaphoreTake(i2cMutex, portMAX_DELAY) == pdTRUE) {
-        value = pcf_inputs.digitalRead(pin);
-        xSemaphoreGive(i2cMutex);
-    } else {
-         Serial.printf("ERROR: Failed to get I2C mutex for INPUT read on pin %d\n", pin);
+// Change the flag and cut short whatever wait each pair is in
+static void setSequenceEnabled(bool enabled) {
+    sequenceEnabled = enabled;
+    for (int i = 0; i < PAIR_COUNT; i++) {
+        if (motorTaskHandles[i]) xTaskNotifyGive(motorTaskHandles[i]);
     }
-    return value;
-}
-
-// Helper function to stop a relay (set HIGH)
-void stopRelay(int relayPin) {
-    pcfWriteRelay(relayPin, HIGH);
+    if (groupTaskHandle) xTaskNotifyGive(groupTaskHandle);
 }
 
-// Helper function to start a relay (set LOW)
-void startRelay(int relayPin) {
-    pcfWriteRelay(relayPin, LOW);
-}
-
-// Helper function to check if an input is pressed (LOW)
-bool isInputPressed(int inputPin) {
-    return (pcfReadInput(inputPin) == LOW);
+// Hold or release one pair (COMMAND_ALL_PAIRS: every pair). Traced, so a
+// replay applies it at the same moment.
+static void setPaused(uint8_t pair, bool paused) {
+    traceRecord(TRACE_PAUSE, pair, paused ? 1 : 0);
+    for (int i = 0; i < PAIR_COUNT; i++) {
+        if (pair != COMMAND_ALL_PAIRS && pair != i) continue;
+        pairPaused[i] = paused;
+        if (motorTaskHandles[i]) xTaskNotifyGive(motorTaskHandles[i]);
+    }
+    if (groupTaskHandle) xTaskNotifyGive(groupTaskHandle);
 }
 
 // --- Motor Control Task ---
@@ -86,96 +58,367 @@ void MotorTask(void* pvParameters) {
     Serial.printf("Motor Task %d: Started for Relays [%d,%d], Inputs [%d,%d]\n",
                   pairIdx, data->relayA, data->relayB, data->inputA, data->inputB);
 
-    // Initial state: Assume Relay A should be activated first.
-    data->activeRelayA = true;
+    motorReset(data);
+    pairStatePublish(data);
+    traceRecord(TRACE_TASK, pairIdx, 0);
 
     while (true) {
-        // --- Check if sequence is enabled ---
-        if (!sequenceEnabled) {
-            // Ensure relays for this pair are OFF if sequence is disabled
-            stopRelay(data->relayA);
-            stopRelay(data->relayB);
-            // Wait and check again
-            vTaskDelay(pdMS_TO_TICKS(500)); // Check enabled status periodically
-            continue; // Skip the rest of the loop if not enabled
+        uint32_t waitMs = MOTOR_WAIT_FOREVER;
+        if (!groupMember(&group, pairIdx)) { // GroupTask drives group members
+            waitMs = motorStep(data, sequenceEnabled, pairPaused[pairIdx]);
+            pairStatePublish(data);
+        }
+        pcfInputsService(); // Release the INT line if this wake left a bank unread
+        // Sleeps like vTaskDelay, but setSequenceEnabled() / setPaused() wake it early
+        ulTaskNotifyTake(pdTRUE, waitMs == MOTOR_WAIT_FOREVER ? portMAX_DELAY : pdMS_TO_TICKS(waitMs));
+    }
+} // End MotorTask function
+
+// --- Group Task ---
+// Drives the exposure group's pairs on one timeline; parked while there is
+// none. Any member's pause holds the whole group.
+void GroupTask(void*) {
+    while (true) {
+        bool held = false;
+        for (int i = 0; i < group.count; i++) held = held || pairPaused[group.first + i];
+        uint32_t waitMs = groupStep(&group, sequenceEnabled, held);
+        for (int i = 0; i < group.count; i++) pairStatePublish(&motorTaskData[group.first + i]);
+        groupStatePublish(&group);
+        pcfInputsService();
+        ulTaskNotifyTake(pdTRUE, waitMs == MOTOR_WAIT_FOREVER ? portMAX_DELAY : pdMS_TO_TICKS(waitMs));
+    }
+}
+
+// --- Console ---
+static const char* const PHASE_NAMES[] = {"IDLE", "TRAVEL", "DWELL"};
+
+// One line per pair, and the group, from the state store: no bus access, no
+// motor task held up
+static void printStatus() {
+    uint32_t now = millis();
+    Serial.printf("STATUS: sequence %s\n", sequenceEnabled ? "enabled" : "disabled");
+    GroupState g;
+    if (!groupStateRead(&g)) memset(&g, 0, sizeof(g)); // GroupTask not started: no group, nothing bound
+    if (g.count && g.mode == GROUP_RIPPLE) {
+        Serial.printf(" Group: pairs %d-%d, ripple every %u ms, %d steps held between ripples; step %lu, at B 0x%04X\n",
+                      g.first, g.first + g.count - 1, g.windowMs, g.holdSteps, (unsigned long)g.windows, g.exposed);
+    } else if (g.count) {
+        Serial.printf(" Group: pairs %d-%d, %d exposed per %u ms window, gap %d%s, %u selections; window %lu, exposed 0x%04X\n",
+                      g.first, g.first + g.count - 1, g.k, g.windowMs, g.gap, g.noRepeat ? ", no repeats" : "",
+                      g.selectionCount, (unsigned long)g.windows, g.exposed);
+        if (g.faceWindows) {
+            Serial.printf("  Faces: last window's landed within %u ms (tolerance %lu ms), %lu windows\n",
+                          g.faceSpreadMs, (unsigned long)GROUP_FACE_TOLERANCE_MS, (unsigned long)g.faceWindows);
+        }
+        for (int i = 0; i < g.count; i++) { // Face timing, per lane
+            const GroupMemberState& m = g.members[i];
+            if (!m.travelToBMs) {
+                Serial.printf("  Pair %d face: travel to B not measured yet, turns at the boundary\n", g.first + i);
+                continue;
+            }
+            Serial.printf("  Pair %d face: travel to B ~%u ms, turns %u ms ahead, last face %+d ms off\n",
+                          g.first + i, m.travelToBMs, m.leadMs, m.faceErrorMs);
+        }
+    }
+    static const char* const AUX_EVENT_NAMES[] = {"off", "drill", "step"};
+    for (int c = 0; c < AUX_COUNT; c++) {
+        const GroupAuxState& a = g.aux[c];
+        if (a.event == AUX_OFF) continue;
+        Serial.printf(" Aux %d (pin %d): %s, %u ms pulse%s\n", c, AUX_PINS[c], AUX_EVENT_NAMES[a.event], a.pulseMs,
+                      a.on ? ", on" : "");
+    }
+    for (int i = 0; i < PAIR_COUNT; i++) {
+        PairState s;
+        if (!pairStateRead(i, &s)) {
+            Serial.printf(" Pair %d: not started\n", i);
+            continue;
+        }
+        Serial.printf(" Pair %d: %-6s%s side %c, relays %c%c, inputs %c%c, %lu ms left, %lu cycles\n", i,
+                      PHASE_NAMES[s.phase], s.paused ? " (paused)" : "", s.sideB ? 'B' : 'A',
+                      (s.relays & PAIR_RELAY_A) ? 'A' : '-', (s.relays & PAIR_RELAY_B) ? 'B' : '-',
+                      (s.inputs & PAIR_INPUT_A) ? 'A' : '-', (s.inputs & PAIR_INPUT_B) ? 'B' : '-',
+                      (unsigned long)pairStateRemainingMs(s, now), (unsigned long)s.cycles);
+    }
+}
+
+// Re-arm the trace, but only from a state the replay can start from:
+// sequence disabled, every pair idle and nothing paused.
+static bool traceArm() {
+    bool idle = !sequenceEnabled;
+    uint16_t sideB = 0;
+    for (int i = 0; i < PAIR_COUNT; i++) {
+        idle = idle && !pairPaused[i];
+        PairState s;
+        if (!pairStateRead(i, &s)) {
+            idle = false; // Task not started yet
+            continue;
+        }
+        idle = idle && s.phase == PHASE_IDLE;
+        if (s.sideB) sideB |= 1 << i;
+    }
+    if (idle) {
+        traceBegin(PAIR_COUNT, sideB);
+        if (group.count) groupTrace(group.rules); // So a replay sets the same group up
+        for (int c = 0; c < AUX_COUNT; c++) {
+            if (group.aux[c].event != AUX_OFF) groupTraceAux(&group, c);
         }
+    }
+    return idle;
+}
 
-        // --- Sequence is Enabled ---
-        int currentRelay;
-        int oppositeRelay;
-        int currentInput;
+// The state a trace could be armed in, with the group stopped: the group's
+// setup may change hands then.
+static bool groupIdle() {
+    GroupState g;
+    bool idle = !sequenceEnabled && !(groupStateRead(&g) && g.running);
+    for (int i = 0; i < PAIR_COUNT; i++) {
+        PairState s;
+        idle = idle && !pairPaused[i] && pairStateRead(i, &s) && s.phase == PHASE_IDLE;
+    }
+    return idle;
+}
+
+// Set up, replace or end the exposure or ripple group. Only while idle, so
+// every pair changes hands while it is at rest.
+static CommandError groupConfigure(const Command& c) {
+    GroupRules rules = commandGroupRules(c);
+    if (!groupIdle()) return CMD_ERR_BUSY;
+    if (!groupPlan(&group, PAIR_COUNT, rules)) return CMD_ERR_ARG;
+    groupTrace(rules);
+    if (groupTaskHandle) xTaskNotifyGive(groupTaskHandle);
+    return CMD_OK;
+}
 
-        // Determine which relay/input pair should be active based on task data
-        if (data->activeRelayA) {
-            currentRelay = data->relayA;
-            oppositeRelay = data->relayB;
-            currentInput = data->inputA;
+// Bind an aux output; as groupConfigure(), the group task reads the
+// bindings without a lock.
+static CommandError auxConfigure(const Command& c) {
+    if (!groupIdle()) return CMD_ERR_BUSY;
+    if (!groupSetAux(&group, c.pair, (uint8_t)c.a, c.b)) return CMD_ERR_ARG;
+    groupTraceAux(&group, c.pair);
+    return CMD_OK;
+}
+
+// Single-byte commands, as typed on a terminal
+static void consoleSingle(char command) {
+    traceRecord(TRACE_COMMAND, (uint8_t)command, 0);
+    switch (commandDecode(command)) {
+    case CMD_ENABLE:
+        if (!sequenceEnabled) {
+            Serial.println("COMMAND: Enabling sequence!");
+            setSequenceEnabled(true);
         } else {
-            currentRelay = data->relayB;
-            oppositeRelay = data->relayA;
-            currentInput = data->inputB;
+             Serial.println("COMMAND: Sequence already enabled.");
         }
+        break;
+    case CMD_DISABLE:
+         if (sequenceEnabled) {
+            Serial.println("COMMAND: Disabling sequence!");
+            setSequenceEnabled(false);
+            // Tasks wake, turn off their relays and go idle
+        } else {
+             Serial.println("COMMAND: Sequence already disabled.");
+        }
+        break;
+    case CMD_TRACE_DUMP:
+        traceDump();
+        break;
+    case CMD_TRACE_ARM:
+        if (traceArm()) {
+            Serial.println("COMMAND: Trace re-armed.");
+        } else {
+            Serial.println("COMMAND: Disable the sequence, resume every pair and let them go idle before re-arming the trace.");
+        }
+        break;
+    case CMD_STATUS:
+        printStatus();
+        break;
+    case CMD_PAUSE:
+        Serial.println("COMMAND: Pausing every pair.");
+        setPaused(COMMAND_ALL_PAIRS, true);
+        break;
+    case CMD_RESUME:
+        Serial.println("COMMAND: Resuming every pair.");
+        setPaused(COMMAND_ALL_PAIRS, false);
+        break;
+    case CMD_NONE:
+        break;
+    }
+}
+
+// --- Batches ---
+// Reply payload: seq, error, index, then a status record per pair asked for
+static const int REPLY_MAX = 4 + COMMAND_BATCH_MAX * PAIR_COUNT * STATUS_WIRE_BYTES;
+static uint8_t replyPayload[REPLY_MAX];
+static uint8_t replyFrame[REPLY_MAX + REPLY_MAX / 254 + 6];
+static size_t replyLen;
+
+static void putU32(uint8_t* p, uint32_t v) {
+    for (int i = 0; i < 4; i++) p[i] = (uint8_t)(v >> (8 * i));
+}
+
+static void batchStatus(const CommandBatch& b, int pair) {
+    PairState s;
+    if (!pairStateRead(pair, &s)) memset(&s, 0, sizeof(s)); // Not started: idle, nothing done yet
+    uint32_t left = pairStateRemainingMs(s, millis());
+    if (b.binary) {
+        uint8_t* r = replyPayload + replyLen;
+        r[0] = (uint8_t)pair;
+        r[1] = s.phase;
+        r[2] = (s.sideB ? 1 : 0) | (s.relays << 1) | (s.inputs << 3) | (s.paused ? 0x20 : 0);
+        putU32(r + 3, left);
+        putU32(r + 7, s.cycles);
+        replyLen += STATUS_WIRE_BYTES;
+    } else {
+        Serial.printf("%u PAIR %d %s %c %c%c %c%c %lu %lu %s\n", b.seq, pair, PHASE_NAMES[s.phase], s.sideB ? 'B' : 'A',
+                      (s.relays & PAIR_RELAY_A) ? 'A' : '-', (s.relays & PAIR_RELAY_B) ? 'B' : '-',
+                      (s.inputs & PAIR_INPUT_A) ? 'A' : '-', (s.inputs & PAIR_INPUT_B) ? 'B' : '-',
+                      (unsigned long)left, (unsigned long)s.cycles, s.paused ? "hold" : "run");
+    }
+}
 
-        // --- Activate the current relay ---
-        // Ensure the opposite is off before turning the current one on
-        stopRelay(oppositeRelay);
-        startRelay(currentRelay);
-        Serial.printf("Task %d: Relay %c (Pin %d) ON. Waiting for Input %c (Pin %d)...\n",
-                      pairIdx, (data->activeRelayA ? 'A' : 'B'), currentRelay,
-                      (data->activeRelayA ? 'A' : 'B'), currentInput);
-
-        // 1. Wait for the corresponding input to be pressed (go LOW)
-        while (!isInputPressed(currentInput)) {
-            // Also check if sequence got disabled while waiting
-            if (!sequenceEnabled) {
-                stopRelay(currentRelay); // Turn off relay if disabled mid-wait
-                Serial.printf("Task %d: Sequence disabled while waiting for input %c.\n", pairIdx, (data->activeRelayA ? 'A' : 'B'));
-                continue; // Restart the loop to check the flag
+static void batchReply(const CommandBatch& b, CommandError err, uint8_t index) {
+    if (b.binary) {
+        replyPayload[0] = (uint8_t)b.seq;
+        replyPayload[1] = (uint8_t)(b.seq >> 8);
+        replyPayload[2] = err;
+        replyPayload[3] = index;
+        Serial.write(replyFrame, commandFrame(replyPayload, replyLen, replyFrame));
+    } else if (err == CMD_OK) {
+        Serial.printf("%u OK\n", b.seq);
+    } else {
+        Serial.printf("%u ERR %u %s\n", b.seq, index, commandErrorName(err));
+    }
+}
+
+// Run a checked batch in order. Commands act straight on the control
+// path: enable/disable and pause/resume notify the MotorTasks, a dwell
+// range is picked up by the pair's next dwell. Only a trace re-arm, an
+// expose or ripple or an aux binding can still be refused (busy, or no group
+// fits the rules); the batch stops there.
+static void consoleBatch(const CommandBatch& b) {
+    replyLen = 4;
+    for (int i = 0; i < b.count; i++) {
+        const Command& c = b.cmds[i];
+        int first = c.pair == COMMAND_ALL_PAIRS ? 0 : c.pair;
+        int last = c.pair == COMMAND_ALL_PAIRS ? PAIR_COUNT - 1 : c.pair;
+        switch (c.op) {
+        case OP_ENABLE:
+        case OP_DISABLE:
+            traceRecord(TRACE_COMMAND, c.op == OP_ENABLE ? 's' : 'x', 0); // As the replay knows them
+            if (sequenceEnabled != (c.op == OP_ENABLE)) setSequenceEnabled(c.op == OP_ENABLE);
+            break;
+        case OP_DWELL:
+            for (int p = first; p <= last; p++) {
+                motorTaskData[p].dwellMinMs = c.a;
+                motorTaskData[p].dwellMaxMs = c.b;
             }
-            vTaskDelay(pdMS_TO_TICKS(50)); // Check every 50ms, yield CPU
-        }
-        Serial.printf("Task %d: Input %c (Pin %d) PRESSED.\n", pairIdx, (data->activeRelayA ? 'A' : 'B'), currentInput);
-
-        // 2. Stop the current relay
-        stopRelay(currentRelay);
-        Serial.printf("Task %d: Relay %c (Pin %d) OFF.\n", pairIdx, (data->activeRelayA ? 'A' : 'B'), currentRelay);
-
-        // 3. Wait for a random delay using global constants
-        int delayMs = random(MIN_DELAY_MS, MAX_DELAY_MS + 1);
-        Serial.printf("Task %d: Delaying for %d ms...\n", pairIdx, delayMs);
-
-        // Check enabled flag periodically during the delay
-        TickType_t delayTicks = pdMS_TO_TICKS(delayMs);
-        TickType_t startTick = xTaskGetTickCount();
-        bool delayInterrupted = false; // Flag to check if delay was cut short
-        while ((xTaskGetTickCount() - startTick) < delayTicks) {
-            if (!sequenceEnabled) {
-                Serial.printf("Task %d: Sequence disabled during delay.\n", pairIdx);
-                delayInterrupted = true;
-                break; // Exit the delay loop
+            break;
+        case OP_STATUS:
+            for (int p = first; p <= last; p++) batchStatus(b, p);
+            break;
+        case OP_PAUSE:
+        case OP_RESUME:
+            setPaused(c.pair, c.op == OP_PAUSE);
+            break;
+        case OP_TRACE_DUMP:
+            traceDump();
+            break;
+        case OP_TRACE_ARM:
+            if (!traceArm()) {
+                batchReply(b, CMD_ERR_BUSY, i);
+                return;
+            }
+            break;
+        case OP_EXPOSE:
+        case OP_RIPPLE:
+        case OP_AUX: {
+            CommandError e = c.op == OP_AUX ? auxConfigure(c) : groupConfigure(c);
+            if (e != CMD_OK) {
+                batchReply(b, e, i);
+                return;
             }
-            vTaskDelay(pdMS_TO_TICKS(50)); // Check flag roughly every 50ms
+            break;
+        }
         }
+    }
+    batchReply(b, CMD_OK, 0);
+}
+
+// --- Console Task ---
+// Serial commands. Runs from loop() in the full build and from ConsoleTask
+// on core 0 in the minimal-latency build. Either way it sleeps until the
+// UART driver reports RX data; CONSOLE_IDLE_MS only keeps traceTick() going.
+static const uint32_t CONSOLE_IDLE_MS = 1000;
+static CommandReader consoleReader(PAIR_COUNT);
+static TaskHandle_t volatile consoleTask = NULL;
+
+// Runs in the UART driver's event task
+static void consoleRxWake() {
+    TaskHandle_t task = consoleTask;
+    if (task) xTaskNotifyGive(task);
+}
 
-        Serial.printf("Task %d: Switched direction. Next relay will be %c.\n", pairIdx, (data->activeRelayA ? 'A' : 'B'));
-        Serial.println("----------------------------------------");
+static void consoleWait() {
+    if (!consoleTask) consoleTask = xTaskGetCurrentTaskHandle();
+    if (Serial.available() <= 0) ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(CONSOLE_IDLE_MS));
+}
 
-    } // End while(true) loop
-} // End MotorTask function
+static void consolePoll() {
+    while (Serial.available() > 0) {
+        switch (consoleReader.feed((uint8_t)Serial.read())) {
+        case CommandReader::READ_SINGLE:
+            consoleSingle(consoleReader.single());
+            break;
+        case CommandReader::READ_BATCH:
+            consoleBatch(consoleReader.batch());
+            break;
+        case CommandReader::READ_ERROR:
+            replyLen = 4;
+            batchReply(consoleReader.batch(), consoleReader.error(), consoleReader.errorIndex());
+            break;
+        case CommandReader::READ_NONE:
+            break;
+        }
+    }
+    traceTick();
+}
+
+#ifdef PAIR_MIN_LATENCY
+void ConsoleTask(void* pvParameters) {
+    while (true) {
+        consoleWait();
+        consolePoll();
+    }
+}
+#endif
 
 // --- Setup Function ---
 void setup() {
+    traceBegin(PAIR_COUNT, 0); // Every pair starts on side A
     Serial.begin(115200);
     while (!Serial); // Wait for serial connection
+    Serial.setRxTimeout(1);           // Report RX after one idle symbol, not a full FIFO
+    Serial.onReceive(consoleRxWake);  // Wakes the console; no polling
     randomSeed(analogRead(0)); // Seed random number generator
     Serial.println("\n\nESP32 Motor Logic (No Web Server) Starting...");
 
+#ifdef PAIR_NATIVE_GPIO
+    // --- Bank 0 on GPIOs: no I2C bus to bring up ---
+    i2cMutex = xSemaphoreCreateMutex(); // Still the lock for any expander bank
+    if (i2cMutex == NULL) {
+        Serial.println("FATAL: Failed to create I2C Mutex! Halting.");
+        while(1) { vTaskDelay(portMAX_DELAY); }
+    }
+    Serial.print("Configuring relay and input GPIOs... ");
+    pcfBeginBank(0);
+    Serial.println("OK (Relays OFF)");
+#else
     // --- Initialize I2C Bus ---
     Serial.printf("Initializing I2C on SDA=%d, SCL=%d... ", I2C_SDA_PIN, I2C_SCL_PIN);
-    bool wireOk = Wire.begin(I2C_SDA_PIN, I2C_SCL_PIN);
+    bool wireOk = pcfBeginBus();
     if (!wireOk) {
         Serial.println("Failed!");
-        Serial.println("FATAL: Wire.begin() failed. Check I2C pins? Halting.");
+        Serial.println("FATAL: I2C bus init failed. Check I2C pins? Halting.");
         while(1) { vTaskDelay(portMAX_DELAY); }
     }
     Serial.println("OK");
@@ -189,27 +432,19 @@ void setup() {
     Serial.println("I2C Mutex Created.");
 
     // --- Configure PCF Pins (BEFORE begin()) ---
-    Serial.print("Configuring PCF8574 Pins... ");
+    Serial.print("Configuring " PCF_CHIP_NAME " Pins... ");
     if (xSemaphoreTake(i2cMutex, portMAX_DELAY) == pdTRUE) {
-        // Configure all relay pins as OUTPUT and set HIGH (OFF)
-        for (int i = 0; i < PAIR_COUNT * 2; i++) {
-            pcf_relays.pinMode(RELAY_PINS[i], OUTPUT);
-            pcf_relays.digitalWrite(RELAY_PINS[i], HIGH); // Initialize OFF
-        }
-        // Configure all input pins as INPUT
-        for (int i = 0; i < PAIR_COUNT * 2; i++) {
-            pcf_inputs.pinMode(INPUT_PINS[i], INPUT); // Use INPUT, ensure external pullups if needed
-        }
+        pcfConfigurePins();
         xSemaphoreGive(i2cMutex);
-        Serial.println("OK (Relays OFF, Inputs as INPUT)");
+        Serial.println(PCF_INPUT_MODE == INPUT_PULLUP ? "OK (Relays OFF, Inputs as INPUT_PULLUP)" : "OK (Relays OFF, Inputs as INPUT)");
     } else {
         Serial.println("Failed!");
         Serial.println("FATAL: Failed to get I2C mutex for pin configuration! Halting.");
         while(1) { vTaskDelay(portMAX_DELAY); }
     }
 
-    // --- Initialize PCF8574 Chips (AFTER pin config) ---
-    Serial.print("Initializing PCF8574 chips... ");
+    // --- Initialize Expander Chips (AFTER pin config) ---
+    Serial.print("Initializing " PCF_CHIP_NAME " chips... ");
     bool relayPcfOk = pcf_relays.begin();
     bool inputPcfOk = pcf_inputs.begin();
     if (!relayPcfOk || !inputPcfOk) {
@@ -221,6 +456,7 @@ void setup() {
          while(1) { vTaskDelay(portMAX_DELAY); }
     }
      Serial.println("OK");
+#endif
 
     // --- Relays are initialized OFF. Tasks will control activation. ---
     Serial.println("Relays initialized OFF.");
@@ -230,61 +466,79 @@ void setup() {
     for (int i = 0; i < PAIR_COUNT; i++) {
         // Populate task data
         motorTaskData[i].pairIndex = i;
-        motorTaskData[i].relayA = RELAY_PINS[i * 2];
-        motorTaskData[i].relayB = RELAY_PINS[i * 2 + 1];
-        motorTaskData[i].inputA = INPUT_PINS[i * 2];
-        motorTaskData[i].inputB = INPUT_PINS[i * 2 + 1];
+        motorTaskData[i].dwellMinMs = MIN_DELAY_MS;
+        motorTaskData[i].dwellMaxMs = MAX_DELAY_MS;
+        motorAssignPins(&motorTaskData[i], RELAY_PINS[i * 2], RELAY_PINS[i * 2 + 1],
+                        INPUT_PINS[i * 2], INPUT_PINS[i * 2 + 1]);
         // activeRelayA will be set to true inside the task initially
 
         char taskName[20];
         snprintf(taskName, sizeof(taskName), "MotorTask%d", i);
+        int core = MOTOR_TASK_CORE < 0 ? i % 2 : MOTOR_TASK_CORE;
 
         BaseType_t taskCreated = xTaskCreatePinnedToCore(
             MotorTask,        // Task function
             taskName,         // Task name
-            4096,             // Stack size
+            MOTOR_TASK_STACK, // Stack size
             &motorTaskData[i], // Task parameter
-            1,                // Task priority
-            NULL,             // Task handle
-            i % 2             // Core pinning
+            MOTOR_TASK_PRIORITY, // Task priority
+            &motorTaskHandles[i], // Task handle
+            core              // Core pinning
         );
 
         if (taskCreated != pdPASS) {
             Serial.printf("FATAL: Failed to create Motor Task %d! Error Code: %d\n", i, taskCreated);
              while(1) { vTaskDelay(portMAX_DELAY); } // Halt
         } else {
-             Serial.printf(" Motor Task %d created successfully on Core %d.\n", i, i % 2);
+             Serial.printf(" Motor Task %d created successfully on Core %d.\n", i, core);
         }
     }
 
+    group.pairs = motorTaskData;
+    if (xTaskCreatePinnedToCore(GroupTask, "GroupTask", MOTOR_TASK_STACK, NULL, MOTOR_TASK_PRIORITY, &groupTaskHandle,
+                                MOTOR_TASK_CORE < 0 ? 1 : MOTOR_TASK_CORE) != pdPASS) {
+        Serial.println("FATAL: Failed to create Group Task! Halting.");
+        while(1) { vTaskDelay(portMAX_DELAY); }
+    }
+
+#if defined(PAIR_NATIVE_GPIO)
+    // --- Input Edges: the handler cuts the arrived relays, then wakes the tasks ---
+    for (int i = 0; i < PAIR_COUNT; i++) pcfInputsWake(motorTaskHandles[i]);
+    pcfInputsWake(groupTaskHandle);
+    pcfInputsCapture(0, INPUT_PORT_MASK);
+    Serial.println("Input edges on the lane's input GPIOs.");
+#elif defined(PAIR_MCP23017)
+    // --- Input Edges: an input chip's INT wakes the tasks ---
+    for (int i = 0; i < PAIR_COUNT; i++) pcfInputsWake(motorTaskHandles[i]);
+    pcfInputsWake(groupTaskHandle);
+    if (!pcfInputsCapture(0, INPUT_PORT_MASK)) Serial.println("WARNING: Input edge capture not enabled; polling only.");
+    pinMode(EXPANDER_INT_GPIO, INPUT_PULLUP);
+    attachInterrupt(digitalPinToInterrupt(EXPANDER_INT_GPIO), pcfInputsInterrupt, FALLING);
+    Serial.printf("Input edges on GPIO %d.\n", EXPANDER_INT_GPIO);
+#endif
+
+#ifdef PAIR_MIN_LATENCY
+    if (xTaskCreatePinnedToCore(ConsoleTask, "Console", 4096, NULL, 1, NULL, CONSOLE_CORE) != pdPASS) {
+        Serial.println("FATAL: Failed to create Console Task! Halting.");
+        while(1) { vTaskDelay(portMAX_DELAY); }
+    }
+#endif
+
+#ifdef LATENCY_LOOP_BENCH
+    latencyLoopBegin();
+#endif
+
     Serial.println("\nSetup complete. All motor tasks created.");
     Serial.println("Tasks will now activate relays and wait for inputs.");
     Serial.println("========================================");
 }
 
-// --- Loop Function (Example: Enable sequence via Serial) ---
+// --- Loop Function: the serial console ---
 void loop() {
-    // Example: Check Serial input to enable/disable the sequence
-    if (Serial.available() > 0) {
-        char command = Serial.read();
-        if (command == 's' || command == 'S') {
-            if (!sequenceEnabled) {
-                Serial.println("COMMAND: Enabling sequence!");
-                sequenceEnabled = true;
-            } else {
-                 Serial.println("COMMAND: Sequence already enabled.");
-            }
-        } else if (command == 'x' || command == 'X') {
-             if (sequenceEnabled) {
-                Serial.println("COMMAND: Disabling sequence!");
-                sequenceEnabled = false;
-                // Tasks will stop themselves and turn off relays
-            } else {
-                 Serial.println("COMMAND: Sequence already disabled.");
-            }
-        }
-    }
-
-    // The main loop doesn't need to do much else with FreeRTOS
-    vTaskDelay(pdMS_TO_TICKS(100)); // Small delay
-}
\ No newline at end of file
+#ifdef PAIR_MIN_LATENCY
+    // loopTask lives on core 1; ConsoleTask does its job from core 0
+    vTaskDelete(NULL);
+#endif
+    consoleWait();
+    consolePoll();
+}
@@ -0,0 +1,103 @@
+#include <Arduino.h>
+#include "mcp23017.h"
+
+// What the PCF857x cannot do is why this build exists: interrupt-on-change
+// with the port captured at the first edge (INTCAP), on an INT output. Both
+// INT outputs are mirrored and open-drain, so every chip of a lane can share
+// one GPIO. readCapture() gets flags, capture and the live port in a single
+// burst, and the read releases INT.
+//
+// IOCON.BANK stays 0: A/B registers are paired, so a 16-bit access is one
+// pointer and two bytes.
+
+// Register addresses, IOCON.BANK = 0 (port B at A + 1)
+enum : uint8_t {
+    REG_IODIRA = 0x00,
+    REG_GPINTENA = 0x04,
+    REG_INTCONA = 0x08,
+    REG_IOCON = 0x0A,
+    REG_GPPUA = 0x0C,
+    REG_INTFA = 0x0E,
+    REG_GPIOA = 0x12,
+    REG_OLATA = 0x14,
+};
+
+const uint8_t IOCON_MIRROR = 0x40; // INTA and INTB both signal either port
+const uint8_t IOCON_ODR = 0x04;    // INT open-drain, so chips can share a line
+
+Mcp23017::Mcp23017(uint8_t address, TwoWire& wire) : wire_(wire), address_(address) {}
+
+bool Mcp23017::begin() {
+    // Latch before direction: a relay output never comes up LOW
+    wire_.beginTransmission(address_);
+    wire_.write(REG_IOCON);
+    wire_.write(IOCON_MIRROR | IOCON_ODR);
+    if (wire_.endTransmission() != 0) return false;
+    begun_ = writePair(REG_OLATA, latch_) && writePair(REG_GPPUA, pullups_) &&
+             writePair(REG_IODIRA, (uint16_t)~outputs_) && writePair(REG_INTCONA, 0);
+    return begun_;
+}
+
+void Mcp23017::pinMode(uint8_t pin, uint8_t mode) {
+    uint16_t bit = (uint16_t)(1u << pin);
+    outputs_ = mode == OUTPUT ? outputs_ | bit : outputs_ & ~bit;
+    pullups_ = mode == INPUT_PULLUP ? pullups_ | bit : pullups_ & ~bit;
+    if (begun_) {
+        // Latch before direction, as begin(): a new output drives what it was told
+        writePair(REG_OLATA, latch_);
+        writePair(REG_GPPUA, pullups_);
+        writePair(REG_IODIRA, (uint16_t)~outputs_);
+    }
+}
+
+bool Mcp23017::digitalWrite(uint8_t pin, uint8_t value) {
+    uint16_t bit = (uint16_t)(1u << pin);
+    latch_ = value == HIGH ? latch_ | bit : latch_ & ~bit;
+    return !begun_ || writePair(REG_OLATA, latch_);
+}
+
+uint8_t Mcp23017::digitalRead(uint8_t pin) {
+    return (digitalReadAll() >> pin) & 1 ? HIGH : LOW;
+}
+
+uint16_t Mcp23017::digitalReadAll() {
+    uint8_t b[2] = {0xFF, 0xFF};
+    readRegisters(REG_GPIOA, b, 2);
+    return (uint16_t)(b[0] | b[1] << 8);
+}
+
+bool Mcp23017::digitalWriteAll(uint16_t value) {
+    latch_ = value;
+    return writePair(REG_OLATA, latch_);
+}
+
+bool Mcp23017::enableCapture(uint16_t pins) {
+    return writePair(REG_GPINTENA, pins);
+}
+
+bool Mcp23017::readCapture(uint16_t& flags, uint16_t& captured, uint16_t& port) {
+    // INTFA/B, INTCAPA/B, GPIOA/B are consecutive
+    uint8_t b[6] = {0, 0, 0xFF, 0xFF, 0xFF, 0xFF};
+    bool ok = readRegisters(REG_INTFA, b, 6);
+    flags = (uint16_t)(b[0] | b[1] << 8);
+    captured = (uint16_t)(b[2] | b[3] << 8);
+    port = (uint16_t)(b[4] | b[5] << 8);
+    return ok;
+}
+
+bool Mcp23017::writePair(uint8_t reg, uint16_t value) {
+    wire_.beginTransmission(address_);
+    wire_.write(reg);
+    wire_.write((uint8_t)value);
+    wire_.write((uint8_t)(value >> 8));
+    return wire_.endTransmission() == 0;
+}
+
+bool Mcp23017::readRegisters(uint8_t reg, uint8_t* out, uint8_t n) {
+    wire_.beginTransmission(address_);
+    wire_.write(reg);
+    if (wire_.endTransmission(false) != 0) return false; // Repeated start
+    if (wire_.requestFrom(address_, n) != n) return false;
+    for (uint8_t i = 0; i < n; i++) out[i] = (uint8_t)wire_.read();
+    return true;
+}
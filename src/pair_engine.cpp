@@ -0,0 +1,26 @@
+#include "pair_engine.h"
+#include "pair_policies.h"
+#include "pin_map.h"
+
+void motorAssignPins(MotorTaskData* data, int relayA, int relayB, int inputA, int inputB) {
+    data->relayA = relayA;
+    data->relayB = relayB;
+    data->inputA = inputA;
+    data->inputB = inputB;
+    data->relayBank = pinBank(relayA);
+    data->relayMaskA = pinMask(relayA);
+    data->relayMaskB = pinMask(relayB);
+    data->inputBank = pinBank(inputA);
+    data->inputMaskA = pinMask(inputA);
+    data->inputMaskB = pinMask(inputB);
+    pcfStopOnInput(inputA, relayA);
+    pcfStopOnInput(inputB, relayB);
+}
+
+void motorReset(MotorTaskData* data) {
+    FirmwareEngine::reset(data);
+}
+
+uint32_t motorStep(MotorTaskData* data, bool enabled, bool paused) {
+    return FirmwareEngine::step(data, enabled, paused);
+}
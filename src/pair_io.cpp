@@ -0,0 +1,385 @@
+#include <Arduino.h>
+#include <esp_timer.h>
+#include "config.h"
+#include "pair_io.h"
+#include "pin_map.h"
+#include "trace.h"
+#include <atomic>
+#include <new>
+#ifndef PAIR_I2C_ASYNC
+#include <Wire.h>
+#endif
+#ifdef PAIR_NATIVE_GPIO
+#include <driver/gpio.h>
+#include "soc/soc.h"
+#include "soc/gpio_reg.h"
+#endif
+
+// --- Global Objects ---
+PcfChip pcf_relays(PCF_ADDRESS_RELAYS);
+PcfChip pcf_inputs(PCF_ADDRESS_INPUTS);
+SemaphoreHandle_t i2cMutex; // Mutex for thread-safe I2C bus access
+
+// --- Expander Banks ---
+// Bank 0 is pcf_relays / pcf_inputs. Everything below is guarded by i2cMutex.
+static PcfChip* relayBanks[PCF_MAX_BANKS] = {&pcf_relays};
+static PcfChip* inputBanks[PCF_MAX_BANKS] = {&pcf_inputs};
+static PcfPort relayLatch[PCF_MAX_BANKS] = {PCF_ALL_HIGH}; // Last port written to each relay chip
+static int bankCount = 1;
+
+#ifdef PAIR_INPUT_EDGES
+static volatile uint32_t irqUs = 0;       // micros() of the last interrupt
+static TaskHandle_t wakeTasks[INPUT_WAKE_MAX];
+static int wakeCount = 0;
+#endif
+#ifdef PAIR_MCP23017
+static std::atomic<uint16_t> irqBanks(0); // Flagged by the last interrupt, not read since
+static PcfPort capturedLow[PCF_MAX_BANKS]; // Pins LOW at the last capture per input bank...
+static uint32_t capturedMs[PCF_MAX_BANKS]; // ...taken at this millis()
+#endif
+
+#ifdef PAIR_NATIVE_GPIO
+// --- Native GPIO Lane (bank 0) ---
+// relayLatch[0], laneStops and laneCutLow are shared with the edge handler,
+// so they change only under laneMux; no bus, so no i2cMutex.
+//
+// The handler and everything it calls are IRAM_ATTR and touch only DRAM, and
+// it is registered with ESP_INTR_FLAG_IRAM, so it keeps cutting relays while
+// a flash write (an NVS save) has the cache off on both cores. That includes
+// the GPIO tables: the constexpr ones in config.h may sit in flash, so
+// laneBegin() copies them to the DRAM tables below first.
+static portMUX_TYPE laneMux = portMUX_INITIALIZER_UNLOCKED;
+static PcfPort laneStops[PCF_PINS]; // Per input pin: relays its LOW turns off
+static PcfPort laneCutLow = 0;      // Input pins whose LOW the handler acted on
+static uint32_t laneRelayBits[PCF_PINS]; // GPIO_OUT_REG bit per relay pin (0: not wired)
+static uint32_t laneRelayWired = 0;      // Every relay's GPIO_OUT_REG bit
+static int8_t laneInputGpios[PCF_PINS];  // -1: not wired
+
+// Relay port -> GPIO outputs, with no read-modify-write of GPIO_OUT_REG to
+// race other writers of GPIO 0..31: every relay going OFF in one W1TS store,
+// then every one going ON in one W1TC store (active LOW: off before on)
+static void IRAM_ATTR laneWrite(PcfPort port) {
+    uint32_t high = 0;
+    for (int bit = 0; bit < PCF_PINS; bit++) {
+        if (port & (1u << bit)) high |= laneRelayBits[bit];
+    }
+    REG_WRITE(GPIO_OUT_W1TS_REG, high);
+    REG_WRITE(GPIO_OUT_W1TC_REG, laneRelayWired & ~high);
+}
+
+// GPIO_IN_REG / GPIO_IN1_REG -> input port (unwired pins read HIGH)
+static PcfPort IRAM_ATTR laneRead() {
+    uint32_t in = REG_READ(GPIO_IN_REG), in1 = REG_READ(GPIO_IN1_REG);
+    PcfPort port = PCF_ALL_HIGH;
+    for (int bit = 0; bit < PCF_PINS; bit++) {
+        int gpio = laneInputGpios[bit];
+        if (gpio < 0) continue;
+        uint32_t level = gpio < 32 ? in >> gpio : in1 >> (gpio - 32);
+        if (!(level & 1)) port &= (PcfPort)~(1u << bit);
+    }
+    return port;
+}
+
+static void IRAM_ATTR laneEdge(void*) {
+    pcfInputsInterrupt();
+}
+
+static bool laneBegin() {
+    portENTER_CRITICAL(&laneMux);
+    laneRelayWired = 0;
+    for (int bit = 0; bit < PCF_PINS; bit++) {
+        laneRelayBits[bit] = LANE_RELAY_GPIOS[bit] >= 0 ? 1u << LANE_RELAY_GPIOS[bit] : 0;
+        laneRelayWired |= laneRelayBits[bit];
+        laneInputGpios[bit] = (int8_t)LANE_INPUT_GPIOS[bit];
+    }
+    relayLatch[0] = PCF_ALL_HIGH;
+    laneCutLow = 0;
+    laneWrite(PCF_ALL_HIGH); // Latch OFF before the pins start driving
+    portEXIT_CRITICAL(&laneMux);
+    for (int bit = 0; bit < PCF_PINS; bit++) {
+        if (LANE_RELAY_GPIOS[bit] >= 0) pinMode(LANE_RELAY_GPIOS[bit], OUTPUT);
+        int gpio = LANE_INPUT_GPIOS[bit];
+        if (gpio >= 0) pinMode(gpio, gpio >= 34 ? INPUT : INPUT_PULLUP); // 34..39 have no pull-up
+    }
+    return true;
+}
+
+// Edge handler's half: every relay on whose switch reads closed, off now
+static void IRAM_ATTR laneCut(uint32_t us) {
+    portENTER_CRITICAL_ISR(&laneMux);
+    PcfPort in = laneRead();
+    PcfPort before = relayLatch[0];
+    PcfPort cut = 0;
+    for (int bit = 0; bit < PCF_PINS; bit++) {
+        if ((in & (1u << bit)) || !(laneStops[bit] & ~before)) continue;
+        cut |= laneStops[bit];
+        laneCutLow |= (PcfPort)(1u << bit);
+    }
+    if (cut) {
+        relayLatch[0] = before | cut;
+        laneWrite(relayLatch[0]);
+    }
+    PcfPort port = in & (PcfPort)~laneCutLow;
+    portEXIT_CRITICAL_ISR(&laneMux);
+    traceInputsAt(0, port, us);
+    traceRelays(0, before, before | cut);
+}
+#endif
+
+bool pcfBeginBus() {
+#ifdef PAIR_I2C_ASYNC
+    return Pcf857xAsync::beginBus(I2C_SDA_PIN, I2C_SCL_PIN);
+#else
+    return Wire.begin(I2C_SDA_PIN, I2C_SCL_PIN);
+#endif
+}
+
+bool pcfAddBank(uint8_t relayAddress, uint8_t inputAddress) {
+    if (bankCount >= PCF_MAX_BANKS) return false;
+    relayBanks[bankCount] = new PcfChip(relayAddress);
+    inputBanks[bankCount] = new PcfChip(inputAddress);
+    relayLatch[bankCount] = PCF_ALL_HIGH;
+    bankCount++;
+    return true;
+}
+
+void pcfResetBanks() {
+    for (int b = 1; b < bankCount; b++) {
+        delete relayBanks[b];
+        delete inputBanks[b];
+    }
+    bankCount = 1;
+    // Bank 0's chips as constructed too: a driver that remembers it was begun
+    // (Mcp23017) would otherwise reconfigure a fresh chip out of order
+    pcf_relays.~PcfChip();
+    new (&pcf_relays) PcfChip(PCF_ADDRESS_RELAYS);
+    pcf_inputs.~PcfChip();
+    new (&pcf_inputs) PcfChip(PCF_ADDRESS_INPUTS);
+    relayLatch[0] = PCF_ALL_HIGH;
+#ifdef PAIR_NATIVE_GPIO
+    for (int bit = 0; bit < PCF_PINS; bit++) laneStops[bit] = 0;
+    laneCutLow = 0;
+#endif
+#ifdef PAIR_MCP23017
+    irqBanks.store(0);
+    for (int b = 0; b < PCF_MAX_BANKS; b++) {
+        capturedLow[b] = 0;
+        capturedMs[b] = 0;
+    }
+#endif
+}
+
+int pcfBankCount() { return bankCount; }
+PcfChip& pcfRelayBank(int bank) { return *relayBanks[bank]; }
+PcfChip& pcfInputBank(int bank) { return *inputBanks[bank]; }
+
+bool pcfBeginBank(int bank) {
+#ifdef PAIR_NATIVE_GPIO
+    if (bank < PCF_GPIO_BANKS) return laneBegin();
+#endif
+    return relayBanks[bank]->begin() && inputBanks[bank]->begin();
+}
+
+// --- Thread-Safe Expander Functions ---
+// Per-pin access is the port access with a one-bit mask: same single bus
+// transaction, and the shadow latch keeps the other relays as they were.
+void pcfWriteRelay(uint8_t pin, uint8_t value) {
+    if (PCF_BANK(pin) >= bankCount) {
+        Serial.printf("ERROR: RELAY pin %d has no expander bank\n", pin);
+        return;
+    }
+    pcfWriteRelays(pinMask(pin), value ? PCF_ALL_HIGH : 0, PCF_BANK(pin));
+}
+
+uint8_t pcfReadInput(uint8_t pin) {
+    if (PCF_BANK(pin) >= bankCount) {
+        Serial.printf("ERROR: INPUT pin %d has no expander bank\n", pin);
+        return HIGH; // Default to not pressed
+    }
+    return (pcfReadInputs(PCF_BANK(pin)) & pinMask(pin)) ? HIGH : LOW;
+}
+
+PcfPort pcfReadInputs(uint8_t bank) {
+    PcfPort port = PCF_ALL_HIGH; // Default to nothing pressed
+    if (bank >= bankCount) return port;
+#ifdef PAIR_NATIVE_GPIO
+    if (bank < PCF_GPIO_BANKS) {
+        portENTER_CRITICAL(&laneMux);
+        port = laneRead() & (PcfPort)~laneCutLow;
+        portEXIT_CRITICAL(&laneMux);
+        traceInputs(bank, port);
+        return port;
+    }
+#endif
+#ifdef PAIR_I2C_ASYNC
+    // No i2cMutex: the chip serialises its own reads, and a relay write due
+    // meanwhile is queued rather than held up behind this one
+    port = inputBanks[bank]->digitalReadAll();
+    traceInputs(bank, port);
+    return port;
+#endif
+    if (xSemaphoreTake(i2cMutex, portMAX_DELAY) == pdTRUE) {
+#ifdef PAIR_MCP23017
+        uint32_t edgeUs = irqUs;
+        bool flagged = irqBanks.fetch_and((uint16_t)~(1u << bank)) & (1u << bank);
+        uint16_t flags = 0, captured = PCF_ALL_HIGH;
+        inputBanks[bank]->readCapture(flags, captured, port);
+        uint32_t now = millis();
+        if (flags) {
+            capturedLow[bank] = (PcfPort)~captured;
+            capturedMs[bank] = now;
+        }
+        if (now - capturedMs[bank] < INPUT_CAPTURE_HOLD_MS) port &= (PcfPort)~capturedLow[bank];
+        xSemaphoreGive(i2cMutex);
+        if (flags) traceInputsAt(bank, captured, flagged ? edgeUs : micros());
+#else
+        port = inputBanks[bank]->digitalReadAll();
+        xSemaphoreGive(i2cMutex);
+#endif
+        traceInputs(bank, port);
+    } else {
+        Serial.printf("ERROR: Failed to get I2C mutex for INPUT port read (bank %d)\n", bank);
+    }
+    return port;
+}
+
+void pcfWriteRelays(PcfPort mask, PcfPort value, uint8_t bank) {
+    if (bank >= bankCount) return;
+#ifdef PAIR_NATIVE_GPIO
+    if (bank < PCF_GPIO_BANKS) {
+        portENTER_CRITICAL(&laneMux);
+        PcfPort before = relayLatch[bank];
+        relayLatch[bank] = (before & ~mask) | (value & mask);
+        PcfPort on = mask & (PcfPort)~value;
+        for (int bit = 0; bit < PCF_PINS; bit++) {
+            if (laneStops[bit] & on) laneCutLow &= (PcfPort)~(1u << bit); // Its switch counts again
+        }
+        laneWrite(relayLatch[bank]);
+        portEXIT_CRITICAL(&laneMux);
+        traceRelays(bank, before, relayLatch[bank]);
+        return;
+    }
+#endif
+    if (xSemaphoreTake(i2cMutex, portMAX_DELAY) == pdTRUE) {
+        PcfPort before = relayLatch[bank];
+        relayLatch[bank] = (before & ~mask) | (value & mask);
+        relayBanks[bank]->digitalWriteAll(relayLatch[bank]);
+        traceRelays(bank, before, relayLatch[bank]);
+        xSemaphoreGive(i2cMutex);
+    } else {
+        Serial.printf("ERROR: Failed to get I2C mutex for RELAY port write (bank %d, mask 0x%02X)\n", bank, mask);
+    }
+}
+
+PcfPort pcfRelayLatch(uint8_t bank) {
+    return bank < bankCount ? relayLatch[bank] : PCF_ALL_HIGH;
+}
+
+void pcfConfigurePins() {
+    // Configure all relay pins as OUTPUT and set HIGH (OFF)
+    for (int i = 0; i < PAIR_COUNT * 2; i++) {
+        pcf_relays.pinMode(RELAY_PINS[i], OUTPUT);
+        pcf_relays.digitalWrite(RELAY_PINS[i], HIGH); // Initialize OFF
+    }
+    for (int i = 0; i < AUX_COUNT; i++) {
+        pcf_relays.pinMode(AUX_PINS[i], OUTPUT);
+        pcf_relays.digitalWrite(AUX_PINS[i], HIGH);
+    }
+    relayLatch[0] = PCF_ALL_HIGH;
+    // Configure all input pins as INPUT
+    for (int i = 0; i < PAIR_COUNT * 2; i++) {
+        pcf_inputs.pinMode(INPUT_PINS[i], PCF_INPUT_MODE); // PCF8574 INPUT: ensure external pullups if needed
+    }
+}
+
+bool pcfInputsCapture(uint8_t bank, PcfPort pins) {
+#if defined(PAIR_NATIVE_GPIO)
+    if (bank >= bankCount) return false;
+    if (bank >= PCF_GPIO_BANKS) return true; // Expander banks stay polled
+    // Not attachInterrupt(): the core's handler service is not IRAM-safe
+    // unless rebuilt with CONFIG_ARDUINO_ISR_IRAM. Installed first, this one
+    // is, and a later attachInterrupt() shares it.
+    esp_err_t err = gpio_install_isr_service(ESP_INTR_FLAG_IRAM);
+    if (err != ESP_OK && err != ESP_ERR_INVALID_STATE) return false;
+    for (int bit = 0; bit < PCF_PINS; bit++) {
+        gpio_num_t gpio = (gpio_num_t)LANE_INPUT_GPIOS[bit];
+        if (!(pins & (1u << bit)) || gpio < 0) continue;
+        if (gpio_set_intr_type(gpio, GPIO_INTR_ANYEDGE) != ESP_OK ||
+            gpio_isr_handler_add(gpio, laneEdge, nullptr) != ESP_OK || gpio_intr_enable(gpio) != ESP_OK) {
+            return false;
+        }
+    }
+    return true;
+#elif defined(PAIR_MCP23017)
+    if (bank >= bankCount) return false;
+    bool ok = false;
+    if (xSemaphoreTake(i2cMutex, portMAX_DELAY) == pdTRUE) {
+        ok = inputBanks[bank]->enableCapture(pins);
+        xSemaphoreGive(i2cMutex);
+    }
+    return ok;
+#else
+    (void)bank;
+    (void)pins;
+    return true;
+#endif
+}
+
+void pcfInputsWake(TaskHandle_t task) {
+#ifdef PAIR_INPUT_EDGES
+    if (wakeCount < INPUT_WAKE_MAX) wakeTasks[wakeCount++] = task;
+#else
+    (void)task;
+#endif
+}
+
+void IRAM_ATTR pcfInputsInterrupt() {
+#ifdef PAIR_INPUT_EDGES
+    irqUs = (uint32_t)esp_timer_get_time(); // micros(), but in IRAM on every core build
+#ifdef PAIR_MCP23017
+    // One line for every chip: which bank it was is only known by reading
+    irqBanks.store((uint16_t)((1u << bankCount) - 1));
+#else
+    laneCut(irqUs);
+#endif
+    BaseType_t woken = pdFALSE;
+    for (int i = 0; i < wakeCount; i++) vTaskNotifyGiveFromISR(wakeTasks[i], &woken);
+    portYIELD_FROM_ISR(woken);
+#endif
+}
+
+void pcfStopOnInput(int inputPin, int relayPin) {
+#ifdef PAIR_NATIVE_GPIO
+    if (PCF_BANK(inputPin) >= PCF_GPIO_BANKS || PCF_BANK(relayPin) >= PCF_GPIO_BANKS) return;
+    portENTER_CRITICAL(&laneMux);
+    laneStops[PCF_BIT(inputPin)] |= pinMask(relayPin);
+    portEXIT_CRITICAL(&laneMux);
+#else
+    (void)inputPin;
+    (void)relayPin;
+#endif
+}
+
+void pcfInputsService() {
+#ifdef PAIR_MCP23017
+    uint16_t banks = irqBanks.load();
+    for (int b = 0; banks && b < bankCount; b++) {
+        if (banks & (1u << b)) pcfReadInputs(b);
+    }
+#endif
+}
+
+// Helper function to stop a relay (set HIGH)
+void stopRelay(int relayPin) {
+    pcfWriteRelay(relayPin, HIGH);
+}
+
+// Helper function to start a relay (set LOW)
+void startRelay(int relayPin) {
+    pcfWriteRelay(relayPin, LOW);
+}
+
+// Helper function to check if an input is pressed (LOW)
+bool isInputPressed(int inputPin) {
+    return (pcfReadInput(inputPin) == LOW);
+}
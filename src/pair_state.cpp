@@ -0,0 +1,104 @@
+#include <atomic>
+#include <string.h>
+#include "group_engine.h"
+#include "pair_io.h"
+#include "pair_state.h"
+
+// --- Seqlock Slots ---
+// seq is odd while the writer is copying in. A reader copies out between
+// two loads of seq and retries if they differ or the first was odd. The
+// snapshot itself is stored as relaxed atomic words, so a read that races
+// a write is merely discarded, never undefined.
+template <typename T>
+struct StateSlot {
+    static const int WORDS = (sizeof(T) + sizeof(uint32_t) - 1) / sizeof(uint32_t);
+
+    std::atomic<uint32_t> seq;
+    std::atomic<uint32_t> words[WORDS];
+
+    void publish(const T& s) {
+        uint32_t w[WORDS] = {};
+        memcpy(w, &s, sizeof(s));
+        uint32_t n = seq.load(std::memory_order_relaxed);
+        seq.store(n + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (int i = 0; i < WORDS; i++) words[i].store(w[i], std::memory_order_relaxed);
+        seq.store(n + 2, std::memory_order_release);
+    }
+
+    bool read(T* out) {
+        uint32_t w[WORDS];
+        uint32_t before, after;
+        do {
+            before = seq.load(std::memory_order_acquire);
+            for (int i = 0; i < WORDS; i++) w[i] = words[i].load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            after = seq.load(std::memory_order_relaxed);
+        } while ((before & 1) || before != after);
+        if (before == 0) return false;
+        memcpy(out, w, sizeof(*out));
+        return true;
+    }
+};
+
+static StateSlot<PairState> slots[PAIR_STATE_SLOTS];
+static StateSlot<GroupState> groupSlot;
+
+void pairStatePublish(const MotorTaskData* data) {
+    if (data->pairIndex < 0 || data->pairIndex >= PAIR_STATE_SLOTS) return;
+
+    PairState s;
+    memset(&s, 0, sizeof(s)); // Padding is copied too
+    s.phaseStartMs = data->phaseStartMs;
+    s.phaseMs = data->phase == PHASE_DWELL ? data->dwellMs
+              : data->phase == PHASE_TRAVEL ? data->lastTravelMs : 0;
+    s.cycles = data->cycles;
+    // This task is the only writer of its relay bits, so its view of the
+    // latch is exact without taking i2cMutex.
+    PcfPort latch = pcfRelayLatch(data->relayBank);
+    s.relays = (!(latch & data->relayMaskA) ? PAIR_RELAY_A : 0) | (!(latch & data->relayMaskB) ? PAIR_RELAY_B : 0);
+    s.inputs = (!(data->inputPort & data->inputMaskA) ? PAIR_INPUT_A : 0) |
+               (!(data->inputPort & data->inputMaskB) ? PAIR_INPUT_B : 0);
+    s.phase = data->phase;
+    s.sideB = !data->activeRelayA;
+    s.paused = data->paused;
+    s.pausedAtMs = data->pausedAtMs;
+    slots[data->pairIndex].publish(s);
+}
+
+bool pairStateRead(int pair, PairState* out) {
+    if (pair < 0 || pair >= PAIR_STATE_SLOTS) return false;
+    return slots[pair].read(out);
+}
+
+uint32_t pairStateRemainingMs(const PairState& state, uint32_t nowMs) {
+    uint32_t elapsed = (state.paused ? state.pausedAtMs : nowMs) - state.phaseStartMs;
+    return elapsed < state.phaseMs ? state.phaseMs - elapsed : 0;
+}
+
+void groupStatePublish(const GroupData* g) {
+    GroupState s;
+    memset(&s, 0, sizeof(s)); // Padding and unused members too
+    s.first = g->first;
+    s.count = g->count;
+    s.mode = g->rules.mode;
+    s.k = g->rules.k;
+    s.gap = g->rules.gap;
+    s.holdSteps = g->rules.holdSteps;
+    s.noRepeat = g->rules.noRepeat;
+    s.running = g->running;
+    s.windowMs = g->rules.windowMs;
+    s.selectionCount = g->selectionCount;
+    s.windows = g->windows;
+    s.exposed = g->exposed;
+    s.faceSpreadMs = g->faceSpreadMs;
+    s.faceWindows = g->faceWindows;
+    for (int c = 0; c < AUX_COUNT; c++) s.aux[c] = GroupAuxState{g->aux[c].event, g->aux[c].on, g->aux[c].pulseMs};
+    for (int i = 0; i < g->count; i++) {
+        const MotorTaskData& p = g->pairs[g->first + i];
+        s.members[i] = GroupMemberState{p.travelEstMs[1], (uint16_t)groupLeadMs(g, i), p.faceErrorMs};
+    }
+    groupSlot.publish(s);
+}
+
+bool groupStateRead(GroupState* out) { return groupSlot.read(out); }
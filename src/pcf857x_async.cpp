@@ -0,0 +1,141 @@
+#ifdef PAIR_I2C_ASYNC
+
+#include <Arduino.h>
+#include <atomic>
+#include "pcf857x_async.h"
+
+// The bus runs asynchronously (I2C_QUEUE_DEPTH): digitalWriteAll() queues
+// the port and returns, and the I2C interrupt clocks it out behind whatever
+// is ahead of it; a writer waits only when the queue is full. The driver
+// does not copy, so every write gets its own slot of a ring one longer than
+// the queue plus the transfer on the wire. A read is queued the same way,
+// and the reader blocks on a semaphore its completion callback gives, so
+// the CPU is free while the bytes come in. The driver runs transactions in
+// the order they were queued, so a read sees every write queued before it.
+//
+// Each chip is two driver devices on one address, one per direction, which
+// is how a completion is known to be the read's. Reads of one chip are
+// serialised here.
+
+static i2c_master_bus_handle_t bus = nullptr;
+static std::atomic<uint32_t> writeNacks(0);
+
+bool Pcf857xAsync::beginBus(int sda, int scl) {
+    if (bus) return true;
+    i2c_master_bus_config_t config = {};
+    config.i2c_port = -1; // Any free controller
+    config.sda_io_num = (gpio_num_t)sda;
+    config.scl_io_num = (gpio_num_t)scl;
+    config.clk_source = I2C_CLK_SRC_DEFAULT;
+    config.glitch_ignore_cnt = 7;
+    config.trans_queue_depth = I2C_QUEUE_DEPTH;
+    config.flags.enable_internal_pullup = 1;
+    return i2c_new_master_bus(&config, &bus) == ESP_OK;
+}
+
+bool Pcf857xAsync::flush() {
+    return bus && i2c_master_bus_wait_all_done(bus, -1) == ESP_OK;
+}
+
+uint32_t Pcf857xAsync::writesFailed() { return writeNacks.load(); }
+
+Pcf857xAsync::Pcf857xAsync(uint8_t address) : address_(address) {}
+
+Pcf857xAsync::~Pcf857xAsync() {
+    if (writer_) i2c_master_bus_rm_device(writer_);
+    if (reader_) i2c_master_bus_rm_device(reader_);
+    if (readLock_) vSemaphoreDelete(readLock_);
+    if (readDone_) vSemaphoreDelete(readDone_);
+}
+
+// Completion callbacks run in the I2C interrupt
+bool IRAM_ATTR Pcf857xAsync::onWritten(i2c_master_dev_handle_t, const i2c_master_event_data_t* evt, void*) {
+    if (evt->event != I2C_EVENT_DONE) writeNacks++;
+    return false;
+}
+
+bool IRAM_ATTR Pcf857xAsync::onRead(i2c_master_dev_handle_t, const i2c_master_event_data_t* evt, void* arg) {
+    Pcf857xAsync* chip = static_cast<Pcf857xAsync*>(arg);
+    BaseType_t woken = pdFALSE;
+    chip->readAck_ = evt->event == I2C_EVENT_DONE;
+    chip->readsDone_.fetch_add(1, std::memory_order_release);
+    xSemaphoreGiveFromISR(chip->readDone_, &woken);
+    return woken == pdTRUE;
+}
+
+i2c_master_dev_handle_t Pcf857xAsync::addDevice(i2c_master_callback_t done) {
+    i2c_device_config_t config = {};
+    config.dev_addr_length = I2C_ADDR_BIT_LEN_7;
+    config.device_address = address_;
+    config.scl_speed_hz = I2C_CLOCK_HZ;
+    i2c_master_dev_handle_t dev = nullptr;
+    if (i2c_master_bus_add_device(bus, &config, &dev) != ESP_OK) return nullptr;
+    i2c_master_event_callbacks_t callbacks = {};
+    callbacks.on_trans_done = done;
+    if (i2c_master_register_event_callbacks(dev, &callbacks, this) != ESP_OK) return nullptr;
+    return dev;
+}
+
+bool Pcf857xAsync::begin() {
+    if (!bus || i2c_master_probe(bus, address_, I2C_READ_TIMEOUT_MS) != ESP_OK) return false;
+    if (!writer_) {
+        readLock_ = xSemaphoreCreateMutex();
+        readDone_ = xSemaphoreCreateBinary();
+        writer_ = addDevice(onWritten);
+        reader_ = addDevice(onRead);
+    }
+    return writer_ && reader_ && digitalWriteAll(latch_);
+}
+
+void Pcf857xAsync::pinMode(uint8_t pin, uint8_t mode) {
+    PcfPort bit = (PcfPort)(1u << pin);
+    outputs_ = mode == OUTPUT ? outputs_ | bit : outputs_ & ~bit;
+}
+
+bool Pcf857xAsync::digitalWrite(uint8_t pin, uint8_t value) {
+    PcfPort bit = (PcfPort)(1u << pin);
+    PcfPort latch = value == HIGH ? latch_ | bit : latch_ & ~bit;
+    if (!writer_) {
+        latch_ = latch;
+        return true;
+    }
+    return digitalWriteAll(latch);
+}
+
+uint8_t Pcf857xAsync::digitalRead(uint8_t pin) {
+    return (digitalReadAll() >> pin) & 1 ? HIGH : LOW;
+}
+
+PcfPort Pcf857xAsync::digitalReadAll() {
+    PcfPort port = PCF_ALL_HIGH;
+    if (!reader_ || xSemaphoreTake(readLock_, portMAX_DELAY) != pdTRUE) return port;
+    if (i2c_master_receive(reader_, readBuf_, BYTES, -1) == ESP_OK) {
+        // Reads complete in the order queued, so this one is done when the
+        // count reaches it. Completions of earlier reads that timed out
+        // land first and only give the semaphore; readBuf_ is this read's
+        // once they are all in.
+        uint32_t seq = ++readsQueued_;
+        TickType_t start = xTaskGetTickCount(), limit = pdMS_TO_TICKS(I2C_READ_TIMEOUT_MS);
+        while (readsDone_.load(std::memory_order_acquire) != seq) {
+            TickType_t waited = xTaskGetTickCount() - start;
+            if (waited >= limit || xSemaphoreTake(readDone_, limit - waited) != pdTRUE) break;
+        }
+        if (readsDone_.load(std::memory_order_acquire) == seq && readAck_) {
+            port = readBuf_[0];
+            port |= BYTES > 1 ? (PcfPort)(readBuf_[BYTES - 1] << 8) : (PcfPort)0xFF00;
+        }
+    }
+    xSemaphoreGive(readLock_);
+    return port;
+}
+
+bool Pcf857xAsync::digitalWriteAll(PcfPort value) {
+    latch_ = value;
+    PcfPort port = latch_ | (PcfPort)~outputs_; // Inputs stay released
+    uint8_t* slot = ring_[next_];
+    next_ = (uint8_t)((next_ + 1) % RING);
+    for (int i = 0; i < BYTES; i++) slot[i] = (uint8_t)(port >> (8 * i));
+    return writer_ && i2c_master_transmit(writer_, slot, BYTES, -1) == ESP_OK;
+}
+
+#endif
@@ -0,0 +1,96 @@
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include "start_gate.h"
+
+struct Claim {
+    uint32_t dueMs;
+    uint32_t askedMs;
+    uint8_t want; // 0: not waiting
+};
+
+static int cap = START_CAP > START_CAP_MAX ? START_CAP_MAX : START_CAP;
+static uint32_t windowMs = START_WINDOW_MS;
+static uint32_t startedMs[START_CAP_MAX]; // Ring of the last cap starts
+static int startedNext = 0, startedCount = 0;
+static Claim claims[START_GATE_CLAIMANTS];
+static portMUX_TYPE gateMux = portMUX_INITIALIZER_UNLOCKED;
+
+// Caller holds gateMux.
+static void clear() {
+    startedNext = 0;
+    startedCount = 0;
+    for (Claim& c : claims) c.want = 0;
+}
+
+void startGateConfigure(int newCap, uint32_t newWindowMs) {
+    portENTER_CRITICAL(&gateMux);
+    cap = newCap < 0 ? 0 : newCap > START_CAP_MAX ? START_CAP_MAX : newCap;
+    windowMs = newWindowMs;
+    clear();
+    portEXIT_CRITICAL(&gateMux);
+}
+
+void startGateReset() {
+    portENTER_CRITICAL(&gateMux);
+    clear();
+    portEXIT_CRITICAL(&gateMux);
+}
+
+int startGateCap() { return cap; }
+uint32_t startGateWindowMs() { return windowMs; }
+
+int startGateClaim(int who, int want, uint32_t dueMs, uint32_t nowMs, uint32_t* retryMs) {
+    *retryMs = 0;
+    if (who < 0 || who >= START_GATE_CLAIMANTS) return want;
+    portENTER_CRITICAL(&gateMux);
+    if (!cap || !windowMs || want <= 0) {
+        claims[who].want = 0;
+        portEXIT_CRITICAL(&gateMux);
+        return want;
+    }
+
+    // Slots still held by a start within the window, and when the first frees
+    int used = 0;
+    uint32_t frees = windowMs;
+    for (int i = 0; i < startedCount; i++) {
+        uint32_t age = nowMs - startedMs[i];
+        if (age >= windowMs) continue;
+        used++;
+        if (windowMs - age < frees) frees = windowMs - age;
+    }
+    // Earlier-due claims still waiting have the first pick, and when the
+    // first of them lapses
+    int ahead = 0;
+    uint32_t lapses = 2 * windowMs + 1;
+    for (int i = 0; i < START_GATE_CLAIMANTS; i++) {
+        const Claim& c = claims[i];
+        if (i == who || !c.want || nowMs - c.askedMs > 2 * windowMs) continue;
+        int32_t before = (int32_t)(c.dueMs - dueMs);
+        if (before < 0 || (before == 0 && i < who)) {
+            ahead += c.want;
+            uint32_t left = 2 * windowMs + 1 - (nowMs - c.askedMs);
+            if (left < lapses) lapses = left;
+        }
+    }
+    int free = cap - used - ahead;
+    int granted = free <= 0 ? 0 : free < want ? free : want;
+    for (int i = 0; i < granted; i++) {
+        startedMs[startedNext] = nowMs;
+        startedNext = (startedNext + 1) % cap;
+        if (startedCount < cap) startedCount++;
+    }
+
+    Claim& mine = claims[who];
+    if (granted < want) {
+        mine.dueMs = dueMs;
+        mine.askedMs = nowMs;
+        mine.want = (uint8_t)(want - granted);
+        // Held back by earlier claims too: they take the free slots, so the
+        // next chance is a slot freeing or the first of them lapsing
+        *retryMs = ahead && lapses < frees ? lapses : frees;
+    } else {
+        mine.want = 0;
+    }
+    portEXIT_CRITICAL(&gateMux);
+    return granted;
+}
@@ -0,0 +1,105 @@
+#include <Arduino.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include "trace.h"
+
+static const int TRACE_MAX_BANKS = 16; // Edge state for pins 0..16 * PCF_PINS - 1
+
+// --- Trace Buffer ---
+// Append-only: a writer claims and fills its slot inside the critical
+// section, so every record below count is complete and the dump can read
+// them without holding the lock.
+static TraceRecord records[PAIR_TRACE_CAPACITY];
+static volatile uint32_t count = 0;
+static PcfPort inputSeen[TRACE_MAX_BANKS];  // Last level recorded per input pin
+static uint32_t lastUs = 0;
+static uint16_t epoch = 0;
+static portMUX_TYPE traceMux = portMUX_INITIALIZER_UNLOCKED;
+
+// Caller holds traceMux for both. These and the two the GPIO lane's edge
+// handler calls, traceInputsAt() and traceRelays(), are IRAM_ATTR: the
+// handler runs during flash writes (pair_io.cpp), and the buffer is DRAM.
+// Those two take the lock with the _SAFE critical section (the ISR variant
+// from the handler, the task one from a task), and read the time with
+// nowUs(): micros() is the same clock, but only in IRAM on a core built
+// with CONFIG_ARDUINO_ISR_IRAM, and esp_timer_get_time() always is.
+static inline uint32_t IRAM_ATTR nowUs() {
+    return (uint32_t)esp_timer_get_time();
+}
+
+static void IRAM_ATTR push(uint32_t us, uint8_t type, uint8_t arg, uint16_t value) {
+    if (count < PAIR_TRACE_CAPACITY) records[count++] = TraceRecord{us, type, arg, value};
+}
+
+static void IRAM_ATTR append(uint32_t us, uint8_t type, uint8_t arg, uint16_t value) {
+    if (us < lastUs) push(us, TRACE_EPOCH, 0, ++epoch); // The clock wrapped since the last record
+    lastUs = us;
+    push(us, type, arg, value);
+}
+
+void traceBegin(uint8_t pairs, uint16_t sideBMask) {
+    portENTER_CRITICAL(&traceMux);
+    count = 0;
+    epoch = 0;
+    lastUs = nowUs();
+    for (int b = 0; b < TRACE_MAX_BANKS; b++) inputSeen[b] = PCF_ALL_HIGH; // Nothing pressed yet
+    push(lastUs, TRACE_BOOT, pairs, sideBMask);
+    portEXIT_CRITICAL(&traceMux);
+}
+
+void traceRecord(uint8_t type, uint8_t arg, uint16_t value) {
+    portENTER_CRITICAL(&traceMux);
+    append(nowUs(), type, arg, value);
+    portEXIT_CRITICAL(&traceMux);
+}
+
+void traceInputs(uint8_t bank, PcfPort port) {
+    traceInputsAt(bank, port, nowUs());
+}
+
+void IRAM_ATTR traceInputsAt(uint8_t bank, PcfPort port, uint32_t us) {
+    if (bank >= TRACE_MAX_BANKS) return;
+    portENTER_CRITICAL_SAFE(&traceMux);
+    PcfPort changed = inputSeen[bank] ^ port;
+    if (changed) {
+        if ((int32_t)(us - lastUs) < 0) us = lastUs; // Behind, not a wrap
+        for (int bit = 0; bit < PCF_PINS; bit++) {
+            if (changed & (1u << bit)) append(us, TRACE_INPUT, bank * PCF_PINS + bit, (port >> bit) & 1);
+        }
+        inputSeen[bank] = port;
+    }
+    portEXIT_CRITICAL_SAFE(&traceMux);
+}
+
+void IRAM_ATTR traceRelays(uint8_t bank, PcfPort before, PcfPort after) {
+    PcfPort changed = before ^ after;
+    if (!changed) return;
+    portENTER_CRITICAL_SAFE(&traceMux);
+    uint32_t us = nowUs();
+    for (int bit = 0; bit < PCF_PINS; bit++) {
+        if (changed & (1u << bit)) append(us, TRACE_RELAY, bank * PCF_PINS + bit, (after >> bit) & 1);
+    }
+    portEXIT_CRITICAL_SAFE(&traceMux);
+}
+
+void traceTick() {
+    portENTER_CRITICAL(&traceMux);
+    uint32_t us = nowUs();
+    if (us < lastUs) push(us, TRACE_EPOCH, 0, ++epoch);
+    lastUs = us;
+    portEXIT_CRITICAL(&traceMux);
+}
+
+void traceDump() {
+    uint32_t n = count;
+    Serial.printf("TRACE BEGIN %lu%s\n", (unsigned long)n, n >= PAIR_TRACE_CAPACITY ? " FULL" : "");
+    for (uint32_t i = 0; i < n; i++) {
+        const TraceRecord& r = records[i];
+        Serial.printf("T %lu %c %u %u\n", (unsigned long)r.us, (char)r.type, r.arg, r.value);
+    }
+    Serial.println("TRACE END");
+}
+
+uint32_t traceCount() { return count; }
+bool traceFull() { return count >= PAIR_TRACE_CAPACITY; }
+const TraceRecord* traceRecords() { return records; }
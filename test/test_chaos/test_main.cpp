@@ -0,0 +1,37 @@
+// The chaos property checker (src/host/chaos.h) on fixed seeds:
+// pio test -e native -f test_chaos
+//
+// Each run is a quarter hour of simulated time with a random event every
+// 200 ms on average; sim --chaos runs the same checker for longer.
+
+#include <Arduino.h>
+#include <unity.h>
+#include "chaos.h"
+#include "start_gate.h"
+
+void setUp() {
+    Serial.mute(true);
+    startGateConfigure(START_CAP, START_WINDOW_MS);
+}
+void tearDown() {}
+
+static void runSeeds(int pairs) {
+    for (uint32_t seed = 1; seed <= 3; seed++) {
+        sim::PlantOptions opts;
+        opts.seed = seed;
+        PairSimConfig cfg;
+        cfg.pairs = pairs;
+        cfg.log = false;
+        TEST_ASSERT_EQUAL_MESSAGE(0, runChaos(opts, cfg, 0.25, 200, 60), "a property failed: see CHAOS lines above");
+    }
+}
+
+static void test_chaos_three_pairs() { runSeeds(3); }
+static void test_chaos_twelve_pairs() { runSeeds(12); }
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_chaos_three_pairs);
+    RUN_TEST(test_chaos_twelve_pairs);
+    return UNITY_END();
+}
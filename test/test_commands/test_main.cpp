@@ -0,0 +1,199 @@
+// Console decoder and reader: pio test -e native -f test_commands
+//
+// Every command letter, text and binary batches read back exactly as
+// sent, corrupted frames and out-of-range arguments rejected, and a short
+// run of the fuzz target (src/host/fuzz_commands.cpp) on random inputs.
+
+#include <string.h>
+#include <random>
+#include <string>
+#include <vector>
+#include <unity.h>
+#include "chaos.h"
+#include "commands.h"
+#include "fuzz_commands.h"
+
+static const int PAIRS = 6;
+
+void setUp() {}
+void tearDown() {}
+
+// Feed bytes to reader; the last result that was not READ_NONE, and how many there were
+static CommandReader::Result feed(CommandReader& reader, const std::string& bytes, int* results = nullptr) {
+    CommandReader::Result last = CommandReader::READ_NONE;
+    int n = 0;
+    for (char byte : bytes) {
+        CommandReader::Result r = reader.feed((uint8_t)byte);
+        if (r == CommandReader::READ_NONE) continue;
+        last = r;
+        n++;
+    }
+    if (results) *results = n;
+    return last;
+}
+
+static std::string frame(const CommandBatch& b) {
+    uint8_t out[COMMAND_PAYLOAD_MAX + 8];
+    return std::string((const char*)out, commandEncode(b, out));
+}
+
+static void test_decode_every_byte() {
+    const char* letters = "sxdtphr";
+    const CommandAction actions[] = {CMD_ENABLE, CMD_DISABLE, CMD_TRACE_DUMP, CMD_TRACE_ARM,
+                                     CMD_STATUS, CMD_PAUSE,   CMD_RESUME};
+    for (int c = 0; c < 256; c++) {
+        const char* at = strchr(letters, c | 0x20); // Either case
+        CommandAction want = at ? actions[at - letters] : CMD_NONE;
+        TEST_ASSERT_EQUAL_MESSAGE(want, commandDecode((char)c), std::to_string(c).c_str());
+    }
+}
+
+static void test_letter_lines() {
+    CommandReader reader(PAIRS);
+    TEST_ASSERT_EQUAL(CommandReader::READ_NONE, reader.feed(' '));
+    TEST_ASSERT_EQUAL(CommandReader::READ_NONE, reader.feed('\r'));
+    TEST_ASSERT_EQUAL(CommandReader::READ_NONE, reader.feed('s')); // Not until its newline
+    TEST_ASSERT_EQUAL(CommandReader::READ_SINGLE, feed(reader, " \r\n"));
+    TEST_ASSERT_EQUAL('s', reader.single());
+    TEST_ASSERT_EQUAL(CommandReader::READ_SINGLE, feed(reader, "X\n"));
+    TEST_ASSERT_EQUAL('X', reader.single());
+
+    // A word, or a letter that is no command, runs nothing
+    const char* rejected[] = {"disable\n", "sx\n", "s x\n", "q\n", ";\n"};
+    for (const char* line : rejected) {
+        int results;
+        TEST_ASSERT_EQUAL_MESSAGE(CommandReader::READ_ERROR, feed(reader, line, &results), line);
+        TEST_ASSERT_EQUAL_MESSAGE(1, results, line);
+        TEST_ASSERT_EQUAL_MESSAGE(CMD_ERR_OP, reader.error(), line);
+        TEST_ASSERT_EQUAL_MESSAGE(0, reader.batch().seq, line);
+    }
+}
+
+static void test_text_line() {
+    CommandReader reader(PAIRS);
+    TEST_ASSERT_EQUAL(CommandReader::READ_BATCH, feed(reader, "42 dwell * 500 900; status 2; pause\n"));
+    const CommandBatch& b = reader.batch();
+    TEST_ASSERT_FALSE(b.binary);
+    TEST_ASSERT_EQUAL(42, b.seq);
+    TEST_ASSERT_EQUAL(3, b.count);
+    TEST_ASSERT_EQUAL(OP_DWELL, b.cmds[0].op);
+    TEST_ASSERT_EQUAL(COMMAND_ALL_PAIRS, b.cmds[0].pair);
+    TEST_ASSERT_EQUAL(500, b.cmds[0].a);
+    TEST_ASSERT_EQUAL(900, b.cmds[0].b);
+    TEST_ASSERT_EQUAL(OP_STATUS, b.cmds[1].op);
+    TEST_ASSERT_EQUAL(2, b.cmds[1].pair);
+    TEST_ASSERT_EQUAL(OP_PAUSE, b.cmds[2].op);
+    TEST_ASSERT_EQUAL(COMMAND_ALL_PAIRS, b.cmds[2].pair);
+}
+
+// The chaos checker's own random batches, as text and as frames: intact,
+// each reads back as exactly one result, the batch sent or an argument
+// error at its first bad command
+static void test_random_batches_round_trip() {
+    std::mt19937 rng(1);
+    CommandReader reader(PAIRS);
+    for (int run = 0; run < 20000; run++) {
+        CommandBatch sent;
+        int bad = randomBatch(rng, PAIRS, (uint16_t)run, sent);
+        bool binary = run & 1;
+        int results;
+        CommandReader::Result r = feed(reader, binary ? frame(sent) : textBatch(sent), &results);
+        TEST_ASSERT_EQUAL(1, results);
+        if (bad >= 0) {
+            TEST_ASSERT_EQUAL(CommandReader::READ_ERROR, r);
+            TEST_ASSERT_EQUAL(CMD_ERR_ARG, reader.error());
+            TEST_ASSERT_EQUAL(bad, reader.errorIndex());
+            TEST_ASSERT_EQUAL(sent.seq, reader.batch().seq);
+        } else {
+            TEST_ASSERT_EQUAL(CommandReader::READ_BATCH, r);
+            TEST_ASSERT_TRUE(sameBatch(reader.batch(), sent));
+            TEST_ASSERT_EQUAL(binary, reader.batch().binary);
+        }
+    }
+}
+
+// Any one bit flipped inside a frame fails its CRC or its framing, never runs
+static void test_corrupt_frames_rejected() {
+    CommandBatch b = {};
+    b.seq = 7;
+    b.count = 3;
+    b.cmds[0] = Command{OP_DWELL, 1, 200, 400};
+    b.cmds[1] = Command{OP_STATUS, COMMAND_ALL_PAIRS, 0, 0};
+    b.cmds[2] = Command{OP_ENABLE, COMMAND_ALL_PAIRS, 0, 0};
+    std::string good = frame(b);
+    for (size_t at = 1; at + 1 < good.size(); at++) {
+        for (int bit = 0; bit < 8; bit++) {
+            std::string bad = good;
+            bad[at] = (char)((uint8_t)bad[at] ^ (1u << bit));
+            if (!bad[at]) continue; // A delimiter: splits the frame instead
+            CommandReader reader(PAIRS);
+            int results;
+            CommandReader::Result r = feed(reader, bad, &results);
+            TEST_ASSERT_EQUAL(1, results);
+            TEST_ASSERT_EQUAL(CommandReader::READ_ERROR, r);
+        }
+    }
+}
+
+static void test_out_of_range_rejected() {
+    struct Case {
+        const char* line;
+        CommandError error;
+        int index;
+    };
+    const Case cases[] = {
+        {"1 status 6\n", CMD_ERR_ARG, 0},
+        {"2 enable; dwell 0 900 500\n", CMD_ERR_ARG, 1},
+        {"3 pause 2; resume 9\n", CMD_ERR_ARG, 1},
+        {"4 expose 2 0 6 3000\n", CMD_ERR_ARG, 0},
+        {"5 expose 4 0 2 3000\n", CMD_ERR_ARG, 0},
+        {"6 ripple 3 1 150\n", CMD_ERR_ARG, 0},
+        {"7 aux 9 step 200\n", CMD_ERR_ARG, 0},
+        {"8 enable; spin\n", CMD_ERR_OP, 1},
+        {"9 enable;; disable\n", CMD_ERR_SYNTAX, 1},
+    };
+    for (const Case& c : cases) {
+        CommandReader reader(PAIRS);
+        TEST_ASSERT_EQUAL_MESSAGE(CommandReader::READ_ERROR, feed(reader, c.line), c.line);
+        TEST_ASSERT_EQUAL_MESSAGE(c.error, reader.error(), c.line);
+        TEST_ASSERT_EQUAL_MESSAGE(c.index, reader.errorIndex(), c.line);
+    }
+
+    CommandBatch dump = {};
+    dump.count = 1;
+    dump.cmds[0] = Command{OP_TRACE_DUMP, COMMAND_ALL_PAIRS, 0, 0};
+    CommandReader reader(PAIRS);
+    TEST_ASSERT_EQUAL(CommandReader::READ_ERROR, feed(reader, frame(dump)));
+    TEST_ASSERT_EQUAL(CMD_ERR_MODE, reader.error());
+}
+
+static void test_overlong_line() {
+    CommandReader reader(PAIRS);
+    TEST_ASSERT_EQUAL(CommandReader::READ_ERROR, feed(reader, "12 " + std::string(COMMAND_LINE_MAX, '7') + "\n"));
+    TEST_ASSERT_EQUAL(CMD_ERR_TOO_LONG, reader.error());
+    TEST_ASSERT_EQUAL(12, reader.batch().seq);
+    TEST_ASSERT_EQUAL(CommandReader::READ_BATCH, feed(reader, "13 enable\n")); // And reads on
+}
+
+// The fuzz target's checks on a fixed set of its random inputs; any failure aborts
+static void test_fuzz_inputs() {
+    std::mt19937 rng(1);
+    std::vector<uint8_t> in;
+    for (int run = 0; run < 20000; run++) {
+        fuzzCommandInput(rng, in);
+        LLVMFuzzerTestOneInput(in.data(), in.size());
+    }
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_decode_every_byte);
+    RUN_TEST(test_letter_lines);
+    RUN_TEST(test_text_line);
+    RUN_TEST(test_random_batches_round_trip);
+    RUN_TEST(test_corrupt_frames_rejected);
+    RUN_TEST(test_out_of_range_rejected);
+    RUN_TEST(test_overlong_line);
+    RUN_TEST(test_fuzz_inputs);
+    return UNITY_END();
+}
@@ -0,0 +1,115 @@
+// Stopping and holding the sequence on the virtual clock (PairSim):
+// pio test -e native -f test_stop
+//
+// Once a disable (or a pause of every pair) has unwound, no relay is on and
+// the relay expanders see no further port write, however long the pairs
+// are left; and a pair in its dwell sleeps the whole delay in one wait.
+
+#include <Arduino.h>
+#include <unity.h>
+#include "pair_sim.h"
+#include "sim_world.h"
+
+static const uint64_t NS_PER_MS = 1000000ULL;
+static const uint64_t UNWIND_NS = 100 * NS_PER_MS; // A poll period plus the unwind writes
+static const uint64_t IDLE_NS = 60000 * NS_PER_MS; // Left stopped this long
+
+void setUp() {
+    Serial.mute(true);
+}
+void tearDown() {}
+
+static PairSimConfig config(int pairs = 3) {
+    PairSimConfig cfg;
+    cfg.pairs = pairs;
+    cfg.log = false;
+    return cfg;
+}
+
+static bool relayOn(PairSim& sim, int pin) {
+    uint16_t v = PCF_ALL_HIGH;
+    sim::world().committed(sim.relayAddress(PCF_BANK(pin)), v);
+    return !(v & (1u << PCF_BIT(pin)));
+}
+
+// Run until pair 0 reaches phase after at least one full cycle (Idle: as
+// booted, before any step), stop it with stop(), let it unwind, then check
+// nothing writes a relay again
+static void stopIn(PairPhase phase, const std::function<void(PairSim&)>& stop) {
+    sim::PlantOptions opts;
+    PairSim sim(opts, config());
+    TEST_ASSERT_TRUE(sim.begin());
+    if (phase != PHASE_IDLE) {
+        sim.run(10000 * NS_PER_MS, [&] { return sim.pair(0).cycles >= 1 && sim.pair(0).phase == phase; });
+    }
+    TEST_ASSERT_EQUAL(phase, sim.pair(0).phase);
+
+    stop(sim);
+    sim.run(sim.nowNs() + UNWIND_NS);
+    for (int i = 0; i < sim.pairCount(); i++) {
+        TEST_ASSERT_FALSE(relayOn(sim, sim.pair(i).relayA));
+        TEST_ASSERT_FALSE(relayOn(sim, sim.pair(i).relayB));
+    }
+
+    uint64_t writes = sim::world().busStats().portWrites();
+    uint64_t steps = sim.steps();
+    sim.run(sim.nowNs() + IDLE_NS);
+    TEST_ASSERT_EQUAL(writes, sim::world().busStats().portWrites());
+    TEST_ASSERT_EQUAL(steps, sim.steps()); // Blocked until notified, not polling
+}
+
+static void disable(PairSim& sim) { sim.setEnabled(false); }
+static void pauseAll(PairSim& sim) { sim.setPaused(-1, true); }
+
+static void test_disable_in_travel() { stopIn(PHASE_TRAVEL, disable); }
+static void test_disable_in_dwell() { stopIn(PHASE_DWELL, disable); }
+static void test_disable_at_boot() { stopIn(PHASE_IDLE, disable); }
+static void test_pause_in_travel() { stopIn(PHASE_TRAVEL, pauseAll); }
+static void test_pause_in_dwell() { stopIn(PHASE_DWELL, pauseAll); }
+
+// The dwell is one wait to its end: no wake-ups in between but the ones an
+// input interrupt asks for (edge-driven builds)
+static void test_dwell_single_wait() {
+    sim::PlantOptions opts;
+    PairSim sim(opts, config(1));
+    TEST_ASSERT_TRUE(sim.begin());
+    sim.pair(0).dwellMinMs = 5000;
+    sim.pair(0).dwellMaxMs = 5000;
+    int dwellSteps = 0;
+    sim.afterStep = [&](int) { dwellSteps += sim.pair(0).phase == PHASE_DWELL; };
+    sim.run(20000 * NS_PER_MS, [&] { return sim.pair(0).cycles >= 3; });
+    TEST_ASSERT_EQUAL(3, sim.pair(0).cycles);
+    uint64_t interrupts = 0;
+#ifdef PAIR_INPUT_EDGES
+    interrupts = sim::world().sampleInterrupts();
+#endif
+    // The step that reached the switch and began the dwell, one per cycle
+    TEST_ASSERT_LESS_OR_EQUAL(3 + interrupts, (uint64_t)dwellSteps);
+    TEST_ASSERT_TRUE(dwellSteps >= 3);
+}
+
+// A disable in the middle of a long dwell takes effect at once
+static void test_disable_ends_dwell_wait() {
+    sim::PlantOptions opts;
+    PairSim sim(opts, config());
+    TEST_ASSERT_TRUE(sim.begin());
+    sim.pair(0).dwellMinMs = 60000;
+    sim.pair(0).dwellMaxMs = 60000;
+    sim.run(10000 * NS_PER_MS, [&] { return sim.pair(0).phase == PHASE_DWELL; });
+    TEST_ASSERT_EQUAL(PHASE_DWELL, sim.pair(0).phase);
+    sim.setEnabled(false);
+    sim.run(sim.nowNs() + NS_PER_MS);
+    TEST_ASSERT_EQUAL(PHASE_IDLE, sim.pair(0).phase);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_disable_in_travel);
+    RUN_TEST(test_disable_in_dwell);
+    RUN_TEST(test_disable_at_boot);
+    RUN_TEST(test_pause_in_travel);
+    RUN_TEST(test_pause_in_dwell);
+    RUN_TEST(test_dwell_single_wait);
+    RUN_TEST(test_disable_ends_dwell_wait);
+    return UNITY_END();
+}